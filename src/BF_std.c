@@ -54,9 +54,9 @@ struct BF_ctx {
 #define for_each_index()
 #endif
 
-#if BF_X2
+#if BF_X > 1
 #if BF_mt > 1
-#define INDEX2				[index & 1]
+#define INDEX2				[index - t]
 #else
 #define INDEX2				[index]
 #endif
@@ -65,11 +65,11 @@ struct BF_ctx {
 #endif
 
 #if BF_mt > 1
-#if BF_X2
+#if BF_X > 1
 #define for_each_t() \
-	for (t = 0; t < n; t += 2)
+	for (t = 0; t < n; t += BF_X)
 #define for_each_ti() \
-	for (index = t; index <= t + 1; index++)
+	for (index = t; index < t + BF_X; index++)
 #else
 #define for_each_t() \
 	for (t = 0; t < n; t++)
@@ -488,72 +488,88 @@ extern void (*BF_body)(void);
 
 #else
 
-#if BF_X2
+#if BF_X > 1
 /*
- * Encrypt two blocks in parallel, BF_ROUNDS is hardcoded here.
+ * Expands m(lane, arg) for each of the BF_X interleaved instances.
  */
-#define BF_ENCRYPT2 \
-	L0 ^= BF_current[0].P[0]; \
-	L1 ^= BF_current[1].P[0]; \
-	BF_ROUND(BF_current[0], L0, R0, 0, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], L1, R1, 0, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], R0, L0, 1, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], R1, L1, 1, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], L0, R0, 2, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], L1, R1, 2, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], R0, L0, 3, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], R1, L1, 3, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], L0, R0, 4, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], L1, R1, 4, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], R0, L0, 5, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], R1, L1, 5, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], L0, R0, 6, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], L1, R1, 6, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], R0, L0, 7, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], R1, L1, 7, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], L0, R0, 8, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], L1, R1, 8, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], R0, L0, 9, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], R1, L1, 9, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], L0, R0, 10, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], L1, R1, 10, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], R0, L0, 11, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], R1, L1, 11, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], L0, R0, 12, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], L1, R1, 12, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], R0, L0, 13, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], R1, L1, 13, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], L0, R0, 14, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], L1, R1, 14, v1, v2, v3, v4); \
-	BF_ROUND(BF_current[0], R0, L0, 15, u1, u2, u3, u4); \
-	BF_ROUND(BF_current[1], R1, L1, 15, v1, v2, v3, v4); \
-	u4 = R0; \
-	v4 = R1; \
-	R0 = L0; \
-	R1 = L1; \
-	L0 = u4 ^ BF_current[0].P[BF_ROUNDS + 1]; \
-	L1 = v4 ^ BF_current[1].P[BF_ROUNDS + 1];
+#if BF_X == 2
+#define BF_LANES(m, a) \
+	m(0, a) m(1, a)
+#elif BF_X == 3
+#define BF_LANES(m, a) \
+	m(0, a) m(1, a) m(2, a)
+#elif BF_X == 4
+#define BF_LANES(m, a) \
+	m(0, a) m(1, a) m(2, a) m(3, a)
+#elif BF_X == 5
+#define BF_LANES(m, a) \
+	m(0, a) m(1, a) m(2, a) m(3, a) m(4, a)
+#elif BF_X == 6
+#define BF_LANES(m, a) \
+	m(0, a) m(1, a) m(2, a) m(3, a) m(4, a) m(5, a)
+#elif BF_X == 8
+#define BF_LANES(m, a) \
+	m(0, a) m(1, a) m(2, a) m(3, a) m(4, a) m(5, a) m(6, a) m(7, a)
+#else
+#error "Unsupported BF_X"
+#endif
+
+#define BF_LANE_START(j, a) \
+	LX[j] ^= BF_current[j].P[0];
+#define BF_LANE_ROUND_LR(j, N) \
+	BF_ROUND(BF_current[j], LX[j], RX[j], N, u1, u2, u3, u4);
+#define BF_LANE_ROUND_RL(j, N) \
+	BF_ROUND(BF_current[j], RX[j], LX[j], N, u1, u2, u3, u4);
+#define BF_LANE_FINISH(j, a) \
+	u4 = RX[j]; \
+	RX[j] = LX[j]; \
+	LX[j] = u4 ^ BF_current[j].P[BF_ROUNDS + 1];
+
+/*
+ * Encrypt BF_X blocks in parallel, BF_ROUNDS is hardcoded here.  Each
+ * round is done for all of the blocks before moving on to the next one,
+ * so that their S-box lookups overlap.
+ */
+#define BF_ENCRYPT_X \
+	BF_LANES(BF_LANE_START, 0) \
+	BF_LANES(BF_LANE_ROUND_LR, 0) \
+	BF_LANES(BF_LANE_ROUND_RL, 1) \
+	BF_LANES(BF_LANE_ROUND_LR, 2) \
+	BF_LANES(BF_LANE_ROUND_RL, 3) \
+	BF_LANES(BF_LANE_ROUND_LR, 4) \
+	BF_LANES(BF_LANE_ROUND_RL, 5) \
+	BF_LANES(BF_LANE_ROUND_LR, 6) \
+	BF_LANES(BF_LANE_ROUND_RL, 7) \
+	BF_LANES(BF_LANE_ROUND_LR, 8) \
+	BF_LANES(BF_LANE_ROUND_RL, 9) \
+	BF_LANES(BF_LANE_ROUND_LR, 10) \
+	BF_LANES(BF_LANE_ROUND_RL, 11) \
+	BF_LANES(BF_LANE_ROUND_LR, 12) \
+	BF_LANES(BF_LANE_ROUND_RL, 13) \
+	BF_LANES(BF_LANE_ROUND_LR, 14) \
+	BF_LANES(BF_LANE_ROUND_RL, 15) \
+	BF_LANES(BF_LANE_FINISH, 0)
+
+#define BF_LANE_ZERO(j, a) \
+	LX[j] = RX[j] = 0;
+#define BF_LANE_STORE(j, offset) \
+	*(ptr + (offset) + (BF_current[j].P - BF_current[0].P)) = LX[j]; \
+	*(ptr + (offset) + (BF_current[j].P - BF_current[0].P) + 1) = RX[j];
 
 #define BF_body() \
-	L0 = R0 = L1 = R1 = 0; \
+	BF_LANES(BF_LANE_ZERO, 0) \
 	ptr = BF_current[0].P; \
 	do { \
-		BF_ENCRYPT2; \
-		*ptr = L0; \
-		*(ptr + 1) = R0; \
-		*(ptr + (BF_current[1].P - BF_current[0].P)) = L1; \
-		*(ptr + (BF_current[1].P - BF_current[0].P) + 1) = R1; \
+		BF_ENCRYPT_X; \
+		BF_LANES(BF_LANE_STORE, 0) \
 		ptr += 2; \
 	} while (ptr < &BF_current[0].P[BF_ROUNDS + 2]); \
 \
 	ptr = BF_current[0].S[0]; \
 	do { \
 		ptr += 2; \
-		BF_ENCRYPT2; \
-		*(ptr - 2) = L0; \
-		*(ptr - 1) = R0; \
-		*(ptr - 2 + (BF_current[1].S[0] - BF_current[0].S[0])) = L1; \
-		*(ptr - 1 + (BF_current[1].S[0] - BF_current[0].S[0])) = R1; \
+		BF_ENCRYPT_X; \
+		BF_LANES(BF_LANE_STORE, -2) \
 	} while (ptr < &BF_current[0].S[3][0xFF]);
 #else
 #define BF_body() \
@@ -611,8 +627,8 @@ void BF_std_crypt(BF_salt *salt, int n)
 #endif
 	for_each_t() {
 #if BF_mt > 1
-#if BF_X2
-		struct BF_ctx BF_current[2];
+#if BF_X > 1
+		struct BF_ctx BF_current[BF_X];
 #else
 		struct BF_ctx BF_current;
 #endif
@@ -620,9 +636,8 @@ void BF_std_crypt(BF_salt *salt, int n)
 
 		BF_word L0, R0;
 		BF_word u1, u2, u3, u4;
-#if BF_X2
-		BF_word L1, R1;
-		BF_word v1, v2, v3, v4;
+#if BF_X > 1
+		BF_word LX[BF_X], RX[BF_X];
 #endif
 		BF_word *ptr;
 		BF_word count;
@@ -29,12 +29,21 @@ typedef struct {
  */
 typedef BF_word BF_binary[6];
 
+/*
+ * Number of Blowfish instances interleaved by each thread, to hide the
+ * latency of S-box lookups.  Arch headers set either BF_X2 for two, or
+ * BF_X for 2 to 6 or 8 (more instances need more registers to be of use).
+ */
+#ifndef BF_X
 #if BF_X2
-#define BF_Nmin				2
+#define BF_X				2
 #else
-#define BF_Nmin				1
+#define BF_X				1
+#endif
 #endif
 
+#define BF_Nmin				BF_X
+
 #if defined(_OPENMP) && !BF_ASM
 #define BF_cpt				3
 #define BF_mt				96
@@ -54,8 +63,11 @@ extern BF_binary BF_out[BF_N];
  */
 extern unsigned char BF_atoi64[0x80];
 
-#if BF_X2
-#define BF_ALGORITHM_NAME		"32/" ARCH_BITS_STR " X2"
+#define BF_STR(x)			#x
+#define BF_XSTR(x)			BF_STR(x)
+
+#if BF_X > 1
+#define BF_ALGORITHM_NAME		"32/" ARCH_BITS_STR " X" BF_XSTR(BF_X)
 #else
 #define BF_ALGORITHM_NAME		"32/" ARCH_BITS_STR
 #endif
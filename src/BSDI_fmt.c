@@ -316,6 +316,22 @@ static void crypt_all(int count)
 	DES_bs_crypt(saved_count, count);
 }
 
+#if !DES_BS_ASM
+static void crypt_all_salts(int count, void **salts, int salt_count)
+{
+	ARCH_WORD values[DES_BS_SALT_GROUP];
+	int counts[DES_BS_SALT_GROUP];
+	int index;
+
+	for (index = 0; index < salt_count; index++) {
+		values[index] = ((ARCH_WORD *)salts[index])[0];
+		counts[index] = ((ARCH_WORD *)salts[index])[1];
+	}
+
+	DES_bs_crypt_salts(counts, values, salt_count, count);
+}
+#endif
+
 static int cmp_one(void *binary, int index)
 {
 	return DES_bs_cmp_one((ARCH_WORD *)binary, 32, index);
@@ -440,6 +456,13 @@ struct fmt_main fmt_BSDI = {
 		cmp_all,
 #endif
 		cmp_one,
-		cmp_exact
+		cmp_exact,
+#if DES_BS && !DES_BS_ASM
+		crypt_all_salts,
+		DES_bs_select_salt
+#else
+		NULL,
+		NULL
+#endif
 	}
 };
@@ -37,6 +37,14 @@ DES_bs_combined *DES_bs_all_p = NULL;
 DES_bs_combined CC_CACHE_ALIGN DES_bs_all;
 #endif
 
+/* The data blocks holding the outputs we compare against */
+#if DES_BS_ASM
+#define DES_bs_out			DES_bs_all.B
+#else
+#define DES_bs_out \
+	(DES_bs_selected < 0 ? DES_bs_all.B : DES_bs_all.Bs[DES_bs_selected])
+#endif
+
 static unsigned char DES_LM_KP[56] = {
 	1, 2, 3, 4, 5, 6, 7,
 	10, 11, 12, 13, 14, 15, 0,
@@ -323,13 +331,13 @@ static MAYBE_INLINE int DES_bs_get_hash(int index, int count)
  * little-endian archs is removed, even if the arch is in fact little-endian.
  */
 	init_depth();
-	b = (DES_bs_vector *)&DES_bs_all.B[0] DEPTH;
+	b = (DES_bs_vector *)&DES_bs_out[0] DEPTH;
 #define GET_BIT(bit) \
 	(((unsigned ARCH_WORD)b[(bit)] START >> index) & 1)
 #else
 	depth = index >> 3;
 	index &= 7;
-	b = (DES_bs_vector *)((unsigned char *)&DES_bs_all.B[0] START + depth);
+	b = (DES_bs_vector *)((unsigned char *)&DES_bs_out[0] START + depth);
 #define GET_BIT(bit) \
 	(((unsigned int)*(unsigned char *)&b[(bit)] START >> index) & 1)
 #endif
@@ -437,7 +445,7 @@ int DES_bs_cmp_all(ARCH_WORD *binary, int count)
 	for_each_t(n)
 	for_each_depth() {
 		value = binary[0];
-		b = (DES_bs_vector *)&DES_bs_all.B[0] DEPTH;
+		b = (DES_bs_vector *)&DES_bs_out[0] DEPTH;
 
 		mask = b[0] START ^ -(value & 1);
 		mask |= b[1] START ^ -((value >> 1) & 1);
@@ -477,7 +485,7 @@ int DES_bs_cmp_one(ARCH_WORD *binary, int count, int index)
 	depth = index >> 3;
 	index &= 7;
 
-	b = (DES_bs_vector *)((unsigned char *)&DES_bs_all.B[0] START + depth);
+	b = (DES_bs_vector *)((unsigned char *)&DES_bs_out[0] START + depth);
 
 #define GET_BIT \
 	((unsigned ARCH_WORD)*(unsigned char *)&b[0] START >> index)
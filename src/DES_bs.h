@@ -31,6 +31,14 @@ typedef ARCH_WORD DES_bs_vector[DES_BS_VECTOR_SIZE];
 #define DES_bs_vector			ARCH_WORD
 #endif
 
+#if !DES_BS_ASM
+/*
+ * Maximum number of salts for DES_bs_crypt_salts() and
+ * DES_bs_crypt_25_salts().
+ */
+#define DES_BS_SALT_GROUP		8
+#endif
+
 /*
  * All bitslice DES parameters combined into one struct for more efficient
  * cache usage. Don't re-order unless you know what you're doing, as there
@@ -69,6 +77,9 @@ typedef struct {
 	int keys_changed;	/* If keys have changed */
 	unsigned int salt;	/* Salt value corresponding to E[] contents */
 	DES_bs_vector *Ens[48];	/* Pointers into B[] for non-salted E */
+#if !DES_BS_ASM
+	DES_bs_vector Bs[DES_BS_SALT_GROUP][64]; /* B[] for each salt */
+#endif
 } DES_bs_combined;
 
 #if defined(_OPENMP) && !DES_BS_ASM
@@ -147,6 +158,28 @@ extern void DES_bs_crypt_25(int keys_count);
  */
 extern void DES_bs_crypt_LM(int keys_count);
 
+#if !DES_BS_ASM
+/*
+ * Same as DES_bs_set_salt() and DES_bs_crypt() or DES_bs_crypt_25() for
+ * each of salt_count salts (and iteration counts), except that every thread
+ * runs its keys over all of the salts in one go.  The outputs are kept per
+ * salt, see DES_bs_select_salt().  The salt set with DES_bs_set_salt() is
+ * left alone.
+ */
+extern void DES_bs_crypt_salts(int *counts, ARCH_WORD *salts, int salt_count,
+	int keys_count);
+extern void DES_bs_crypt_25_salts(ARCH_WORD *salts, int salt_count,
+	int keys_count);
+
+/*
+ * Makes the outputs for salts[index] of the last DES_bs_crypt*_salts() call
+ * the ones seen by the hash and comparison functions below, until the next
+ * crypt.  DES_bs_selected is that index, or -1 for the plain DES_bs_all.B.
+ */
+extern void DES_bs_select_salt(int index);
+extern int DES_bs_selected;
+#endif
+
 /*
  * Converts an ASCII ciphertext to binary to be used with one of the
  * comparison functions.
@@ -3,6 +3,8 @@
  * Copyright (c) 1996-2001,2003,2010,2011 by Solar Designer
  */
 
+#include <string.h>
+
 #include "arch.h"
 #include "common.h"
 #include "DES_bs.h"
@@ -115,6 +117,61 @@ typedef struct {
 	(dst).f = vec_sel((a).f, (b).f, (c).f); \
 	(dst).g = vec_sel((a).g, (b).g, (c).g)
 
+#elif defined(__AVX512F__) && DES_BS_DEPTH == 512
+#include <immintrin.h>
+
+typedef __m512i vtype;
+
+#define vst(dst, ofs, src) \
+	_mm512_store_si512((vtype *)((DES_bs_vector *)&(dst) + (ofs)), (src))
+
+#define vxorf(a, b) \
+	_mm512_xor_si512((a), (b))
+
+#define vnot(dst, a) \
+	(dst) = _mm512_ternarylogic_epi64((a), (a), (a), 0x0F)
+#define vand(dst, a, b) \
+	(dst) = _mm512_and_si512((a), (b))
+#define vor(dst, a, b) \
+	(dst) = _mm512_or_si512((a), (b))
+#define vandn(dst, a, b) \
+	(dst) = _mm512_andnot_si512((b), (a))
+#define vsel(dst, a, b, c) \
+	(dst) = _mm512_ternarylogic_epi64((c), (b), (a), 0xCA)
+
+#define vshl(dst, src, shift) \
+	(dst) = _mm512_slli_epi64((src), (shift))
+#define vshr(dst, src, shift) \
+	(dst) = _mm512_srli_epi64((src), (shift))
+
+#elif defined(__AVX2__) && DES_BS_DEPTH == 256 && !defined(DES_BS_NO_AVX256)
+#include <immintrin.h>
+
+typedef __m256i vtype;
+
+#define vst(dst, ofs, src) \
+	_mm256_store_si256((vtype *)((DES_bs_vector *)&(dst) + (ofs)), (src))
+
+#define vxorf(a, b) \
+	_mm256_xor_si256((a), (b))
+
+#define vand(dst, a, b) \
+	(dst) = _mm256_and_si256((a), (b))
+#define vor(dst, a, b) \
+	(dst) = _mm256_or_si256((a), (b))
+#define vandn(dst, a, b) \
+	(dst) = _mm256_andnot_si256((b), (a))
+#define vsel(dst, a, b, c) \
+	(dst) = _mm256_xor_si256(_mm256_andnot_si256((c), (a)), \
+	    _mm256_and_si256((c), (b)))
+
+#define vshl1(dst, src) \
+	(dst) = _mm256_add_epi8((src), (src))
+#define vshl(dst, src, shift) \
+	(dst) = _mm256_slli_epi64((src), (shift))
+#define vshr(dst, src, shift) \
+	(dst) = _mm256_srli_epi64((src), (shift))
+
 #elif defined(__AVX__) && DES_BS_DEPTH == 256 && !defined(DES_BS_NO_AVX256)
 #include <immintrin.h>
 
@@ -1147,14 +1204,24 @@ void DES_bs_set_salt(ARCH_WORD salt)
 #define y(p, q) vxorf(*(vtype *)&b[p] bd, *(vtype *)&k[q] kd)
 #define z(r) ((vtype *)&b[r] bd)
 
+int DES_bs_selected = -1;
+
+/* Set while DES_bs_crypt*() are called for DES_bs_crypt*_salts() */
+static ARCH_WORD *DES_bs_group_salts;
+static int *DES_bs_group_counts, DES_bs_group_count;
+
 void DES_bs_crypt_25(int keys_count)
 {
+	ARCH_WORD *salts = DES_bs_group_salts;
+	int salt_count = DES_bs_group_count;
 #if DES_bs_mt
 	int t, n = (keys_count + (DES_BS_DEPTH - 1)) / DES_BS_DEPTH;
 #endif
 
+	DES_bs_selected = -1;
+
 #ifdef _OPENMP
-#pragma omp parallel for default(none) private(t) shared(n, DES_bs_all_p, keys_count)
+#pragma omp parallel for default(none) private(t) shared(n, DES_bs_all_p, keys_count, salts, salt_count)
 #endif
 	for_each_t(n) {
 #if DES_BS_EXPAND
@@ -1163,6 +1230,7 @@ void DES_bs_crypt_25(int keys_count)
 		ARCH_WORD **k;
 #endif
 		int iterations, rounds_and_swapped;
+		int salt_index = 0;
 #if DES_BS_VECTOR_LOOPS
 		int depth;
 #endif
@@ -1172,7 +1240,11 @@ void DES_bs_crypt_25(int keys_count)
 
 body:
 #if DES_bs_mt
-		DES_bs_set_salt_for_thread(t, DES_bs_all_by_tnum(-1).salt);
+		DES_bs_set_salt_for_thread(t, salt_count ?
+		    salts[salt_index] : DES_bs_all_by_tnum(-1).salt);
+#else
+		if (salt_count)
+			DES_bs_set_salt(salts[salt_index]);
 #endif
 
 		{
@@ -1256,11 +1328,7 @@ swap:
 		k -= (0x300 + 48);
 		rounds_and_swapped = 0x108;
 		if (--iterations) goto swap;
-#if DES_bs_mt
-		continue;
-#else
-		return;
-#endif
+		goto done;
 
 next:
 		k -= (0x300 - 48);
@@ -1276,17 +1344,30 @@ finalize_keys:
 		DES_bs_finalize_keys();
 #endif
 		goto body;
+
+done:
+		if (salt_count) {
+			memcpy(DES_bs_all.Bs[salt_index], DES_bs_all.B,
+			    sizeof(DES_bs_all.B));
+			if (++salt_index < salt_count)
+				goto body;
+		}
 	}
 }
 
 void DES_bs_crypt(int count, int keys_count)
 {
+	ARCH_WORD *salts = DES_bs_group_salts;
+	int *counts = DES_bs_group_counts;
+	int salt_count = DES_bs_group_count;
 #if DES_bs_mt
 	int t, n = (keys_count + (DES_BS_DEPTH - 1)) / DES_BS_DEPTH;
 #endif
 
+	DES_bs_selected = -1;
+
 #ifdef _OPENMP
-#pragma omp parallel for default(none) private(t) shared(n, DES_bs_all_p, count, keys_count)
+#pragma omp parallel for default(none) private(t) shared(n, DES_bs_all_p, count, keys_count, salts, counts, salt_count)
 #endif
 	for_each_t(n) {
 #if DES_BS_EXPAND
@@ -1295,6 +1376,7 @@ void DES_bs_crypt(int count, int keys_count)
 		ARCH_WORD **k;
 #endif
 		int iterations, rounds_and_swapped;
+		int salt_index = 0;
 #if DES_BS_VECTOR_LOOPS
 		int depth;
 #endif
@@ -1304,7 +1386,11 @@ void DES_bs_crypt(int count, int keys_count)
 
 body:
 #if DES_bs_mt
-		DES_bs_set_salt_for_thread(t, DES_bs_all_by_tnum(-1).salt);
+		DES_bs_set_salt_for_thread(t, salt_count ?
+		    salts[salt_index] : DES_bs_all_by_tnum(-1).salt);
+#else
+		if (salt_count)
+			DES_bs_set_salt(salts[salt_index]);
 #endif
 
 		{
@@ -1318,7 +1404,7 @@ body:
 		k = DES_bs_all.KS.p;
 #endif
 		rounds_and_swapped = 8;
-		iterations = count;
+		iterations = salt_count ? counts[salt_index] : count;
 
 start:
 		for_each_depth()
@@ -1380,21 +1466,13 @@ swap:
 		k -= (0x300 + 48);
 		rounds_and_swapped = 0x108;
 		if (--iterations) goto swap;
-#if DES_bs_mt
-		continue;
-#else
-		return;
-#endif
+		goto done;
 
 next:
 		k -= (0x300 - 48);
 		rounds_and_swapped = 8;
 		if (--iterations) goto start;
-#if DES_bs_mt
-		continue;
-#else
-		return;
-#endif
+		goto done;
 
 finalize_keys:
 		DES_bs_all.keys_changed = 0;
@@ -1404,9 +1482,58 @@ finalize_keys:
 		DES_bs_finalize_keys();
 #endif
 		goto body;
+
+done:
+		if (salt_count) {
+			memcpy(DES_bs_all.Bs[salt_index], DES_bs_all.B,
+			    sizeof(DES_bs_all.B));
+			if (++salt_index < salt_count)
+				goto body;
+		}
 	}
 }
 
+#if DES_bs_mt
+#define DES_bs_save_salt()
+#define DES_bs_restore_salt()
+#else
+#define DES_bs_save_salt() \
+	unsigned int saved_salt = DES_bs_all.salt
+#define DES_bs_restore_salt() \
+	DES_bs_set_salt(saved_salt)
+#endif
+
+void DES_bs_crypt_salts(int *counts, ARCH_WORD *salts, int salt_count,
+	int keys_count)
+{
+	DES_bs_save_salt();
+
+	DES_bs_group_salts = salts;
+	DES_bs_group_counts = counts;
+	DES_bs_group_count = salt_count;
+	DES_bs_crypt(0, keys_count);
+	DES_bs_group_count = 0;
+
+	DES_bs_restore_salt();
+}
+
+void DES_bs_crypt_25_salts(ARCH_WORD *salts, int salt_count, int keys_count)
+{
+	DES_bs_save_salt();
+
+	DES_bs_group_salts = salts;
+	DES_bs_group_count = salt_count;
+	DES_bs_crypt_25(keys_count);
+	DES_bs_group_count = 0;
+
+	DES_bs_restore_salt();
+}
+
+void DES_bs_select_salt(int index)
+{
+	DES_bs_selected = index;
+}
+
 #undef x
 
 #if DES_bs_mt
@@ -1458,6 +1585,8 @@ void DES_bs_crypt_LM(int keys_count)
 	int t, n = (keys_count + (DES_BS_DEPTH - 1)) / DES_BS_DEPTH;
 #endif
 
+	DES_bs_selected = -1;
+
 #ifdef _OPENMP
 #pragma omp parallel for default(none) private(t) shared(n, DES_bs_all_p, keys_count)
 #endif
@@ -0,0 +1,424 @@
+/*
+ * Batch front end to the built-in *2john hash extractors.
+ *
+ * Walks the files and directories given on the command line, picks the
+ * extractor for each file from its signature (or its name, for the types
+ * without one) and writes all of the hashes to a single file.  Apart from
+ * hccap2john, the extractors already name each hash after the file it came
+ * from, so nothing else is written there: the loader has no comment lines,
+ * and a path with a colon in it could be taken for a hash.
+ *
+ * The extractors print to stdout, keep global state and exit() on some
+ * errors, so rather than threads we run them in forked worker processes,
+ * one per CPU by default, each doing its share of the files.  A worker's
+ * output goes to a temporary file along with the offsets where each of
+ * its files' output starts and ends.  A worker that died, or that spent
+ * longer than the time limit on one file, is restarted after that file.
+ * The outputs are then put together in path order, so the result doesn't
+ * depend on the number of workers.
+ *
+ * This software is hereby released to the general public under the
+ * following terms: Redistribution and use in source and binary forms,
+ * with or without modification, are permitted.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+
+#if !defined (_MSC_VER) && !defined (__MINGW32__)
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "misc.h"
+#include "memory.h"
+
+extern int zip2john(int argc, char **argv);
+extern int rar2john(int argc, char **argv);
+extern int keepass2john(int argc, char **argv);
+extern int pwsafe2john(int argc, char **argv);
+extern int keychain2john(int argc, char **argv);
+extern int keyring2john(int argc, char **argv);
+extern int ssh2john(int argc, char **argv);
+extern int pfx2john(int argc, char **argv);
+extern int hccap2john(int argc, char **argv);
+
+#define HEADER_SIZE			64
+
+/* Default time limit for one file, in seconds */
+#define FILE_TIMEOUT			60
+
+/*
+ * Known file types: a signature at the start of the file (with an extra
+ * string to look for in the header, if any), or else a list of extensions.
+ */
+static struct extractor {
+	char *name;
+	int (*main)(int argc, char **argv);
+	char *magic;
+	int magic_len;
+	char *also;
+	char *extensions;
+} extractors[] = {
+	{"zip2john", zip2john, "PK\x03\x04", 4, NULL, NULL},
+	{"rar2john", rar2john, "Rar!\x1a\x07\x00", 7, NULL, NULL},
+	{"keepass2john", keepass2john, "\x03\xd9\xa2\x9a", 4, NULL, NULL},
+	{"pwsafe2john", pwsafe2john, "PWS3", 4, NULL, NULL},
+	{"keychain2john", keychain2john, "kych", 4, NULL, NULL},
+	{"keyring2john", keyring2john, "GnomeKeyring\n\r\0\n", 16, NULL, NULL},
+	{"ssh2john", ssh2john, "-----BEGIN ", 11, "PRIVATE KEY-----", NULL},
+	{"pfx2john", pfx2john, NULL, 0, NULL, ".pfx .p12"},
+	{"hccap2john", hccap2john, NULL, 0, NULL, ".hccap"},
+	{NULL}
+};
+
+/*
+ * Where a file's hashes are in its worker's output, or the reason why there
+ * are none.
+ */
+struct result {
+	long start, end;
+	int status;
+};
+
+#define RESULT_OK			0
+#define RESULT_UNKNOWN			1
+#define RESULT_FAILED			2
+
+static char **files;
+static int file_count, file_alloc;
+static unsigned int timeout = FILE_TIMEOUT;
+
+static void add_file(char *path)
+{
+	if (file_count == file_alloc) {
+		file_alloc = file_alloc ? file_alloc * 2 : 0x400;
+		if (!(files = realloc(files, file_alloc * sizeof(*files))))
+			pexit("realloc");
+	}
+	files[file_count++] = str_alloc_copy(path);
+}
+
+static int compare_names(const void *a, const void *b)
+{
+	return strcmp(*(char **)a, *(char **)b);
+}
+
+/*
+ * Adds the regular files under path, depth first and in name order.
+ * Symbolic links are only followed when given on the command line.
+ */
+static void add_path(char *path, int top)
+{
+	struct stat st;
+	DIR *dir;
+	struct dirent *entry;
+	char **names, *name;
+	int count, alloc, i;
+
+	if ((top ? stat(path, &st) : lstat(path, &st))) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return;
+	}
+
+	if (S_ISREG(st.st_mode)) {
+		add_file(path);
+		return;
+	}
+	if (!S_ISDIR(st.st_mode))
+		return;
+
+	if (!(dir = opendir(path))) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return;
+	}
+
+	names = NULL;
+	count = alloc = 0;
+	while ((entry = readdir(dir))) {
+		if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+			continue;
+		if (count == alloc) {
+			alloc = alloc ? alloc * 2 : 0x40;
+			if (!(names = realloc(names, alloc * sizeof(*names))))
+				pexit("realloc");
+		}
+		name = mem_alloc(strlen(path) + strlen(entry->d_name) + 2);
+		sprintf(name, "%s%s%s", path,
+			path[strlen(path) - 1] == '/' ? "" : "/", entry->d_name);
+		names[count++] = name;
+	}
+	closedir(dir);
+
+	qsort(names, count, sizeof(*names), compare_names);
+	for (i = 0; i < count; i++) {
+		add_path(names[i], 0);
+		MEM_FREE(names[i]);
+	}
+	free(names);
+}
+
+static struct extractor *find_extractor(char *path)
+{
+	struct extractor *e;
+	unsigned char header[HEADER_SIZE + 1];
+	char *ext, *pos;
+	int fd, len;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return NULL;
+	len = read(fd, header, HEADER_SIZE);
+	close(fd);
+	if (len < 0)
+		return NULL;
+	header[len] = 0;
+
+	for (e = extractors; e->name; e++)
+	if (e->magic && len >= e->magic_len &&
+	    !memcmp(header, e->magic, e->magic_len) &&
+	    (!e->also || strstr((char *)header, e->also)))
+		return e;
+
+	if (!(ext = strrchr(path, '.')) || strchr(ext, '/'))
+		return NULL;
+	for (e = extractors; e->name; e++)
+	if (e->extensions && (pos = strstr(e->extensions, ext)) &&
+	    (pos[strlen(ext)] == ' ' || !pos[strlen(ext)]))
+		return e;
+
+	return NULL;
+}
+
+/*
+ * Processes files first, first + workers, ... with the output going to
+ * out_fd and one result per file appended to result_fd.  An extractor
+ * which runs for longer than the time limit is killed by SIGALRM, along
+ * with the worker.
+ */
+static void worker(int first, int workers, int out_fd, int result_fd)
+{
+	struct extractor *e;
+	struct result result;
+	char *argv[3];
+	int index;
+
+	if (dup2(out_fd, 1) < 0)
+		pexit("dup2");
+	signal(SIGALRM, SIG_DFL);
+
+	for (index = first; index < file_count; index += workers) {
+		memset(&result, 0, sizeof(result));
+		result.start = result.end = lseek(1, 0, SEEK_CUR);
+		if ((e = find_extractor(files[index]))) {
+			argv[0] = e->name;
+			argv[1] = files[index];
+			argv[2] = NULL;
+			alarm(timeout);
+			e->main(2, argv);
+			fflush(stdout);
+			alarm(0);
+			result.end = lseek(1, 0, SEEK_CUR);
+			result.status = RESULT_OK;
+		} else
+			result.status = RESULT_UNKNOWN;
+		if (write(result_fd, &result, sizeof(result)) != sizeof(result))
+			pexit("write");
+	}
+
+	fflush(stdout);
+	_exit(0);
+}
+
+static int result_count(int fd)
+{
+	struct stat st;
+
+	if (fstat(fd, &st))
+		pexit("fstat");
+	return st.st_size / sizeof(struct result);
+}
+
+static pid_t start_worker(int first, int workers, FILE *out, FILE *results)
+{
+	pid_t pid;
+
+	fflush(stdout);
+	fflush(stderr);
+	if ((pid = fork()) < 0)
+		pexit("fork");
+	if (!pid)
+		worker(first, workers, fileno(out), fileno(results));
+
+	return pid;
+}
+
+static void copy_output(FILE *dst, int src, struct result *result)
+{
+	char buffer[0x10000];
+	long pos = result->start;
+	ssize_t len;
+
+	while (pos < result->end) {
+		len = result->end - pos;
+		if (len > sizeof(buffer))
+			len = sizeof(buffer);
+		if ((len = pread(src, buffer, len, pos)) <= 0)
+			pexit("pread");
+		if (fwrite(buffer, 1, len, dst) != len)
+			pexit("fwrite");
+		pos += len;
+	}
+}
+
+static int usage(void)
+{
+	fprintf(stderr, "Usage: batch2john [-j WORKERS] [-t SECONDS] [-o OUTPUT] "
+		"FILE|DIRECTORY...\n"
+		"\nExtracts the hashes from all of the files it knows "
+		"(zip, rar, KeePass,\n"
+		"Password Safe, keychain, keyring, SSH private key, "
+		"PKCS#12 and hccap)\n"
+		"in one go, using WORKERS processes (default: one per CPU).\n"
+		"A file which takes longer than SECONDS (default: %d, "
+		"0 for no limit)\n"
+		"is given up on.\n", FILE_TIMEOUT);
+	return 1;
+}
+
+int batch2john(int argc, char **argv)
+{
+	FILE *output, **out, **results;
+	struct result *result, failed;
+	pid_t *pids, pid;
+	char *output_name = NULL;
+	long cpus;
+	int workers = 0, status, i, w, c, done;
+	int counts[RESULT_FAILED + 1];
+
+	while ((c = getopt(argc, argv, "j:t:o:h")) != -1)
+	switch (c) {
+	case 'j':
+		workers = atoi(optarg);
+		if (workers < 1)
+			return usage();
+		break;
+	case 't':
+		if (atoi(optarg) < 0)
+			return usage();
+		timeout = atoi(optarg);
+		break;
+	case 'o':
+		output_name = optarg;
+		break;
+	default:
+		return usage();
+	}
+	if (optind >= argc)
+		return usage();
+
+	for (i = optind; i < argc; i++)
+		add_path(argv[i], 1);
+
+	if (!workers) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		workers = cpus > 0 ? cpus : 1;
+	}
+	if (workers > file_count)
+		workers = file_count ? file_count : 1;
+
+	output = stdout;
+	if (output_name && !(output = fopen(output_name, "w")))
+		pexit("fopen: %s", output_name);
+
+	out = mem_alloc(workers * sizeof(*out));
+	results = mem_alloc(workers * sizeof(*results));
+	pids = mem_alloc(workers * sizeof(*pids));
+
+	for (w = 0; w < workers; w++) {
+		if (!(out[w] = tmpfile()) || !(results[w] = tmpfile()))
+			pexit("tmpfile");
+		pids[w] = start_worker(w, workers, out[w], results[w]);
+	}
+
+/*
+ * A worker that exits before it is done with its files died (or was killed
+ * for taking too long) on the file after the last one it has a result for:
+ * record it as failed and restart the worker after it.
+ */
+	for (done = 0; done < workers; ) {
+		if ((pid = wait(&status)) < 0) {
+			if (errno == EINTR)
+				continue;
+			pexit("wait");
+		}
+		for (w = 0; w < workers; w++)
+		if (pids[w] == pid)
+			break;
+		if (w == workers)
+			continue;
+
+		i = w + result_count(fileno(results[w])) * workers;
+		if (i >= file_count) {
+			pids[w] = 0;
+			done++;
+			continue;
+		}
+
+		if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM)
+			fprintf(stderr, "%s: extraction timed out\n", files[i]);
+		else
+			fprintf(stderr, "%s: extraction failed\n", files[i]);
+		memset(&failed, 0, sizeof(failed));
+		failed.status = RESULT_FAILED;
+		if (fseek(results[w], 0, SEEK_END) ||
+		    fwrite(&failed, sizeof(failed), 1, results[w]) != 1 ||
+		    fflush(results[w]))
+			pexit("fwrite");
+
+		if ((i += workers) < file_count)
+			pids[w] = start_worker(i, workers, out[w], results[w]);
+		else {
+			pids[w] = 0;
+			done++;
+		}
+	}
+
+	memset(counts, 0, sizeof(counts));
+	result = mem_alloc(sizeof(*result));
+	for (i = 0; i < file_count; i++) {
+		w = i % workers;
+		if (pread(fileno(results[w]), result, sizeof(*result),
+		    (off_t)(i / workers) * sizeof(*result)) != sizeof(*result))
+			pexit("pread");
+		counts[result->status]++;
+		if (result->status != RESULT_OK || result->end <= result->start)
+			continue;
+		copy_output(output, fileno(out[w]), result);
+	}
+	MEM_FREE(result);
+
+	if (fflush(output) || (output != stdout && fclose(output)))
+		pexit("fclose");
+
+	fprintf(stderr, "%d files: %d processed, %d of unknown type, "
+		"%d failed\n", file_count, counts[RESULT_OK],
+		counts[RESULT_UNKNOWN], counts[RESULT_FAILED]);
+
+	return counts[RESULT_FAILED] ? 1 : 0;
+}
+
+#else
+
+int batch2john(int argc, char **argv)
+{
+	fprintf(stderr, "batch2john is not supported on this system\n");
+	return 1;
+}
+
+#endif
@@ -6,6 +6,9 @@
  */
 
 #define _XOPEN_SOURCE 500 /* for setitimer(2) */
+#ifdef __linux__
+#define _GNU_SOURCE /* for syscall(2) */
+#endif
 
 #if defined (__MINGW32__) || defined (_MSC_VER)
 #define SIGALRM SIGFPE
@@ -32,6 +35,12 @@
 #if !defined (__MINGW32__) && !defined (_MSC_VER)
 #include <sys/times.h>
 #endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#ifdef __NR_perf_event_open
+#include <linux/perf_event.h>
+#endif
+#endif
 
 #include "times.h"
 
@@ -46,6 +55,14 @@
 
 #ifndef _JOHN_BENCH_TMP
 #include "options.h"
+#include "loader.h"
+#include "cracker.h"
+#include "status.h"
+#ifdef NO_JOHN_BLD
+#define JOHN_BLD "unk-build-type"
+#else
+#include "john_build_rule.h"
+#endif
 #endif
 
 #ifdef HAVE_MPI
@@ -321,6 +338,545 @@ void gather_results(struct bench_results *results)
 }
 #endif
 
+#ifndef _JOHN_BENCH_TMP
+/*
+ * The --bench-db benchmark: the format's test vectors are turned into a
+ * synthetic database of options.bench_hashes hashes spread over
+ * options.bench_salts salts, and generated candidates are fed to it through
+ * the cracker just like in a real session.  The format's methods are
+ * wrapped so that we can tell where the time goes.
+ */
+#define BENCH_PHASE_SET_KEY		0
+#define BENCH_PHASE_SET_SALT		1
+#define BENCH_PHASE_CRYPT		2
+#define BENCH_PHASE_LOOKUP		3
+#define BENCH_PHASES			4
+
+static char *bench_phase_names[BENCH_PHASES] = {
+	"set_key", "set_salt", "crypt", "lookup"
+};
+
+struct bench_db_stats {
+/* Number of salts actually used (just one for a salt-less format) */
+	unsigned int salts;
+
+/* Time spent in each phase, in microseconds */
+	unsigned long long phase_time[BENCH_PHASES];
+
+/* Number of candidates tried, and of crypts done (candidates times salts) */
+	int64 keys, crypts;
+
+/* Hardware cache misses, or -1 if we couldn't count them */
+	long long cache_misses;
+};
+
+static struct fmt_methods bench_db_methods;
+static struct bench_db_stats *bench_db_stats;
+static unsigned long long bench_db_phase_start;
+static int bench_db_phase;
+
+static unsigned long long bench_db_usec(void)
+{
+#ifdef _MSC_VER
+	return (unsigned long long)clock() * 1000000 / CLOCKS_PER_SEC;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (unsigned long long)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+/*
+ * Reading the clock on every set_key() would cost more than some formats'
+ * set_key() itself, so we only do it when the phase changes.  Whatever the
+ * cracker does in between is charged to the phase it follows, so "lookup"
+ * is everything from crypt_all() returning to the next set_salt() or
+ * set_key(), including get_hash[], the hash table walk and cmp_*().
+ */
+static void bench_db_switch(int phase)
+{
+	unsigned long long now;
+
+	if (phase == bench_db_phase) return;
+
+	now = bench_db_usec();
+	if (bench_db_phase >= 0)
+		bench_db_stats->phase_time[bench_db_phase] +=
+			now - bench_db_phase_start;
+	bench_db_phase_start = now;
+	bench_db_phase = phase;
+}
+
+static void bench_db_set_salt(void *salt)
+{
+	bench_db_switch(BENCH_PHASE_SET_SALT);
+	bench_db_methods.set_salt(salt);
+}
+
+static void bench_db_set_key(char *key, int index)
+{
+	bench_db_switch(BENCH_PHASE_SET_KEY);
+	bench_db_methods.set_key(key, index);
+}
+
+static void bench_db_clear_keys(void)
+{
+	bench_db_switch(BENCH_PHASE_SET_KEY);
+	bench_db_methods.clear_keys();
+}
+
+static void bench_db_crypt_all(int count)
+{
+	bench_db_switch(BENCH_PHASE_CRYPT);
+	bench_db_methods.crypt_all(count);
+	bench_db_switch(BENCH_PHASE_LOOKUP);
+	add32to64(&bench_db_stats->crypts, count);
+}
+
+static void bench_db_crypt_all_salts(int count, void **salts, int salt_count)
+{
+	bench_db_switch(BENCH_PHASE_CRYPT);
+	bench_db_methods.crypt_all_salts(count, salts, salt_count);
+	bench_db_switch(BENCH_PHASE_LOOKUP);
+	add32to64(&bench_db_stats->crypts, count * salt_count);
+}
+
+/*
+ * Returns a file descriptor counting this process' cache misses from now
+ * on, or -1 if that's not supported here.  Threads already running (such
+ * as an OpenMP pool created by the self-test) are not counted.
+ */
+static int bench_db_misses_open(void)
+{
+#if defined(__linux__) && defined(__NR_perf_event_open)
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.inherit = 1;
+
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+	return -1;
+#endif
+}
+
+static long long bench_db_misses_close(int fd)
+{
+	long long count = -1;
+
+	if (fd < 0) return -1;
+#if defined(__linux__) && defined(__NR_perf_event_open)
+	if (read(fd, &count, sizeof(count)) != sizeof(count))
+		count = -1;
+	close(fd);
+#endif
+	return count;
+}
+
+#define BENCH_DB_ALIGN(size) \
+	(((size) + (MEM_ALIGN_WORD - 1)) & ~(size_t)(MEM_ALIGN_WORD - 1))
+
+static char *benchmark_db(struct fmt_main *format,
+	struct bench_results *results, struct bench_db_stats *stats)
+{
+	static char s_error[64];
+	struct fmt_main wrapped;
+	struct db_main db;
+	struct db_options db_options;
+	struct db_salt *salts, *salt;
+	struct db_password *pws, *pw;
+	struct fmt_tests *current;
+	char **sources, *where, *prepared, *ciphertext;
+	char *test_binaries, *test_salts, *binaries, *salt_copies, *p;
+	size_t binary_size, salt_size;
+	unsigned int ntests, nsalts, index, test, hash;
+	char key[PLAINTEXT_BUFFER_SIZE];
+	int length, pos, misses_fd;
+#if OS_TIMER
+	struct itimerval it;
+#endif
+	clock_t start_real, end_real;
+#if !defined (__MINGW32__) && !defined (_MSC_VER)
+	clock_t start_virtual, end_virtual;
+	struct tms buf;
+#endif
+
+	clk_tck_init();
+
+	if (!format->params.tests) return "FAILED (no data)";
+	if ((where = fmt_self_test(format))) {
+		sprintf(s_error, "FAILED (%s)", where);
+		return s_error;
+	}
+
+	binary_size = BENCH_DB_ALIGN(format->params.binary_size);
+	salt_size = BENCH_DB_ALIGN(format->params.salt_size);
+	if (!salt_size) salt_size = MEM_ALIGN_WORD;
+
+	nsalts = format->params.salt_size ? options.bench_salts : 1;
+
+	for (ntests = 0; format->params.tests[ntests].ciphertext; ntests++);
+
+/* Binaries and salts of the test vectors, as the loader would get them */
+	sources = mem_alloc(ntests * sizeof(char *));
+	test_binaries = mem_alloc(ntests * binary_size);
+	test_salts = mem_alloc(ntests * salt_size);
+	for (test = 0; test < ntests; test++) {
+		current = &format->params.tests[test];
+		current->flds[1] = current->ciphertext;
+		prepared = format->methods.prepare(current->flds, format);
+		ciphertext = format->methods.split(prepared, 0);
+		sources[test] = mem_alloc(strlen(ciphertext) + 1);
+		strcpy(sources[test], ciphertext);
+		memcpy(test_binaries + test * binary_size,
+			format->methods.binary(sources[test]),
+			format->params.binary_size);
+		memcpy(test_salts + test * salt_size,
+			format->methods.salt(sources[test]),
+			format->params.salt_size);
+	}
+
+/*
+ * Each salt is a copy of a test vector's salt (so they are only different
+ * up to the number of test vectors, but set_salt() gets a separate copy for
+ * each anyway).  The hashes are that test vector's binary with some bits
+ * flipped, so they spread over the hash table and are never cracked.
+ */
+	salts = mem_alloc(nsalts * sizeof(struct db_salt));
+	salt_copies = mem_alloc(nsalts * salt_size);
+	pws = mem_alloc(options.bench_hashes * sizeof(struct db_password));
+	binaries = mem_alloc(options.bench_hashes * binary_size);
+
+	memset(&db_options, 0, sizeof(db_options));
+	db_options.field_sep_char = ':';
+
+	memset(&db, 0, sizeof(db));
+	db.options = &db_options;
+	db.salts = salts;
+	db.salt_count = nsalts;
+	db.password_count = options.bench_hashes;
+
+	for (index = 0; index < nsalts; index++) {
+		salt = &salts[index];
+		test = index % ntests;
+		salt->next = (index + 1 < nsalts) ? &salts[index + 1] : NULL;
+		salt->salt = salt_copies + index * salt_size;
+		memcpy(salt->salt, test_salts + test * salt_size,
+			format->params.salt_size);
+		salt->list = NULL;
+		salt->count = 0;
+		salt->keys = NULL;
+	}
+
+	for (index = 0; index < options.bench_hashes; index++) {
+		unsigned int mix = (index + 1) * 0x9E3779B9;
+
+		salt = &salts[index % nsalts];
+		test = (index % nsalts) % ntests;
+		pw = &pws[index];
+		pw->binary = p = binaries + index * binary_size;
+		memcpy(p, test_binaries + test * binary_size, binary_size);
+		for (pos = 0; pos < format->params.binary_size; pos++) {
+			p[pos] ^= mix;
+			mix = (mix >> 8) | (mix << 24);
+		}
+		pw->source = sources[test];
+		pw->login = "bench";
+		pw->words = NULL;
+		pw->next = salt->list;
+		salt->list = pw;
+		salt->count++;
+	}
+
+/* Hash tables as ldr_fix_database() would set them up */
+	for (salt = salts; salt; salt = salt->next) {
+		salt->hash_size = ldr_hash_size(format, salt->count);
+		salt->index = fmt_dummy_hash;
+		salt->hash = &salt->list;
+		if (salt->hash_size < 0) continue;
+
+		salt->index = format->methods.get_hash[salt->hash_size];
+		salt->hash = mem_alloc(password_hash_sizes[salt->hash_size] *
+			sizeof(struct db_password *));
+		memset(salt->hash, 0, password_hash_sizes[salt->hash_size] *
+			sizeof(struct db_password *));
+		for (pw = salt->list; pw; pw = pw->next) {
+			hash = format->methods.binary_hash[salt->hash_size](
+				pw->binary);
+			pw->next_hash = salt->hash[hash];
+			salt->hash[hash] = pw;
+		}
+	}
+
+	memcpy(&wrapped, format, sizeof(wrapped));
+	memcpy(&bench_db_methods, &format->methods, sizeof(bench_db_methods));
+	wrapped.methods.set_salt = bench_db_set_salt;
+	wrapped.methods.set_key = bench_db_set_key;
+	wrapped.methods.clear_keys = bench_db_clear_keys;
+	wrapped.methods.crypt_all = bench_db_crypt_all;
+	if (format->methods.crypt_all_salts)
+		wrapped.methods.crypt_all_salts = bench_db_crypt_all_salts;
+	db.format = &wrapped;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->salts = nsalts;
+	bench_db_stats = stats;
+
+/* Candidates are all strings of printable ASCII of the benchmark length */
+	if ((length = format->params.plaintext_length) > 8)
+		length = 8;
+	if (length < 1)
+		length = 1;
+	memset(key, 'a', length);
+	key[length] = 0;
+
+	bench_db_phase = -1;
+	status_init(NULL, 1);
+	db.loaded = 1;
+	crk_init(&db, NULL, NULL);
+
+#if OS_TIMER
+	memset(&it, 0, sizeof(it));
+	if (setitimer(ITIMER_REAL, &it, NULL)) pexit("setitimer");
+#endif
+
+	bench_running = 1;
+	signal(SIGALRM, bench_handle_timer);
+
+	if (benchmark_time > 3600)
+		benchmark_time = 3600;
+
+#if OS_TIMER
+	if (!(it.it_value.tv_sec = benchmark_time)) {
+		if ((it.it_value.tv_usec = 1000000 / clk_tck) < 1000)
+			it.it_value.tv_usec = 1000; /* 1 ms */
+	}
+	if (setitimer(ITIMER_REAL, &it, NULL)) pexit("setitimer");
+#else
+	sig_timer_emu_init(benchmark_time * clk_tck);
+#endif
+
+	misses_fd = bench_db_misses_open();
+
+#if defined (__MINGW32__) || defined (_MSC_VER)
+	start_real = clock();
+#else
+	start_real = times(&buf);
+	start_virtual = buf.tms_utime + buf.tms_stime;
+	start_virtual += buf.tms_cutime + buf.tms_cstime;
+#endif
+	bench_db_phase = BENCH_PHASE_SET_KEY;
+	bench_db_phase_start = bench_db_usec();
+
+	do {
+		if (crk_process_key(key)) break;
+		add32to64(&stats->keys, 1);
+
+		pos = length - 1;
+		while (++key[pos] > 0x7e) {
+			key[pos] = 0x20;
+			if (--pos < 0) break;
+		}
+#if !OS_TIMER
+		sig_timer_emu_tick();
+#endif
+	} while (bench_running && !event_abort);
+
+	crk_done();
+	bench_db_switch(-1);
+
+#if defined (__MINGW32__) || defined (_MSC_VER)
+	end_real = clock();
+#else
+	end_real = times(&buf);
+	if (end_real == start_real) end_real++;
+
+	end_virtual = buf.tms_utime + buf.tms_stime;
+	end_virtual += buf.tms_cutime + buf.tms_cstime;
+	if (end_virtual == start_virtual) end_virtual++;
+	results->virtual = end_virtual - start_virtual;
+#endif
+	results->real = end_real - start_real;
+	results->count = stats->crypts;
+
+	stats->cache_misses = bench_db_misses_close(misses_fd);
+
+	for (salt = salts; salt; salt = salt->next)
+	if (salt->hash != &salt->list)
+		MEM_FREE(salt->hash);
+	MEM_FREE(binaries);
+	MEM_FREE(pws);
+	MEM_FREE(salt_copies);
+	MEM_FREE(salts);
+	for (test = 0; test < ntests; test++)
+		MEM_FREE(sources[test]);
+	MEM_FREE(test_salts);
+	MEM_FREE(test_binaries);
+	MEM_FREE(sources);
+
+	return event_abort ? "" : NULL;
+}
+
+static void benchmark_db_print(FILE *out, char *kind,
+	struct bench_results *results, struct bench_db_stats *stats)
+{
+	char s_real[64], s_virtual[64], s_keys[64];
+	unsigned long long total;
+	double crypts;
+	int phase;
+
+	benchmark_cps(&results->count, results->real, s_real);
+	benchmark_cps(&results->count, results->virtual, s_virtual);
+	benchmark_cps(&stats->keys, results->real, s_keys);
+	fprintf(out, "%s:\t%s c/s real, %s c/s virtual, %s p/s real\n",
+		kind, s_real, s_virtual, s_keys);
+
+	total = 0;
+	for (phase = 0; phase < BENCH_PHASES; phase++)
+		total += stats->phase_time[phase];
+	if (!total) total = 1;
+	fprintf(out, "Phases:\t");
+	for (phase = 0; phase < BENCH_PHASES; phase++)
+		fprintf(out, "%s %.1f%%%s", bench_phase_names[phase],
+			100.0 * stats->phase_time[phase] / total,
+			phase < BENCH_PHASES - 1 ? ", " : "\n");
+
+	crypts = stats->crypts.hi * 4294967296.0 + stats->crypts.lo;
+	if (stats->cache_misses < 0)
+		fputs("Cache misses:\tn/a\n\n", out);
+	else
+		fprintf(out, "Cache misses:\t%lld (%.2f per crypt)\n\n",
+			stats->cache_misses,
+			crypts ? stats->cache_misses / crypts : 0.0);
+}
+
+/*
+ * Machine readable --test results (--bench-output), one record per line on
+ * stdout.  The human readable output then goes to stderr.  The "name" and
+ * "kind" fields are what relbench uses to match up benchmarks, so that a
+ * CSV or JSON run can be compared against a plain text one and vice versa.
+ */
+#define BENCH_CSV_HEADER \
+	"label,name,algorithm,kind,hashes,salts,real_cps,virtual_cps," \
+	"threads,mpi,keys_per_crypt,simd,build,compiler," \
+	"candidate_cps,set_key,set_salt,crypt,lookup,cache_misses"
+
+static int bench_json, bench_fields;
+
+static void bench_field(char *name)
+{
+	if (bench_fields++)
+		putchar(',');
+	if (bench_json)
+		printf("\"%s\":", name);
+}
+
+static void bench_field_str(char *name, char *value)
+{
+	bench_field(name);
+	putchar('"');
+	while (*value) {
+		if (*value == '"')
+			fputs(bench_json ? "\\\"" : "\"\"", stdout);
+		else
+		if (bench_json && *value == '\\')
+			fputs("\\\\", stdout);
+		else
+		if (bench_json && (unsigned char)*value < 0x20)
+			printf("\\u%04x", (unsigned char)*value);
+		else
+			putchar(*value);
+		value++;
+	}
+	putchar('"');
+}
+
+static void bench_field_num(char *name, double value, int valid)
+{
+	bench_field(name);
+	if (valid)
+		printf("%.10g", value);
+	else
+	if (bench_json)
+		fputs("null", stdout);
+}
+
+static double bench_cps(int64 *count, clock_t time)
+{
+	return (count->hi * 4294967296.0 + count->lo) * clk_tck / time;
+}
+
+static void benchmark_record(struct fmt_main *format, char *kind,
+	unsigned int hashes, unsigned int salts,
+	struct bench_results *results, int threads,
+	struct bench_db_stats *stats)
+{
+	char name[128];
+	unsigned long long total;
+	int phase, mpi = 1, virtual = 1;
+
+#ifdef HAVE_MPI
+	mpi = mpi_p;
+#endif
+#if defined(__DJGPP__) || defined(__BEOS__) || defined(__MINGW32__) || defined (_MSC_VER)
+	virtual = 0;
+#endif
+
+	bench_fields = 0;
+	if (bench_json)
+		putchar('{');
+
+	snprintf(name, sizeof(name), "%s%s", format->params.format_name,
+		format->params.benchmark_comment);
+	bench_field_str("label", format->params.label);
+	bench_field_str("name", name);
+	bench_field_str("algorithm", format->params.algorithm_name);
+	bench_field_str("kind", kind);
+	bench_field_num("hashes", hashes, 1);
+	bench_field_num("salts", salts, 1);
+	bench_field_num("real_cps", bench_cps(&results->count, results->real),
+		1);
+	bench_field_num("virtual_cps",
+		bench_cps(&results->count, results->virtual), virtual);
+	bench_field_num("threads", threads, 1);
+	bench_field_num("mpi", mpi, 1);
+	bench_field_num("keys_per_crypt", format->params.max_keys_per_crypt, 1);
+#ifdef MMX_COEF
+	bench_field_num("simd", MMX_COEF, 1);
+#else
+	bench_field_num("simd", 0, 1);
+#endif
+	bench_field_str("build", JOHN_BLD);
+#ifdef __VERSION__
+	bench_field_str("compiler", __VERSION__);
+#else
+	bench_field_str("compiler", "");
+#endif
+
+	total = 0;
+	if (stats)
+	for (phase = 0; phase < BENCH_PHASES; phase++)
+		total += stats->phase_time[phase];
+	bench_field_num("candidate_cps",
+		stats ? bench_cps(&stats->keys, results->real) : 0, stats != NULL);
+	for (phase = 0; phase < BENCH_PHASES; phase++)
+		bench_field_num(bench_phase_names[phase],
+			total ? 100.0 * stats->phase_time[phase] / total : 0,
+			total != 0);
+	bench_field_num("cache_misses", stats ? stats->cache_misses : 0,
+		stats && stats->cache_misses >= 0);
+
+	puts(bench_json ? "}" : "");
+	fflush(stdout);
+}
+#endif
+
 int benchmark_all(void)
 {
 	struct fmt_main *format;
@@ -328,6 +884,12 @@ int benchmark_all(void)
 	struct bench_results results_1, results_m;
 	char s_real[64], s_virtual[64];
 	unsigned int total, failed;
+	FILE *out = stdout;
+#ifndef _JOHN_BENCH_TMP
+	struct bench_db_stats stats;
+	char s_kind[64];
+	int threads = 1;
+#endif
 #ifdef _OPENMP
 	int ompt;
 	int ompt_start = omp_get_max_threads();
@@ -336,9 +898,18 @@ int benchmark_all(void)
 #endif
 #endif
 
+#ifndef _JOHN_BENCH_TMP
+	if (options.bench_output) {
+		out = stderr;
+		bench_json = !strcmp(options.bench_output, "json");
+		if (!bench_json)
+			puts(BENCH_CSV_HEADER);
+	}
+#endif
+
 	if (!benchmark_time)
-		puts("Warning: doing quick benchmarking - "
-		    "the performance numbers will be inaccurate");
+		fputs("Warning: doing quick benchmarking - "
+		    "the performance numbers will be inaccurate\n", out);
 
 	total = failed = 0;
 #ifndef _JOHN_BENCH_TMP
@@ -357,11 +928,11 @@ int benchmark_all(void)
 				continue;
 			else {
 				if (format->params.flags & FMT_UNICODE) {
-					printf("The %s format does not yet support UTF-8 conversion.\n\n", format->params.label);
+					fprintf(out, "The %s format does not yet support UTF-8 conversion.\n\n", format->params.label);
 					continue;
 				}
 				else {
-					printf("The %s format does not use internal charset conversion (--encoding=utf8 option).\n\n", format->params.label);
+					fprintf(out, "The %s format does not use internal charset conversion (--encoding=utf8 option).\n\n", format->params.label);
 					continue;
 				}
 			}
@@ -376,12 +947,12 @@ int benchmark_all(void)
 				ompt_start = 1;
 				if(cfg_get_bool(SECTION_OPTIONS, SUBSECTION_MPI, "MPIOMPverbose", 1) &&
 				   mpi_id == 0) {
-					printf("MPI in use, disabling OMP (see doc/README.mpi)\n\n");
+					fprintf(out, "MPI in use, disabling OMP (see doc/README.mpi)\n\n");
 				}
 			} else {
 				if(cfg_get_bool(SECTION_OPTIONS, SUBSECTION_MPI, "MPIOMPverbose", 1) &&
 				   mpi_id == 0) {
-					printf("Note: Running both MPI and OMP (see doc/README.mpi)\n\n");
+					fprintf(out, "Note: Running both MPI and OMP (see doc/README.mpi)\n\n");
 				}
 			}
 		}
@@ -390,9 +961,12 @@ int benchmark_all(void)
 #ifdef _OPENMP
 		// format's init() or MPIOMPmutex may have capped the number of threads
 		ompt = omp_get_max_threads();
+#ifndef _JOHN_BENCH_TMP
+		threads = (format->params.flags & FMT_OMP) ? ompt : 1;
+#endif
 #endif /* _OPENMP */
 
-		printf("Benchmarking: %s%s [%s]%s... ",
+		fprintf(out, "Benchmarking: %s%s [%s]%s... ",
 			format->params.format_name,
 			format->params.benchmark_comment,
 			format->params.algorithm_name,
@@ -401,30 +975,30 @@ int benchmark_all(void)
 #else
 			"");
 #endif
-		fflush(stdout);
+		fflush(out);
 
 #ifdef HAVE_MPI
 		if (mpi_p > 1) {
-			printf("(%uxMPI", mpi_p);
+			fprintf(out, "(%uxMPI", mpi_p);
 #ifdef _OPENMP
 			if (format->params.flags & FMT_OMP) {
 				if (ompt > 1)
-					printf(", %dxOMP", ompt);
+					fprintf(out, ", %dxOMP", ompt);
 			}
 #endif /* _OPENMP */
-			printf(") ");
+			fprintf(out, ") ");
 #ifdef _OPENMP
 		} else {
 			if (format->params.flags & FMT_OMP && ompt > 1)
-				printf("(%dxOMP) ", ompt);
+				fprintf(out, "(%dxOMP) ", ompt);
 #endif /* _OPENMP */
 		}
-		fflush(stdout);
+		fflush(out);
 #else /* HAVE_MPI */
 #ifdef _OPENMP
 		if (format->params.flags & FMT_OMP && ompt > 1)
-			printf("(%dxOMP) ", ompt);
-		fflush(stdout);
+			fprintf(out, "(%dxOMP) ", ompt);
+		fflush(out);
 #endif /* _OPENMP */
 #endif /* HAVE_MPI */
 		switch (format->params.benchmark_length) {
@@ -450,22 +1024,51 @@ int benchmark_all(void)
 
 		total++;
 
+#ifndef _JOHN_BENCH_TMP
+		if (options.bench_hashes) {
+			if ((result = benchmark_db(format, &results_m,
+			    &stats))) {
+				fprintf(out, "%s\n", result);
+				failed++;
+				continue;
+			}
+
+			fputs("DONE\n", out);
+#ifdef _OPENMP
+			omp_set_num_threads(ompt_start);
+#endif
+#ifdef HAVE_MPI
+			if (mpi_p > 1)
+				gather_results(&results_m);
+#endif
+			sprintf(s_kind, "%u hashes, %u salt%s",
+			    options.bench_hashes, stats.salts,
+			    stats.salts == 1 ? "" : "s");
+			benchmark_db_print(out, s_kind, &results_m, &stats);
+			if (options.bench_output)
+				benchmark_record(format, s_kind,
+				    options.bench_hashes, stats.salts,
+				    &results_m, threads, &stats);
+			continue;
+		}
+#endif
+
 		if ((result = benchmark_format(format,
 		    format->params.salt_size ? BENCHMARK_MANY : 1,
 		    &results_m))) {
-			puts(result);
+			fprintf(out, "%s\n", result);
 			failed++;
 			continue;
 		}
 
 		if (msg_1)
 		if ((result = benchmark_format(format, 1, &results_1))) {
-			puts(result);
+			fprintf(out, "%s\n", result);
 			failed++;
 			continue;
 		}
 
-		puts("DONE");
+		fputs("DONE\n", out);
 #ifdef _OPENMP
 		// reset this in case format capped it (we may be running more formats)
 		omp_set_num_threads(ompt_start);
@@ -476,35 +1079,45 @@ int benchmark_all(void)
 			gather_results(&results_m);
 			gather_results(&results_1);
 		}
+#endif
+#ifndef _JOHN_BENCH_TMP
+		if (options.bench_output) {
+			benchmark_record(format, msg_m, 1,
+			    strcmp(msg_m, "Many salts") ? 1 : BENCHMARK_MANY,
+			    &results_m, threads, NULL);
+			if (msg_1)
+				benchmark_record(format, msg_1, 1, 1,
+				    &results_1, threads, NULL);
+		}
 #endif
 		benchmark_cps(&results_m.count, results_m.real, s_real);
 		benchmark_cps(&results_m.count, results_m.virtual, s_virtual);
 #if !defined(__DJGPP__) && !defined(__BEOS__) && !defined(__MINGW32__) && !defined (_MSC_VER)
-		printf("%s:\t%s c/s real, %s c/s virtual\n",
+		fprintf(out, "%s:\t%s c/s real, %s c/s virtual\n",
 			msg_m, s_real, s_virtual);
 #else
-		printf("%s:\t%s c/s\n",
+		fprintf(out, "%s:\t%s c/s\n",
 			msg_m, s_real);
 #endif
 
 		if (!msg_1) {
-			putchar('\n');
+			fputc('\n', out);
 			continue;
 		}
 
 		benchmark_cps(&results_1.count, results_1.real, s_real);
 		benchmark_cps(&results_1.count, results_1.virtual, s_virtual);
 #if !defined(__DJGPP__) && !defined(__BEOS__) && !defined(__MINGW32__) && !defined (_MSC_VER)
-		printf("%s:\t%s c/s real, %s c/s virtual\n\n",
+		fprintf(out, "%s:\t%s c/s real, %s c/s virtual\n\n",
 			msg_1, s_real, s_virtual);
 #else
-		printf("%s:\t%s c/s\n\n",
+		fprintf(out, "%s:\t%s c/s\n\n",
 			msg_1, s_real);
 #endif
 	} while ((format = format->next) && !event_abort);
 
 	if (failed && total > 1 && !event_abort)
-		printf("%u out of %u tests have FAILED\n", failed, total);
+		fprintf(out, "%u out of %u tests have FAILED\n", failed, total);
 
 	return failed || event_abort;
 }
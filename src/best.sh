@@ -110,22 +110,28 @@ else
 	BF_SCALE=0
 fi
 
-./detect $DES_BEST $DES_COPY $DES_BS $MD5_X2 $MD5_IMM $BF_SCALE 1 > arch.h
-rm -f $BF_DEPEND bench
+# Number of hashes to interleave, 1 for none
 
-echo "Compiling: Blowfish benchmark (two hashes at a time)"
-$MAKE bench || exit 1
-RES=`./bench 3` || exit 1
-if [ $RES -gt $MAX ]; then
-	BF_X2=1
-else
-	BF_X2=0
-fi
+BF_X=1
+
+for X in 2 3 4 6 8; do
+	./detect $DES_BEST $DES_COPY $DES_BS $MD5_X2 $MD5_IMM $BF_SCALE $X \
+		> arch.h
+	rm -f $BF_DEPEND bench
+
+	echo "Compiling: Blowfish benchmark ($X hashes at a time)"
+	$MAKE bench || exit 1
+	RES=`./bench 3` || exit 1
+	if [ $RES -gt $MAX ]; then
+		MAX=$RES
+		BF_X=$X
+	fi
+done
 
 # Produce generic.h, make sure everything is rebuilt with detected options,
 # and do some cleanup
 
-./detect $DES_BEST $DES_COPY $DES_BS $MD5_X2 $MD5_IMM $BF_SCALE $BF_X2 \
+./detect $DES_BEST $DES_COPY $DES_BS $MD5_X2 $MD5_IMM $BF_SCALE $BF_X \
 	> generic.h
 rm -f $DES_DEPEND $DES_BS_DEPEND $MD5_DEPEND $BF_DEPEND \
 	bench detect best.o detect.o arch.h
@@ -3,177 +3,395 @@
 #if !defined (_MSC_VER)
 #include <unistd.h>
 #endif
+#if !defined (_MSC_VER) && !defined (__MINGW32__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#define CALC_STAT_MMAP
+#endif
 #include <math.h>
 #include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "memory.h"
 
+#if defined (__MINGW32__) || defined (_MSC_VER)
+#define LLu "%I64u"
+#else
+#define LLu "%llu"
+#endif
+
 #define C2I(c) ((unsigned int)(unsigned char)(c))
 
-unsigned int * proba1;
-unsigned int * proba2;
-unsigned int * first;
+/*
+ * Raw counts: the number of lines, of each first character and of each
+ * pair of adjacent characters.  Each thread counts its part of the input
+ * into its own set, and these are added up afterwards.
+ */
+struct counts {
+	unsigned long long lines;
+	unsigned long long proba1[256];
+	unsigned long long proba2[256*256];
+};
 
-int main(int argc, char * * argv)
+/* Size of the blocks read when the input can't be mapped */
+#define BLOCK_SIZE	(64 << 20)
+
+#define MAX_MERGE	16
+
+static int npflag;
+static int weighted;
+
+static void usage(char * name)
 {
-	FILE * fichier;
-	char * ligne;
-	int i;
-	int j;
+	fprintf(stderr, "Usage: %s [-p] [-w] [-m countfile]... [-s countfile] dictionnary_file statfile\n"
+	        "\t-p: include non printable and 8-bit characters\n"
+	        "\t-w: each line starts with its number of occurrences (as from \"uniq -c\")\n"
+	        "\t-m: add the counts saved with -s by a previous run\n"
+	        "\t-s: save the raw counts, for merging with -m later\n", name);
+	exit(-1);
+}
+
+static void count_line(struct counts * c, unsigned char * ligne, size_t len,
+                       unsigned long long offset)
+{
+	unsigned long long weight = 1;
+	size_t i;
 	int np;
-	int npflag;
-	int args;
-	unsigned int nb_lignes;
-	unsigned int nb_lettres;
 
-	FILE * statfile;
+	while( (len>0) && ((ligne[len-1]=='\n') || (ligne[len-1]=='\r')) )
+		len--;
 
-	if( (argc!=3) && (argc!=4) )
+	if(weighted)
 	{
-		fprintf(stderr, "Usage: %s [-p] dictionnary_file statfile\n\t-p: include non printable and 8-bit characters\n", argv[0]);
-		return -1;
+		for(i=0;(i<len) && ((ligne[i]==' ') || (ligne[i]=='\t'));i++);
+		if( (i==len) || (ligne[i]<'0') || (ligne[i]>'9') )
+		{
+			fprintf(stderr, "Warning, no count at offset "LLu", skipped: %.*s\n",
+			        offset, (int)len, ligne);
+			return;
+		}
+		for(weight=0;(i<len) && (ligne[i]>='0') && (ligne[i]<='9');i++)
+			weight = weight*10 + (ligne[i]-'0');
+		if( (i<len) && ((ligne[i]==' ') || (ligne[i]=='\t')) )
+			i++;
+		ligne += i;
+		len -= i;
+		offset += i;
+	}
+
+	c->lines += weight;
+
+	for(i=0;(i<len) && ligne[i];i++)
+	{
+		np = 0;
+		if (!npflag) {
+			if(C2I(ligne[i])<32)
+			{
+				fprintf(stderr,
+				        "Warning, skipping non printable character 0x%02x offset "LLu": %.*s\n",
+				        ligne[i], offset + i, (int)len, ligne);
+				np += 1;
+			}
+			if(C2I(ligne[i])>127)
+			{
+				fprintf(stderr,
+				        "Warning, skipping non-ASCII character 0x%02x offset "LLu": %.*s\n",
+				        ligne[i], offset + i, (int)len, ligne);
+				np += 1;
+			}
+			if((i>0) && (C2I(ligne[i-1])<32))
+			{
+				np += 2;
+			}
+			if((i>0) && (C2I(ligne[i-1])>127))
+			{
+				np += 2;
+			}
+		}
+		if( (i==0) && ((np == 0) || (npflag == 1)) )
+			c->proba1[C2I(ligne[0])] += weight;
+		if( (i>0) && ((np == 0) || (npflag == 1)) )
+			c->proba2[C2I(ligne[i-1])*256 + C2I(ligne[i])] += weight;
+	}
+}
+
+/*
+ * Each thread gets the lines which start in its share of the buffer.
+ */
+static size_t line_start(unsigned char * buf, size_t size, size_t pos)
+{
+	while( (pos>0) && (pos<size) && (buf[pos-1]!='\n') )
+		pos++;
+	return pos;
+}
+
+static void count_buffer(struct counts * thr, int nthreads,
+                         unsigned char * buf, size_t size,
+                         unsigned long long base)
+{
+	int t;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1)
+#endif
+	for(t=0;t<nthreads;t++)
+	{
+		size_t start = line_start(buf, size, size / nthreads * t);
+		size_t end = (t == nthreads-1) ? size :
+		    line_start(buf, size, size / nthreads * (t+1));
+		unsigned char * p;
+
+		while(start<end)
+		{
+			p = memchr(buf+start, '\n', end-start);
+			p = p ? p+1 : buf+end;
+			count_line(&thr[t], buf+start, p-(buf+start), base+start);
+			start = p-buf;
+		}
+	}
+}
+
+static void count_file(char * name, struct counts * thr, int nthreads)
+{
+	FILE * fichier;
+	unsigned char * buf;
+	unsigned long long base;
+	size_t size, keep, got;
+#ifdef CALC_STAT_MMAP
+	struct stat st;
+	int fd;
+
+	if( (fd = open(name, O_RDONLY)) >= 0 && !fstat(fd, &st) &&
+	    S_ISREG(st.st_mode) && st.st_size > 0 && (size_t)st.st_size == st.st_size )
+	{
+		buf = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if(buf != MAP_FAILED)
+		{
+			close(fd);
+#ifdef MADV_SEQUENTIAL
+			madvise(buf, st.st_size, MADV_SEQUENTIAL);
+#endif
+			count_buffer(thr, nthreads, buf, st.st_size, 0);
+			munmap(buf, st.st_size);
+			return;
+		}
+	}
+	if(fd >= 0)
+		close(fd);
+#endif
+
+	fichier = fopen(name, "rb");
+	if(!fichier)
+	{
+		fprintf(stderr, "could not open %s\n", name);
+		exit(-1);
 	}
 
-	if(argc==4)
+	buf = malloc(BLOCK_SIZE);
+	if(!buf)
+	{
+		fprintf(stderr, "could not allocate memory\n");
+		exit(-1);
+	}
+	base = 0;
+	keep = 0;
+	while( (got = fread(buf+keep, 1, BLOCK_SIZE-keep, fichier)) > 0 || keep )
 	{
-		if(strcmp(argv[1], "-p"))
+		size = keep + got;
+		/* Leave an incomplete last line for the next block, unless
+		   that's all there is */
+		if(got && size == BLOCK_SIZE)
 		{
-			fprintf(stderr, "Usage: %s [-p] dictionnary_file statfile\n\t-p: include non printable and 8-bit characters\n", argv[0]);
-			return -1;
+			for(keep=0;(keep<size) && (buf[size-keep-1]!='\n');keep++);
+			if(keep==size)
+				keep = 0;
 		}
-		args = 1;
-		npflag = 1;
+		else
+			keep = 0;
+		count_buffer(thr, nthreads, buf, size-keep, base);
+		base += size-keep;
+		memmove(buf, buf+size-keep, keep);
+		if(!got)
+			break;
+	}
+	if(ferror(fichier))
+	{
+		fprintf(stderr, "could not read %s\n", name);
+		exit(-1);
 	}
-	else
+	fclose(fichier);
+	MEM_FREE(buf);
+}
+
+static void merge_counts(char * name, struct counts * total)
+{
+	FILE * fichier;
+	char ligne[128];
+	unsigned long long n;
+	int i, j;
+
+	fichier = fopen(name, "r");
+	if(!fichier)
+	{
+		fprintf(stderr, "could not open %s\n", name);
+		exit(-1);
+	}
+	while(fgets(ligne, sizeof(ligne), fichier))
 	{
-		args = 0;
-		npflag = 0;
+		if( sscanf(ligne, LLu"=count2[%d*256+%d]", &n, &i, &j) == 3 &&
+		    i>=0 && i<256 && j>=0 && j<256 )
+			total->proba2[i*256 + j] += n;
+		else if( sscanf(ligne, LLu"=count1[%d]", &n, &i) == 2 &&
+		    i>=0 && i<256 )
+			total->proba1[i] += n;
+		else if( sscanf(ligne, LLu"=lines", &n) == 1 )
+			total->lines += n;
+		else
+			fprintf(stderr, "invalid line in %s: %s", name, ligne);
 	}
+	fclose(fichier);
+}
 
-	fichier = fopen(argv[1+args], "r");
+static void save_counts(char * name, struct counts * total)
+{
+	FILE * fichier;
+	int i, j;
+
+	fichier = fopen(name, "w");
 	if(!fichier)
 	{
-		fprintf(stderr, "could not open %s\n", argv[1+args]);
+		fprintf(stderr, "could not open %s\n", name);
+		exit(-1);
+	}
+	fprintf(fichier, LLu"=lines\n", total->lines);
+	for(i=0;i<256;i++)
+		if(total->proba1[i])
+			fprintf(fichier, LLu"=count1[%d]\n", total->proba1[i], i);
+	for(i=0;i<256;i++)
+		for(j=0;j<256;j++)
+			if(total->proba2[i*256 + j])
+				fprintf(fichier, LLu"=count2[%d*256+%d]\n", total->proba2[i*256 + j], i, j);
+	if(fclose(fichier))
+	{
+		fprintf(stderr, "could not write %s\n", name);
+		exit(-1);
+	}
+}
+
+int main(int argc, char * * argv)
+{
+	struct counts * thr;
+	struct counts * total;
+	char * merge[MAX_MERGE];
+	char * save = NULL;
+	int nmerge = 0;
+	int nthreads = 1;
+	int i;
+	int j;
+	int t;
+	unsigned int proba;
+	unsigned long long nb_lignes;
+	unsigned long long nb_lettres;
+
+	FILE * statfile;
+
+	npflag = 0;
+	weighted = 0;
+	for(i=1;(i<argc) && (argv[i][0]=='-') && argv[i][1];i++)
+	{
+		if(!strcmp(argv[i], "-p"))
+			npflag = 1;
+		else if(!strcmp(argv[i], "-w"))
+			weighted = 1;
+		else if(!strcmp(argv[i], "-m") && (i+1<argc) && (nmerge<MAX_MERGE))
+			merge[nmerge++] = argv[++i];
+		else if(!strcmp(argv[i], "-s") && (i+1<argc))
+			save = argv[++i];
+		else
+			usage(argv[0]);
+	}
+	if(argc-i != 2)
+		usage(argv[0]);
+
+#ifdef _OPENMP
+	nthreads = omp_get_max_threads();
+#endif
+	thr = calloc(nthreads, sizeof(struct counts));
+	total = calloc(1, sizeof(struct counts));
+	if(!thr || !total)
+	{
+		fprintf(stderr, "could not allocate memory\n");
 		return -1;
 	}
 
-	first = malloc( sizeof(unsigned int) * 256 );
+	count_file(argv[i], thr, nthreads);
 
-	ligne = malloc(4096);
+	for(t=0;t<nthreads;t++)
+	{
+		total->lines += thr[t].lines;
+		for(j=0;j<256;j++)
+			total->proba1[j] += thr[t].proba1[j];
+		for(j=0;j<256*256;j++)
+			total->proba2[j] += thr[t].proba2[j];
+	}
+	MEM_FREE(thr);
 
-	proba2 = malloc(sizeof(unsigned int) * 256 * 256);
-	proba1 = malloc(sizeof(unsigned int) * 256 );
-	memset(proba2, 0, sizeof(unsigned int) * 256 * 256);
-	memset(proba1, 0, sizeof(unsigned int) * 256 );
+	for(t=0;t<nmerge;t++)
+		merge_counts(merge[t], total);
 
-	statfile = fopen(argv[2+args], "w");
+	if(save)
+		save_counts(save, total);
 
-	nb_lignes = 0;
-	while(fgets(ligne, 4096, fichier))
+	statfile = fopen(argv[i+1], "w");
+	if(!statfile)
 	{
-		if (ligne[0] == 0)
-			continue;
-		i = strlen(ligne)-1;
-		while( (i>0) && ((ligne[i]=='\n') || (ligne[i]=='\r')) )
-		{
-			ligne[i]=0;
-			i--;
-		}
-		for(i=0;ligne[i];i++)
-		{
-			np = 0;
-			if (!npflag) {
-				if(C2I(ligne[i])<32)
-				{
-					fprintf(stderr,
-					        "Warning, skipping non printable character 0x%02x line %d offset %d: %s\n",
-					        (unsigned char)ligne[i], nb_lignes, i, ligne);
-					np += 1;
-				}
-				if(C2I(ligne[i])>127)
-				{
-					fprintf(stderr,
-					        "Warning, skipping non-ASCII character 0x%02x line %d offset %d: %s\n",
-					        (unsigned char)ligne[i], nb_lignes, i, ligne);
-					np += 1;
-				}
-				if((i>0) && (C2I(ligne[i-1])<32))
-				{
-					np += 2;
-				}
-				if((i>0) && (C2I(ligne[i-1])>127))
-				{
-					np += 2;
-				}
-			}
-			if( (i==0) && ((np == 0) || (npflag == 1)) )
-				proba1[C2I(ligne[0])]++;
-			if( (i>0) && ((np == 0) || (npflag == 1)) )
-				proba2[C2I(ligne[i-1])*256 + C2I(ligne[i])]++;
-		}
-		nb_lignes++;
+		fprintf(stderr, "could not open %s\n", argv[i+1]);
+		return -1;
 	}
 
+	nb_lignes = total->lines;
 	for(i=0;i<256;i++)
 	{
-		if ( (proba1[i] == 0 ) || (i==0) )
-		{
-			proba1[i] = 1000;
-		}
-		else
+		if ( (total->proba1[i] != 0 ) && (i!=0) )
 		{
-			if( (unsigned int) (- 10*log( (double) proba1[i] / (double) nb_lignes )) == 0)
+			proba = (unsigned int) (- 10*log( (double) total->proba1[i] / (double) nb_lignes ));
+			if(proba == 0)
 			{
-				fprintf(stderr, "zero -10*log proba1[%d] (%d) / %d converted to 1\n", i, proba1[i], nb_lignes);
-				proba1[i] = 1;
+				fprintf(stderr, "zero -10*log proba1[%d] ("LLu") / "LLu" converted to 1\n", i, total->proba1[i], nb_lignes);
+				proba = 1;
 			}
-			else
-				proba1[i] = (unsigned int) (- 10*log( (double) proba1[i] / (double) nb_lignes ));
-			fprintf(statfile, "%d=proba1[%d]\n", proba1[i], i);
+			fprintf(statfile, "%d=proba1[%d]\n", proba, i);
 		}
 
 		/* premiere passe : nb lettres */
 		nb_lettres = 0;
 		for(j=0;j<256;j++)
 		{
-			nb_lettres += proba2[i*256 + j];
+			nb_lettres += total->proba2[i*256 + j];
 		}
 
-		first[i] = 255;
-
 		/* maintenant, calcul des stats */
 		for(j=0;j<256;j++)
 		{
-			if( proba2[i*256 + j] == 0 )
-			{
-				proba2[i*256 + j] = 1000;
-			}
-			else
+			if( total->proba2[i*256 + j] != 0 )
 			{
-				if(first[i] == 255)
-					first[i] = j;
-				if((unsigned int) (- 10*log( (double) proba2[i*256+j] / (double) nb_lettres )) == 0)
-				{
-					fprintf(stderr, "zero -10*log proba2[%d*256+%d] (%d) / %d, converted to 1 to prevent infinite length candidates\n", i, j, proba2[i*256+j],nb_lettres );
-					proba2[i*256 + j] = 1;
-				}
-				else
+				proba = (unsigned int) (- 10*log( (double) total->proba2[i*256+j] / (double) nb_lettres ));
+				if(proba == 0)
 				{
-					proba2[i*256 + j] = (unsigned int) (- 10*log( (double) proba2[i*256+j] / (double) nb_lettres ));
+					fprintf(stderr, "zero -10*log proba2[%d*256+%d] ("LLu") / "LLu", converted to 1 to prevent infinite length candidates\n", i, j, total->proba2[i*256+j], nb_lettres);
+					proba = 1;
 				}
-				fprintf(statfile, "%d=proba2[%d*256+%d]\n", proba2[i*256+j], i, j);
+				fprintf(statfile, "%d=proba2[%d*256+%d]\n", proba, i, j);
 			}
 		}
 	}
 
 	fclose(statfile);
 
-	MEM_FREE(proba1);
-	MEM_FREE(proba2);
-
-	MEM_FREE(first);
-
-	MEM_FREE(ligne);
-	fclose(fichier);
+	MEM_FREE(total);
 
 	return 0;
 }
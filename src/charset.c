@@ -25,6 +25,8 @@
 #include "signals.h"
 #include "loader.h"
 #include "external.h"
+#include "options.h"
+#include "config.h"
 #include "charset.h"
 
 typedef unsigned int (*char_counters)
@@ -35,38 +37,154 @@ typedef unsigned int (*crack_counters)
 
 static CRC32_t checksum;
 
-static void charset_filter_plaintexts(struct db_main *db)
+/*
+ * Raw statistics for the plaintexts seen so far.  For each {length, fixed
+ * index position} pair, counts[] holds how many times each character was
+ * seen there after each two preceding characters (or after one, or none,
+ * for the first two positions).  These are what gets saved to the counters
+ * file, everything else in a charset file is derived from them.
+ */
+#define CHARSET_PAIRS			(CHARSET_LENGTH * (CHARSET_LENGTH + 1) / 2)
+
+static unsigned int *charset_counts;
+static unsigned long charset_counts_size;
+static unsigned long charset_offsets[CHARSET_LENGTH][CHARSET_LENGTH];
+static unsigned char charset_pair_length[CHARSET_PAIRS];
+static unsigned char charset_pair_pos[CHARSET_PAIRS];
+
+/* Character counts over plaintexts of all lengths */
+static unsigned int charset_chars[CHARSET_SIZE];
+
+/* Number of plaintexts counted */
+static unsigned int charset_plaintexts;
+
+/*
+ * The plaintexts are not kept, only grouped by length in chunks of up to
+ * CHARSET_CHUNK (already made zero-based), to be counted in parallel.
+ */
+#define CHARSET_CHUNK			0x10000
+
+static unsigned char *charset_bucket[CHARSET_LENGTH];
+static unsigned int charset_bucket_count[CHARSET_LENGTH];
+
+/* Saved counters file version and size of the header fields */
+#define CHARSET_COUNTERS_V		"CHC1"
+#define CHARSET_FILTER_SIZE		0x100
+
+/* Largest output for one {length, fixed index position} pair */
+#define CHARSET_PAIR_BUFFER \
+	(4 + (CHARSET_SIZE + 1) * (CHARSET_SIZE + 1) * (4 + CHARSET_SIZE))
+
+static void charset_init(void)
+{
+	int length, pos, pair;
+
+	charset_counts_size = 0;
+	pair = 0;
+	for (length = 0; length < CHARSET_LENGTH; length++) {
+		for (pos = 0; pos <= length; pos++) {
+			charset_offsets[length][pos] = charset_counts_size;
+			charset_counts_size += pos > 1 ?
+			    CHARSET_SIZE * CHARSET_SIZE * CHARSET_SIZE :
+			    (pos ? CHARSET_SIZE * CHARSET_SIZE : CHARSET_SIZE);
+			charset_pair_length[pair] = length;
+			charset_pair_pos[pair++] = pos;
+		}
+
+		charset_bucket[length] =
+		    mem_alloc(CHARSET_CHUNK * (length + 1));
+		charset_bucket_count[length] = 0;
+	}
+
+	charset_counts = mem_alloc(charset_counts_size * sizeof(unsigned int));
+	memset(charset_counts, 0, charset_counts_size * sizeof(unsigned int));
+	memset(charset_chars, 0, sizeof(charset_chars));
+	charset_plaintexts = 0;
+}
+
+static void charset_done(void)
+{
+	int length;
+
+	for (length = 0; length < CHARSET_LENGTH; length++)
+		MEM_FREE(charset_bucket[length]);
+	MEM_FREE(charset_counts);
+}
+
+/*
+ * Adds the chunk of plaintexts to the counters, with each thread doing its
+ * own {length, fixed index position} pairs.
+ */
+static void charset_count_chunk(void)
+{
+	int pair;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (pair = 0; pair < CHARSET_PAIRS; pair++) {
+		int length = charset_pair_length[pair];
+		int pos = charset_pair_pos[pair];
+		unsigned int *counts =
+		    &charset_counts[charset_offsets[length][pos]];
+		unsigned char *ptr = charset_bucket[length] + pos;
+		unsigned int n = charset_bucket_count[length];
+
+		if (pos > 1)
+		for (; n; n--, ptr += length + 1)
+			counts[((unsigned int)ptr[-2] * CHARSET_SIZE + ptr[-1]) *
+			    CHARSET_SIZE + ptr[0]]++;
+		else
+		if (pos)
+		for (; n; n--, ptr += length + 1)
+			counts[(unsigned int)ptr[-1] * CHARSET_SIZE + ptr[0]]++;
+		else
+		for (; n; n--, ptr += length + 1)
+			counts[ptr[0]]++;
+	}
+
+	memset(charset_bucket_count, 0, sizeof(charset_bucket_count));
+}
+
+static void charset_add_plaintext(char *plaintext)
 {
-	struct list_entry *current, *last;
 	unsigned char *ptr;
 	char key[PLAINTEXT_BUFFER_SIZE];
+	int length;
 
-	last = NULL;
-	if ((current = db->plaintexts->head))
-	do {
-		if (!current->data[0]) {
-			list_del_next(db->plaintexts, last);
-			continue;
-		}
+	if (!plaintext[0])
+		return;
 
-		for (ptr = (unsigned char *)current->data; *ptr; ptr++)
-		if (*ptr < CHARSET_MIN || *ptr > CHARSET_MAX) {
-			list_del_next(db->plaintexts, last);
-			break;
-		}
-		if (*ptr) continue;
-
-		strnzcpy(key, current->data, PLAINTEXT_BUFFER_SIZE);
-		if (ext_filter(key)) {
-			if (strlen(key) <= strlen(current->data))
-				strcpy(current->data, key);
-		} else {
-			list_del_next(db->plaintexts, last);
-			continue;
-		}
+	for (ptr = (unsigned char *)plaintext; *ptr; ptr++)
+	if (*ptr < CHARSET_MIN || *ptr > CHARSET_MAX)
+		return;
+
+	strnzcpy(key, plaintext, PLAINTEXT_BUFFER_SIZE);
+	if (!ext_filter(key))
+		return;
+	if (strlen(key) > strlen(plaintext))
+		strnzcpy(key, plaintext, PLAINTEXT_BUFFER_SIZE);
 
-		last = current;
-	} while ((current = current->next));
+	for (ptr = (unsigned char *)key; *ptr; ptr++)
+	if (*ptr < CHARSET_MIN || *ptr > CHARSET_MAX)
+		return;
+
+	charset_plaintexts++;
+
+	for (ptr = (unsigned char *)key; *ptr; ptr++)
+		charset_chars[ARCH_INDEX(*ptr - CHARSET_MIN)]++;
+
+	if ((length = ptr - (unsigned char *)key) &&
+	    length <= CHARSET_LENGTH) {
+		unsigned char *dst = charset_bucket[length - 1] +
+		    charset_bucket_count[length - 1] * length;
+
+		for (ptr = (unsigned char *)key; *ptr; ptr++)
+			*dst++ = *ptr - CHARSET_MIN;
+
+		if (++charset_bucket_count[length - 1] == CHARSET_CHUNK)
+			charset_count_chunk();
+	}
 }
 
 static int cfputc(int c, FILE *stream)
@@ -145,34 +263,107 @@ static int charset_new_length(int length,
 	return result;
 }
 
-static void charset_generate_chars(struct list_entry *plaintexts,
-	FILE *file, struct charset_header *header,
-	char_counters chars, crack_counters cracks)
+/*
+ * Expands the counters for one {length, fixed index position} pair into
+ * chars[] and writes the charset lines for the pair into out[], returning
+ * their size.  The selection below picks the lowest character index among
+ * equal counts, which the order of lines in a charset file depends upon.
+ */
+static int charset_generate_pair(int length, int pos,
+	unsigned char *out, char_counters chars, crack_counters cracks)
 {
-	struct list_entry *current;
+	unsigned int *counts = &charset_counts[charset_offsets[length][pos]];
 	unsigned char *ptr;
-	unsigned char buffer[CHARSET_SIZE];
-	int length, pos, best, count;
+	int best, count;
 	unsigned int value, max;
 	int i, j, k;
 
-	current = plaintexts;
-	do {
-		for (ptr = (unsigned char *)current->data; *ptr; ptr++)
-			(*chars)[0][0][ARCH_INDEX(*ptr - CHARSET_MIN)]++;
-	} while ((current = current->next));
+	memset(chars, 0, sizeof(*chars));
+
+	if (pos > 1) {
+		for (i = 0; i < CHARSET_SIZE; i++)
+		for (j = 0; j < CHARSET_SIZE; j++) {
+			unsigned int *row =
+			    &counts[(i * CHARSET_SIZE + j) * CHARSET_SIZE];
+			memcpy((*chars)[i][j], row, sizeof((*chars)[i][j]));
+			for (k = 0; k < CHARSET_SIZE; k++)
+				(*chars)[CHARSET_SIZE][j][k] += row[k];
+		}
+	} else
+	if (pos) {
+		for (j = 0; j < CHARSET_SIZE; j++)
+			memcpy((*chars)[CHARSET_SIZE][j],
+			    &counts[j * CHARSET_SIZE],
+			    sizeof((*chars)[CHARSET_SIZE][j]));
+	}
+
+	if (pos) {
+		for (j = 0; j < CHARSET_SIZE; j++)
+		for (k = 0; k < CHARSET_SIZE; k++)
+			(*chars)[CHARSET_SIZE][CHARSET_SIZE][k] +=
+			    (*chars)[CHARSET_SIZE][j][k];
+	} else
+		memcpy((*chars)[CHARSET_SIZE][CHARSET_SIZE], counts,
+		    sizeof((*chars)[CHARSET_SIZE][CHARSET_SIZE]));
+
+	ptr = out;
+	*ptr++ = CHARSET_ESC; *ptr++ = CHARSET_NEW;
+	*ptr++ = length; *ptr++ = pos;
+
+	best = 0;
+	for (i = (pos > 1 ? 0 : CHARSET_SIZE); i <= CHARSET_SIZE; i++)
+	for (j = (pos ? 0 : CHARSET_SIZE); j <= CHARSET_SIZE; j++) {
+		count = 0;
+		do {
+			max = 0;
+			for (k = 0; k < CHARSET_SIZE; k++)
+			if ((value = (*chars)[i][j][k]) > max) {
+				max = value; best = k;
+			}
+
+			if (i == CHARSET_SIZE && j == CHARSET_SIZE &&
+			    count < CHARSET_SIZE)
+				(*cracks)[length][pos][count] = max;
+
+			if (!max) break;
+
+			(*chars)[i][j][best] = 0;
+			ptr[4 + count++] = CHARSET_MIN + best;
+		} while (1);
+
+		if (count) {
+			ptr[0] = CHARSET_ESC;
+			ptr[1] = CHARSET_LINE;
+			ptr[2] = i; ptr[3] = j;
+			ptr += 4 + count;
+		}
+	}
+
+	return ptr - out;
+}
+
+static void charset_generate_chars(FILE *file, struct charset_header *header,
+	crack_counters cracks)
+{
+	unsigned char buffer[CHARSET_SIZE];
+	unsigned int chars[CHARSET_SIZE];
+	int best, count;
+	unsigned int value, max;
+	int k, pair;
+
+	memcpy(chars, charset_chars, sizeof(chars));
 
 	count = 0;
 	best = 0;
 	do {
 		max = 0;
 		for (k = 0; k < CHARSET_SIZE; k++)
-		if ((value = (*chars)[0][0][k]) > max) {
+		if ((value = chars[k]) > max) {
 			max = value; best = k;
 		}
 		if (!max) break;
 
-		(*chars)[0][0][best] = 0;
+		chars[best] = 0;
 		buffer[count++] = CHARSET_MIN + best;
 	} while (1);
 
@@ -180,61 +371,48 @@ static void charset_generate_chars(struct list_entry *plaintexts,
 	fwrite(buffer, 1, count, file);
 	CRC32_Update(&checksum, buffer, count);
 
-	for (length = 0; charset_new_length(length, header, file); length++)
-	for (pos = 0; pos <= length; pos++) {
-		if (event_abort) return;
-
-		cfputc(CHARSET_ESC, file); cfputc(CHARSET_NEW, file);
-		cfputc(length, file); cfputc(pos, file);
-
-		memset(chars, 0, sizeof(*chars));
-
-		current = plaintexts;
-		do
-		if ((int)strlen(current->data) == length + 1) {
-			ptr = (unsigned char *)current->data;
-			(*chars)
-				[CHARSET_SIZE]
-				[CHARSET_SIZE]
-				[ARCH_INDEX(ptr[pos] - CHARSET_MIN)]++;
-			if (pos) (*chars)
-				[CHARSET_SIZE]
-				[ARCH_INDEX(ptr[pos - 1] - CHARSET_MIN)]
-				[ARCH_INDEX(ptr[pos] - CHARSET_MIN)]++;
-			if (pos > 1) (*chars)
-				[ARCH_INDEX(ptr[pos - 2] - CHARSET_MIN)]
-				[ARCH_INDEX(ptr[pos - 1] - CHARSET_MIN)]
-				[ARCH_INDEX(ptr[pos] - CHARSET_MIN)]++;
-		} while ((current = current->next));
+/*
+ * The pairs are independent of each other, only their output has to be
+ * written in order.
+ */
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+		char_counters pair_chars;
+		unsigned char *out;
+		int size;
 
-		for (i = (pos > 1 ? 0 : CHARSET_SIZE); i <= CHARSET_SIZE; i++)
-		for (j = (pos ? 0 : CHARSET_SIZE); j <= CHARSET_SIZE; j++) {
-			count = 0;
-			do {
-				max = 0;
-				for (k = 0; k < CHARSET_SIZE; k++)
-				if ((value = (*chars)[i][j][k]) > max) {
-					max = value; best = k;
-				}
-
-				if (i == CHARSET_SIZE && j == CHARSET_SIZE)
-					(*cracks)[length][pos][count] = max;
-
-				if (!max) break;
-
-				(*chars)[i][j][best] = 0;
-				buffer[count++] = CHARSET_MIN + best;
-			} while (1);
-
-			if (count) {
-				cfputc(CHARSET_ESC, file);
-				cfputc(CHARSET_LINE, file);
-				cfputc(i, file); cfputc(j, file);
-				fwrite(buffer, 1, count, file);
-				CRC32_Update(&checksum, buffer, count);
+		pair_chars = (char_counters)mem_alloc(sizeof(*pair_chars));
+		out = mem_alloc(CHARSET_PAIR_BUFFER);
+
+#ifdef _OPENMP
+#pragma omp for ordered schedule(static, 1)
+#endif
+		for (pair = 0; pair < CHARSET_PAIRS; pair++) {
+			int length = charset_pair_length[pair];
+			int pos = charset_pair_pos[pair];
+
+			size = 0;
+			if (!event_abort)
+				size = charset_generate_pair(length, pos,
+				    out, pair_chars, cracks);
+
+#ifdef _OPENMP
+#pragma omp ordered
+#endif
+			if (!event_abort) {
+				if (!pos)
+					charset_new_length(length, header, file);
+				fwrite(out, 1, size, file);
+				CRC32_Update(&checksum, out, size);
 			}
 		}
+
+		MEM_FREE(out);
+		MEM_FREE(pair_chars);
 	}
+	if (event_abort) return;
 
 	cfputc(CHARSET_ESC, file); cfputc(CHARSET_NEW, file);
 	cfputc(CHARSET_LENGTH, file);
@@ -356,21 +534,18 @@ static void charset_generate_order(crack_counters cracks,
 	MEM_FREE(ratios);
 }
 
-static void charset_generate_all(struct list_entry *plaintexts, char *charset)
+static void charset_generate_all(char *charset)
 {
 	FILE *file;
 	int was_error;
 	struct charset_header *header;
-	char_counters chars;
 	crack_counters cracks;
 
 	header = (struct charset_header *)mem_alloc(sizeof(*header));
 	memset(header, 0, sizeof(*header));
 
-	chars = (char_counters)mem_alloc(sizeof(*chars));
-	memset(chars, 0, sizeof(*chars));
-
 	cracks = (crack_counters)mem_alloc(sizeof(*cracks));
+	memset(cracks, 0, sizeof(*cracks));
 
 	if (!(file = fopen(path_expand(charset), "wb")))
 		pexit("fopen: %s", path_expand(charset));
@@ -380,7 +555,7 @@ static void charset_generate_all(struct list_entry *plaintexts, char *charset)
 	printf("Generating charsets... ");
 	fflush(stdout);
 
-	charset_generate_chars(plaintexts, file, header, chars, cracks);
+	charset_generate_chars(file, header, cracks);
 	if (event_abort) {
 		fclose(file);
 		unlink(charset);
@@ -410,7 +585,6 @@ static void charset_generate_all(struct list_entry *plaintexts, char *charset)
 	}
 
 	MEM_FREE(cracks);
-	MEM_FREE(chars);
 
 	was_error = ferror(file);
 	if (fclose(file) || was_error) {
@@ -425,18 +599,258 @@ static void charset_generate_all(struct list_entry *plaintexts, char *charset)
 	MEM_FREE(header);
 }
 
+/*
+ * The counters file is named after the charset file, with ".cnt" in place
+ * of ".chr".
+ */
+static char *charset_counters_name(char *charset)
+{
+	char *name;
+	int length = strlen(charset);
+
+	name = mem_alloc(length + 5);
+	strcpy(name, charset);
+	if (length > 4 && !strcmp(&name[length - 4], ".chr"))
+		length -= 4;
+	strcpy(&name[length], ".cnt");
+
+	return name;
+}
+
+/*
+ * What decides which plaintexts from the pot file get counted, other than
+ * the pot file itself.  Counters saved with different settings are not
+ * reused.
+ */
+static void charset_counters_filter(struct db_main *db, char *filter)
+{
+	snprintf(filter, CHARSET_FILTER_SIZE, "%s:%s:%c",
+	    options.external ? options.external : "",
+	    fmt_list && !fmt_list->next ? fmt_list->params.label : "",
+	    db->options->field_sep_char);
+}
+
+static void charset_put_int(FILE *file, unsigned long value, int size)
+{
+	while (size--) {
+		fputc((int)(value & 0xff), file);
+		value >>= 8;
+	}
+}
+
+static int charset_get_int(FILE *file, unsigned long *value, int size)
+{
+	int shift, c;
+
+	*value = 0;
+	for (shift = 0; shift < size * 8; shift += 8) {
+		if ((c = getc(file)) == EOF)
+			return -1;
+		*value |= (unsigned long)c << shift;
+	}
+
+	return 0;
+}
+
+/*
+ * Returns the CRC-32 of the first size bytes of the pot file, or a value
+ * which can't match if the file is any shorter.
+ */
+static unsigned long charset_pot_crc(char *pot, long size)
+{
+	FILE *file;
+	unsigned char buffer[0x10000], out[4];
+	CRC32_t crc;
+	long left;
+	size_t count;
+
+	if (!(file = fopen(path_expand(pot), "rb")))
+		return ~0UL;
+
+	CRC32_Init(&crc);
+	for (left = size; left > 0; left -= count) {
+		count = left < (long)sizeof(buffer) ? left : sizeof(buffer);
+		if (fread(buffer, 1, count, file) != count) {
+			fclose(file);
+			return ~0UL;
+		}
+		CRC32_Update(&crc, buffer, count);
+	}
+	fclose(file);
+
+	CRC32_Final(out, crc);
+	return out[0] | ((unsigned long)out[1] << 8) |
+	    ((unsigned long)out[2] << 16) | ((unsigned long)out[3] << 24);
+}
+
+/*
+ * Loads the counters saved by a previous run, if they can be reused, and
+ * returns the offset into the pot file to continue reading at.
+ */
+static long charset_read_counters(struct db_main *db, char *name)
+{
+	FILE *file;
+	char version[4], filter[CHARSET_FILTER_SIZE];
+	char saved[CHARSET_FILTER_SIZE];
+	unsigned long value, offset, crc, index;
+	int length, k;
+
+	if (!(file = fopen(path_expand(name), "rb")))
+		return 0;
+
+	charset_counters_filter(db, filter);
+
+	if (fread(version, sizeof(version), 1, file) != 1 ||
+	    memcmp(version, CHARSET_COUNTERS_V, sizeof(version)) ||
+	    getc(file) != CHARSET_MIN || getc(file) != CHARSET_MAX ||
+	    getc(file) != CHARSET_LENGTH ||
+	    (length = getc(file)) == EOF ||
+	    fread(saved, length, 1, file) != 1)
+		goto rebuild;
+	saved[length] = 0;
+	if (strcmp(saved, filter) ||
+	    charset_get_int(file, &offset, 8) ||
+	    charset_get_int(file, &crc, 4) ||
+	    charset_get_int(file, &value, 4) ||
+	    charset_pot_crc(db->options->activepot, (long)offset) != crc)
+		goto rebuild;
+	charset_plaintexts = value;
+
+	for (k = 0; k < CHARSET_SIZE; k++) {
+		if (charset_get_int(file, &value, 4))
+			goto rebuild;
+		charset_chars[k] = value;
+	}
+
+	do {
+		if (charset_get_int(file, &index, 4) ||
+		    (index != 0xffffffffUL && (index >= charset_counts_size ||
+		    charset_get_int(file, &value, 4))))
+			goto rebuild;
+		if (index == 0xffffffffUL)
+			break;
+		charset_counts[index] = value;
+	} while (1);
+
+	fclose(file);
+
+	printf("Using %u plaintext%s counted before, from %s\n",
+		charset_plaintexts, charset_plaintexts != 1 ? "s" : "", name);
+
+	return (long)offset;
+
+rebuild:
+	fclose(file);
+
+	printf("Not using %s, counting all of %s again\n",
+		name, db->options->activepot);
+
+	memset(charset_counts, 0, charset_counts_size * sizeof(unsigned int));
+	memset(charset_chars, 0, sizeof(charset_chars));
+	charset_plaintexts = 0;
+
+	return 0;
+}
+
+/*
+ * Saves the counters in a sparse form: the index and value of each counter
+ * that isn't zero.  All numbers are little endian.
+ */
+static void charset_write_counters(struct db_main *db, char *name,
+	long offset)
+{
+	FILE *file;
+	char filter[CHARSET_FILTER_SIZE];
+	unsigned long index;
+	int length, k, was_error;
+
+	if (!(file = fopen(path_expand(name), "wb")))
+		pexit("fopen: %s", path_expand(name));
+
+	charset_counters_filter(db, filter);
+	length = strlen(filter);
+
+	fwrite(CHARSET_COUNTERS_V, 4, 1, file);
+	fputc(CHARSET_MIN, file);
+	fputc(CHARSET_MAX, file);
+	fputc(CHARSET_LENGTH, file);
+	fputc(length, file);
+	fwrite(filter, length, 1, file);
+	charset_put_int(file, (unsigned long)offset, 8);
+	charset_put_int(file,
+	    charset_pot_crc(db->options->activepot, offset), 4);
+	charset_put_int(file, charset_plaintexts, 4);
+
+	for (k = 0; k < CHARSET_SIZE; k++)
+		charset_put_int(file, charset_chars[k], 4);
+
+	for (index = 0; index < charset_counts_size; index++)
+	if (charset_counts[index]) {
+		charset_put_int(file, index, 4);
+		charset_put_int(file, charset_counts[index], 4);
+	}
+	charset_put_int(file, 0xffffffffUL, 4);
+
+	was_error = ferror(file);
+	if (fclose(file) || was_error) {
+		unlink(path_expand(name));
+		fprintf(stderr, "Failed to write counters file: %s\n", name);
+		error();
+	}
+}
+
 void do_makechars(struct db_main *db, char *charset)
 {
-	charset_filter_plaintexts(db);
+	struct list_entry *current;
+	char *counters = NULL;
+	unsigned int before;
+	long offset = 0;
+
+	charset_init();
+
+	if (cfg_get_bool(SECTION_OPTIONS, NULL, "CharsetCounters", 0)) {
+		if (options.flags & FLG_PASSWD)
+			puts("Not using CharsetCounters along with "
+			    "password files");
+		else {
+			counters = charset_counters_name(charset);
+			offset = charset_read_counters(db, counters);
+		}
+	}
+	before = charset_plaintexts;
+
+	db->plaintext_hook = charset_add_plaintext;
+	if (options.flags & FLG_PASSWD) {
+		ldr_show_pot_file(db, db->options->activepot);
+
+		db->options->flags |= DB_PLAINTEXTS;
+		if ((current = options.passwd->head))
+		do {
+			ldr_show_pw_file(db, current->data);
+		} while ((current = current->next));
+	} else {
+		db->options->flags |= DB_PLAINTEXTS;
+		ldr_show_pot_file_at(db, db->options->activepot, &offset);
+	}
+	db->plaintext_hook = NULL;
+
+	charset_count_chunk();
 
-	printf("Loaded %d plaintext%s%s\n",
-		db->plaintexts->count,
-		db->plaintexts->count != 1 ? "s" : "",
-		db->plaintexts->count ? "" : ", exiting...");
+	printf("Loaded %u plaintext%s%s\n",
+		charset_plaintexts - before,
+		charset_plaintexts - before != 1 ? "s" : "",
+		charset_plaintexts ? "" : ", exiting...");
 
-	if (!db->plaintexts->count) return;
+	if (counters) {
+		charset_write_counters(db, counters, offset);
+		MEM_FREE(counters);
+	}
 
-	CRC32_Init(&checksum);
+	if (charset_plaintexts) {
+		CRC32_Init(&checksum);
+
+		charset_generate_all(charset);
+	}
 
-	charset_generate_all(db->plaintexts->head, charset);
+	charset_done();
 }
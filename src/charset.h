@@ -65,7 +65,9 @@ struct charset_header {
 extern int charset_read_header(FILE *file, struct charset_header *header);
 
 /*
- * Generates a charset file, based on plaintexts in the database.
+ * Generates a charset file, based on the cracked plaintexts from the pot
+ * file (or those for the password files given).  These are read into the
+ * (initialized) database as they're counted, and not kept.
  */
 extern void do_makechars(struct db_main *db, char *charset);
 
@@ -21,6 +21,7 @@
 #include "recovery.h"
 #include "external.h"
 #include "options.h"
+#include "config.h"
 #include "unicode.h"
 
 #ifdef index
@@ -37,6 +38,24 @@ static struct db_keys *crk_guesses;
 static int64 *crk_timestamps;
 static char crk_stdout_key[PLAINTEXT_BUFFER_SIZE];
 
+/*
+ * Optional filter for candidate passwords which have already been tried
+ * (CandidateFilter in john.conf).  This is a blocked Bloom filter: a key
+ * sets one bit in each of the 8 words of a 64-byte block, so a lookup only
+ * touches one cache line.  The filter is cleared once it holds one key per
+ * 32 bits, which keeps the false positive rate (real candidates which are
+ * skipped) below about 1 in 100,000.
+ */
+#define CRK_FILTER_WORDS		8
+#define CRK_FILTER_BITS_PER_KEY		32
+#define CRK_FILTER_MAX_SIZE		0x10000
+
+static ARCH_WORD_64 *crk_filter;
+static void *crk_filter_alloc;
+static unsigned int crk_filter_blocks;
+static unsigned long long crk_filter_count, crk_filter_limit;
+static unsigned long long crk_filter_skipped, crk_filter_saved;
+
 static void crk_dummy_set_salt(void *salt)
 {
 }
@@ -45,6 +64,113 @@ static void crk_dummy_fix_state(void)
 {
 }
 
+static void crk_filter_init(void)
+{
+	int size;
+	size_t bytes;
+
+	crk_filter = NULL;
+	crk_filter_skipped = crk_filter_saved = 0;
+
+	if ((size = cfg_get_int(SECTION_OPTIONS, NULL,
+	    "CandidateFilter")) <= 0)
+		return;
+/* The size in bytes, plus the alignment, has to fit in a size_t */
+	bytes = (size_t)~0 >> 21;
+	if (bytes > CRK_FILTER_MAX_SIZE)
+		bytes = CRK_FILTER_MAX_SIZE;
+	if ((size_t)size > bytes)
+		size = bytes;
+	bytes = (size_t)size << 20;
+
+	crk_filter_blocks = bytes /
+		(CRK_FILTER_WORDS * sizeof(ARCH_WORD_64));
+	crk_filter_limit = (unsigned long long)crk_filter_blocks *
+		CRK_FILTER_WORDS * 64 / CRK_FILTER_BITS_PER_KEY;
+	crk_filter_count = 0;
+
+	crk_filter_alloc = mem_alloc(bytes + MEM_ALIGN_CACHE);
+	crk_filter = (ARCH_WORD_64 *)(((size_t)crk_filter_alloc +
+		(MEM_ALIGN_CACHE - 1)) & ~(size_t)(MEM_ALIGN_CACHE - 1));
+	memset(crk_filter, 0, bytes);
+
+	log_event("Candidate filter: %d MB", size);
+}
+
+static ARCH_WORD_64 crk_filter_mix(ARCH_WORD_64 h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/*
+ * Returns non-zero if the key has (most likely) been seen before, and adds
+ * it to the filter otherwise.  Only the part of the key which the format
+ * uses counts.
+ */
+static int crk_filter_seen(char *key)
+{
+	unsigned char *p = (unsigned char *)key;
+	ARCH_WORD_64 h = 0xcbf29ce484222325ULL, h2, *block, bit;
+	int length = crk_params.plaintext_length, i, seen;
+
+	while (length-- && *p)
+		h = (h ^ *p++) * 0x100000001b3ULL;
+	h = crk_filter_mix(h);
+	h2 = crk_filter_mix(h ^ 0x9e3779b97f4a7c15ULL);
+
+	block = crk_filter + (size_t)(((h >> 32) * crk_filter_blocks) >> 32) *
+		CRK_FILTER_WORDS;
+	seen = 1;
+	for (i = 0; i < CRK_FILTER_WORDS; i++) {
+		bit = (ARCH_WORD_64)1 << ((h2 >> (i * 6)) & 63);
+		if (!(block[i] & bit)) {
+			block[i] |= bit;
+			seen = 0;
+		}
+	}
+
+	if (seen)
+		return 1;
+
+	if (++crk_filter_count > crk_filter_limit) {
+		memset(crk_filter, 0, (size_t)crk_filter_blocks *
+			CRK_FILTER_WORDS * sizeof(ARCH_WORD_64));
+		crk_filter_count = 0;
+	}
+
+	return 0;
+}
+
+static void crk_filter_done(void)
+{
+	if (!crk_filter)
+		return;
+
+	if (crk_db->loaded) {
+		log_event("Candidate filter skipped %llu duplicate candidates, "
+			"%llu fewer hashes computed",
+			crk_filter_skipped, crk_filter_saved);
+		if (crk_filter_skipped)
+			fprintf(stderr, "Skipped %llu duplicate candidates "
+				"(%llu fewer hashes computed)\n",
+				crk_filter_skipped, crk_filter_saved);
+	} else {
+		log_event("Candidate filter skipped %llu duplicate candidates",
+			crk_filter_skipped);
+		if (crk_filter_skipped)
+			fprintf(stderr, "Skipped %llu duplicate candidates\n",
+				crk_filter_skipped);
+	}
+
+	MEM_FREE(crk_filter_alloc);
+	crk_filter = NULL;
+}
+
 static void crk_init_salt(void)
 {
 	if (!crk_db->salts->next) {
@@ -95,6 +221,11 @@ void crk_init(struct db_main *db, void (*fix_state)(void),
 	rec_save();
 
 	idle_init(db->format);
+
+	if (!guesses && !(options.flags & FLG_TEST_CHK))
+		crk_filter_init();
+
+	status_phase_start();
 }
 
 /*
@@ -186,6 +317,8 @@ static int crk_process_guess(struct db_salt *salt, struct db_password *pw,
 	int dupe;
 	char *key, *utf8key, *repkey, *replogin;
 
+	status_phase(PHASE_GUESS);
+
 	dupe = !memcmp(&crk_timestamps[index], &status.crypts, sizeof(int64));
 	crk_timestamps[index] = status.crypts;
 
@@ -273,6 +406,8 @@ static int crk_process_guess(struct db_salt *salt, struct db_password *pw,
 	if (!(crk_params.flags & FMT_NOT_EXACT))
 		crk_remove_hash(salt, pw);
 
+	status_phase(PHASE_LOOKUP);
+
 	if (!crk_db->salts)
 		return 1;
 
@@ -293,6 +428,12 @@ static int crk_process_event(void)
 	if (event_status) {
 		event_status = 0;
 		status_print();
+		status_phase_write();
+	}
+
+	if (event_phase_stats) {
+		event_phase_stats = 0;
+		status_phase_write();
 	}
 
 	if (event_ticksafety) {
@@ -303,7 +444,11 @@ static int crk_process_event(void)
 	return event_abort;
 }
 
-static int crk_password_loop(struct db_salt *salt)
+/*
+ * A non-negative group_index means the keys have already been crypted for
+ * this salt by crypt_all_salts(), with the salt at that index in the group.
+ */
+static int crk_password_loop(struct db_salt *salt, int group_index)
 {
 	struct db_password *pw;
 	int index;
@@ -317,7 +462,13 @@ static int crk_password_loop(struct db_salt *salt)
 	if (event_pending)
 	if (crk_process_event()) return 1;
 
-	crk_methods.crypt_all(crk_key_index);
+	if (group_index < 0) {
+		status_phase(PHASE_CRYPT);
+		crk_methods.crypt_all(crk_key_index);
+	} else
+		crk_methods.select_salt(group_index);
+
+	status_phase(PHASE_LOOKUP);
 
 	status_update_crypts(salt->count * crk_key_index);
 
@@ -354,10 +505,30 @@ static int crk_salt_loop(void)
 {
 	struct db_salt *salt;
 
+	status_phase(PHASE_CRYPT);
+
 	salt = crk_db->salts;
+	if (crk_methods.crypt_all_salts && salt->next)
+	do {
+		struct db_salt *group[FMT_SALT_GROUP];
+		void *salts[FMT_SALT_GROUP];
+		int count = 0, index;
+
+		do {
+			group[count] = salt;
+			salts[count++] = salt->salt;
+		} while (count < FMT_SALT_GROUP && (salt = salt->next));
+
+		status_phase(PHASE_CRYPT);
+		crk_methods.crypt_all_salts(crk_key_index, salts, count);
+
+		for (index = 0; index < count; index++)
+		if (crk_password_loop(group[index], index)) return 1;
+	} while (salt && (salt = salt->next));
+	else
 	do {
 		crk_methods.set_salt(salt->salt);
-		if (crk_password_loop(salt)) return 1;
+		if (crk_password_loop(salt, -1)) return 1;
 	} while ((salt = salt->next));
 
 	crk_last_key = crk_key_index; crk_key_index = 0;
@@ -380,13 +551,26 @@ static int crk_salt_loop(void)
 
 int crk_process_key(char *key)
 {
+	if (crk_filter && crk_filter_seen(key)) {
+		crk_filter_skipped++;
+		if (crk_db->loaded)
+			crk_filter_saved += crk_db->salt_count;
+		return 0;
+	}
+
 	if (crk_db->loaded) {
+		int retval = 0;
+
+		status_phase(PHASE_SET_KEY);
+
 		crk_methods.set_key(key, crk_key_index++);
 
 		if (crk_key_index >= crk_params.max_keys_per_crypt)
-			return crk_salt_loop();
+			retval = crk_salt_loop();
 
-		return 0;
+		status_phase(PHASE_GENERATE);
+
+		return retval;
 	}
 
 #if !OS_TIMER
@@ -417,13 +601,15 @@ int crk_process_salt(struct db_salt *salt)
 {
 	char *ptr;
 	char key[PLAINTEXT_BUFFER_SIZE];
-	int count, index;
+	int count, index, retval = 0;
 
 	if (crk_guesses) {
 		crk_guesses->count = 0;
 		crk_guesses->ptr = crk_guesses->buffer;
 	}
 
+	status_phase(PHASE_CRYPT);
+
 	if (crk_last_salt != salt->salt)
 		crk_methods.set_salt(crk_last_salt = salt->salt);
 
@@ -431,6 +617,8 @@ int crk_process_salt(struct db_salt *salt)
 	count = salt->keys->count;
 	index = 0;
 
+	status_phase(PHASE_SET_KEY);
+
 	crk_methods.clear_keys();
 
 	while (count--) {
@@ -440,13 +628,17 @@ int crk_process_salt(struct db_salt *salt)
 		crk_methods.set_key(key, index++);
 		if (index >= crk_params.max_keys_per_crypt || !count) {
 			crk_key_index = index;
-			if (crk_password_loop(salt)) return 1;
-			if (!salt->list) return 0;
+			status_phase(PHASE_CRYPT);
+			if ((retval = crk_password_loop(salt, -1)) || !salt->list)
+				break;
+			status_phase(PHASE_SET_KEY);
 			index = 0;
 		}
 	}
 
-	return 0;
+	status_phase(PHASE_GENERATE);
+
+	return retval;
 }
 
 char *crk_get_key1(void)
@@ -476,4 +668,8 @@ void crk_done(void)
 
 		MEM_FREE(crk_timestamps);
 	}
+
+	crk_filter_done();
+
+	status_phase_stop();
 }
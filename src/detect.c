@@ -150,6 +150,7 @@ int main(int argc, char **argv)
 "#define BF_ASM\t\t\t\t0\n"
 "#define BF_SCALE\t\t\t%c\n"
 "#define BF_X2\t\t\t\t%c\n"
+"#define BF_X\t\t\t\t%c\n"
 "\n"
 "#endif\n",
 		argv[2][0],
@@ -157,7 +158,8 @@ int main(int argc, char **argv)
 		argv[4][0],
 		argv[5][0],
 		argv[6][0],
-		argv[7][0]);
+		argv[7][0] > '1' ? '1' : '0',
+		argv[7][0] > '1' ? argv[7][0] : '1');
 
 	return 0;
 }
@@ -172,6 +172,8 @@ extern void DynamicFunc__set_input_len_16();
 extern void DynamicFunc__set_input_len_32();
 extern void DynamicFunc__set_input_len_64();
 extern void DynamicFunc__set_input_len_100();
+extern void DynamicFunc__set_input_len_32_append_salt_crypt_md5();
+extern void DynamicFunc__set_input_len_32_append_salt_crypt_md4();
 
 extern void DynamicFunc__clean_input2();
 extern void DynamicFunc__clean_input2_kwik();
@@ -75,6 +75,12 @@ ahead of time.
 #include "unicode.h"
 #include "johnswap.h"
 #include "pkzip.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #if OPENSSL_VERSION_NUMBER >= 0x10000000
 #include "openssl/whrlpool.h"
@@ -201,10 +207,12 @@ static void __SSE_gen_BenchLowLevelFunctions();
 #   define BY_X			6
 #  elif MD5_SSE_PARA==6
 #   define BY_X			5
+#  elif MD5_SSE_PARA==8
+#   define BY_X			4
 #  endif
 #define LOOP_STR
 #  ifdef MD5_SSE_PARA
-#   define ALGORITHM_NAME		"128/128 " MD5_SSE_type  " " STRINGIZE(BY_X) "x4x" STRINGIZE(MD5_SSE_PARA)
+#   define ALGORITHM_NAME		MD5_SSE_BITS " " MD5_SSE_type  " " STRINGIZE(BY_X) "x4x" STRINGIZE(MD5_SSE_PARA)
 #   define BSD_BLKS (MD5_SSE_PARA)
 #  else
 #   define ALGORITHM_NAME		"128/128 " MD5_SSE_type  " " STRINGIZE(BY_X) "x4"
@@ -240,7 +248,11 @@ static void __SSE_gen_BenchLowLevelFunctions();
 #define ALGORITHM_NAME_X86_S	"32/" ARCH_BITS_STR " 128x1"
 #define ALGORITHM_NAME_X86_4	"32/" ARCH_BITS_STR " 128x1"
 
-// No SSE2 'yet' for sha2.  Waiting patiently for a kind super hacker to do these formats ;)
+// SHA224 and SHA256 use SSESHA256body() whatever the format's mode, see
+// sha224_256_crypt().  No SSE2 'yet' for SHA384 and SHA512.
+#if defined(MMX_COEF) && defined(SHA256_SSE_PARA)
+#define ALGORITHM_NAME_S2_256	SHA256_ALGORITHM_NAME
+#endif
 #if defined (COMMON_DIGEST_FOR_OPENSSL)
 #define ALGORITHM_NAME_S2		"32/" ARCH_BITS_STR " 128x1 CommonCrypto"
 #define ALGORITHM_NAME_X86_S2	"32/" ARCH_BITS_STR " 128x1 CommonCrypto"
@@ -383,26 +395,33 @@ static struct fmt_tests dynamic_tests[] = {
 #else
 #define SHA_BLOCKS 1
 #endif
-#ifdef _MSC_VER
+#ifdef _OPENMP
+// input_buf ... total_len2 are per thread pointers, see below
+#elif defined(_MSC_VER)
 __declspec(align(16)) unsigned char input_buf[BLOCK_LOOPS][64*MMX_COEF];
 __declspec(align(16)) unsigned char input_buf2[BLOCK_LOOPS][64*MMX_COEF];
 __declspec(align(16)) unsigned char crypt_key[BLOCK_LOOPS+1][BINARY_SIZE*MMX_COEF]; // the +1 is so we can directly dump sha1 crypts here. We need an extra buffer on the end, to hold the last buffer overwrite
 __declspec(align(16)) unsigned char crypt_key2[BLOCK_LOOPS][BINARY_SIZE*MMX_COEF];
-// SHA keyspace
-__declspec(align(16)) unsigned char sinput_buf[SHA_BLOCKS][SHA_BUF_SIZ*4*MMX_COEF];
-__declspec(align(16)) unsigned char scrypt_key[SHA_BLOCKS][BINARY_SIZE_SHA*MMX_COEF];
 #else
 unsigned char input_buf[BLOCK_LOOPS][64*MMX_COEF] __attribute__ ((aligned(16)));
 unsigned char input_buf2[BLOCK_LOOPS][64*MMX_COEF] __attribute__ ((aligned(16)));
 unsigned char crypt_key[BLOCK_LOOPS+1][BINARY_SIZE*MMX_COEF] __attribute__ ((aligned(16)));  // the +1 is so we can directly dump sha1 crypts here. We need an extra buffer on the end, to hold the last buffer overwrite
 unsigned char crypt_key2[BLOCK_LOOPS][BINARY_SIZE*MMX_COEF] __attribute__ ((aligned(16)));
+#endif
+#ifdef _MSC_VER
+// SHA keyspace
+__declspec(align(16)) unsigned char sinput_buf[SHA_BLOCKS][SHA_BUF_SIZ*4*MMX_COEF];
+__declspec(align(16)) unsigned char scrypt_key[SHA_BLOCKS][BINARY_SIZE_SHA*MMX_COEF];
+#else
 // SHA keyspace
 unsigned char sinput_buf[SHA_BLOCKS][SHA_BUF_SIZ*4*MMX_COEF] __attribute__ ((aligned(16)));
 unsigned char scrypt_key[SHA_BLOCKS][BINARY_SIZE_SHA*MMX_COEF] __attribute__ ((aligned(16)));
 #endif
+#ifndef _OPENMP
 static unsigned int total_len[BLOCK_LOOPS];
 static unsigned int total_len2[BLOCK_LOOPS];
 #endif
+#endif
 // Allows us to work with up to 96 byte keys in the non-sse2 code
 
 typedef struct {
@@ -422,6 +441,7 @@ typedef struct {
 #endif
 } MD5_IN;
 
+#ifndef _OPENMP
 static MD5_OUT crypt_key_X86[MAX_KEYS_PER_CRYPT_X86>>MD5_X2];
 static MD5_OUT crypt_key2_X86[MAX_KEYS_PER_CRYPT_X86>>MD5_X2];
 
@@ -430,6 +450,7 @@ static MD5_IN input_buf2_X86[MAX_KEYS_PER_CRYPT_X86>>MD5_X2];
 
 static unsigned int total_len_X86[MAX_KEYS_PER_CRYPT_X86];
 static unsigned int total_len2_X86[MAX_KEYS_PER_CRYPT_X86];
+#endif
 
 static int keys_dirty;
 // We store the salt here
@@ -463,8 +484,10 @@ static unsigned short itoa16_w2_u[256], itoa16_w2_l[256], *itoa16_w2=itoa16_w2_l
 #define EFFECTIVE_MKPC (MAX_KEYS_PER_CRYPT > MAX_KEYS_PER_CRYPT_X86 ? MAX_KEYS_PER_CRYPT : MAX_KEYS_PER_CRYPT_X86)
 #define EFFECTIVE_MAX_LENGTH (PLAINTEXT_LENGTH > PLAINTEXT_LENGTH_X86 ? PLAINTEXT_LENGTH : PLAINTEXT_LENGTH_X86)
 
+#ifndef _OPENMP
 static char saved_key[EFFECTIVE_MKPC][EFFECTIVE_MAX_LENGTH + 1];
 static int saved_key_len[EFFECTIVE_MKPC];
+#endif
 
 // Used in 'get_key' if we are running in store_keys_in_input mode
 static char out[EFFECTIVE_MAX_LENGTH + 1];
@@ -488,6 +511,76 @@ static int dynamic_use_sse;
 // If set to 1, then do unicode conversion is many string setting functions.
 static int md5_unicode_convert;
 
+#ifdef _OPENMP
+// With OpenMP, crypt_all() cuts the keys into slices of curdat.omp_slice keys,
+// and runs the script on each slice in its own thread.  The key, input, output
+// and length arrays are then pointers, private to each thread, into storage
+// which is shared by all the slices.  A thread's pointers start at its own
+// slice, so the primitives keep indexing from 0 to m_count.  The master's
+// pointers start at the first slice, so set_key(), get_key(), the cmp and
+// get_hash functions see each key at its usual index.  The globals which the
+// primitives change are private to each thread too.
+#define OMP_SCALE			4
+#ifdef MD5_SSE_PARA
+#define OMP_MD5_PARA		MD5_SSE_PARA
+#else
+#define OMP_MD5_PARA		1
+#endif
+#ifdef MD4_SSE_PARA
+#define OMP_MD4_PARA		MD4_SSE_PARA
+#else
+#define OMP_MD4_PARA		1
+#endif
+#ifdef MMX_COEF
+static unsigned char (*input_buf)[64*MMX_COEF], (*input_buf2)[64*MMX_COEF];
+static unsigned char (*crypt_key)[BINARY_SIZE*MMX_COEF], (*crypt_key2)[BINARY_SIZE*MMX_COEF];
+static unsigned int *total_len, *total_len2;
+#pragma omp threadprivate(input_buf, input_buf2, crypt_key, crypt_key2, total_len, total_len2)
+#pragma omp threadprivate(sinput_buf, scrypt_key)
+#endif
+static MD5_OUT *crypt_key_X86, *crypt_key2_X86;
+static MD5_IN *input_buf_X86, *input_buf2_X86;
+static unsigned int *total_len_X86, *total_len2_X86;
+static char (*saved_key)[EFFECTIVE_MAX_LENGTH + 1];
+static int *saved_key_len;
+#pragma omp threadprivate(crypt_key_X86, crypt_key2_X86, input_buf_X86, input_buf2_X86, total_len_X86, total_len2_X86, saved_key, saved_key_len)
+
+// how many SSE blocks and x86 keys the clean functions wipe: one slice in a
+// thread, all of the storage in the master.
+static int dyna_blocks, dyna_keys;
+#pragma omp threadprivate(dyna_blocks, dyna_keys)
+#define DYNA_SSE_BLOCKS		dyna_blocks
+#define DYNA_X86_KEYS		dyna_keys
+
+#pragma omp threadprivate(m_count, eLargeOut, sha_ctx, dynamic_itoa16, itoa16_w2, dynamic_use_sse, md5_unicode_convert)
+#if !ARCH_LITTLE_ENDIAN
+#pragma omp threadprivate(tmpOut)
+#endif
+
+// the storage, a slice is BLOCK_LOOPS SSE blocks and MAX_KEYS_PER_CRYPT_X86
+// x86 keys at most.  There is one spare slice on the end.
+static struct {
+#ifdef MMX_COEF
+	unsigned char (*input_buf)[64*MMX_COEF], (*input_buf2)[64*MMX_COEF];
+	unsigned char (*crypt_key)[BINARY_SIZE*MMX_COEF], (*crypt_key2)[BINARY_SIZE*MMX_COEF];
+	unsigned int *total_len, *total_len2;
+#endif
+	MD5_OUT *crypt_key_X86, *crypt_key2_X86;
+	MD5_IN *input_buf_X86, *input_buf2_X86;
+	unsigned int *total_len_X86, *total_len2_X86;
+	char (*saved_key)[EFFECTIVE_MAX_LENGTH + 1];
+	int *saved_key_len;
+	int slices;
+} dyna_omp;
+#else
+#define DYNA_SSE_BLOCKS		BLOCK_LOOPS
+#define DYNA_X86_KEYS		MAX_KEYS_PER_CRYPT_X86
+#endif
+#define INPUT_BUF_SIZE		(DYNA_SSE_BLOCKS*64*MMX_COEF)
+#define TOTAL_LEN_SIZE		(DYNA_SSE_BLOCKS*sizeof(unsigned int))
+#define INPUT_BUF_X86_SIZE	((DYNA_X86_KEYS>>MD5_X2)*sizeof(MD5_IN))
+#define TOTAL_LEN_X86_SIZE	(DYNA_X86_KEYS*sizeof(unsigned int))
+
 typedef struct private_subformat_data
 {
 	// If compiled in SSE, AND the format allows SSE, then this will be set to 1.
@@ -508,6 +601,12 @@ typedef struct private_subformat_data
 	int store_keys_normal_but_precompute_md5_to_output2_base16_to_input1_offset32;
 	int dynamic_salt_as_hex;
 	int force_md5_ctx;
+	// set if the script is clean_input, append_salt, append_keys followed only by
+	// crypts of input 1, so crypt_all() can keep the keys and only swap the salt.
+	int salt_prefix_reuse;
+	// keys per thread in crypt_all(), or 0 if the script can not be split up
+	// (OpenMP builds only).
+	int omp_slice;
 
 	// This array is for the 2nd salt in the hash.  I know of no hashes with double salts,
 	// but test type dynamic_16 (which is 'fake') has 2 salts, and this is the data/code to
@@ -549,6 +648,76 @@ typedef struct private_subformat_data
 
 static private_subformat_data curdat;
 
+// The salt length, key count and SSE mode input 1 was last built with by a
+// salt_prefix_reuse script, or -1 if the keys in input 1 can not be reused.
+static int prefix_saltlen = -1, prefix_count, prefix_sse;
+#ifdef MMX_COEF
+static void __SSE_append_string_to_input(unsigned char *IPB, unsigned idx_mod, unsigned char *cp, unsigned len, unsigned bf_ptr, unsigned bUpdate0x80);
+#endif
+
+#ifdef _OPENMP
+// Points this thread's arrays at the slice of keys which starts at key first.
+// keys is the slice size, or 0 for the master's view of all the slices the
+// current format uses.  The storage is allocated on the first call.
+static void dynamic_omp_slice(int first, int keys)
+{
+	if (!dyna_omp.slices) {
+		int n = dyna_omp.slices = omp_get_max_threads() * OMP_SCALE + 1;
+
+#ifdef MMX_COEF
+		dyna_omp.input_buf = mem_calloc_tiny(n * BLOCK_LOOPS * sizeof(*input_buf), MEM_ALIGN_SIMD);
+		dyna_omp.input_buf2 = mem_calloc_tiny(n * BLOCK_LOOPS * sizeof(*input_buf2), MEM_ALIGN_SIMD);
+		dyna_omp.crypt_key = mem_calloc_tiny((n * BLOCK_LOOPS + 1) * sizeof(*crypt_key), MEM_ALIGN_SIMD);
+		dyna_omp.crypt_key2 = mem_calloc_tiny(n * BLOCK_LOOPS * sizeof(*crypt_key2), MEM_ALIGN_SIMD);
+		dyna_omp.total_len = mem_calloc_tiny(n * BLOCK_LOOPS * sizeof(*total_len), MEM_ALIGN_WORD);
+		dyna_omp.total_len2 = mem_calloc_tiny(n * BLOCK_LOOPS * sizeof(*total_len2), MEM_ALIGN_WORD);
+#endif
+		dyna_omp.crypt_key_X86 = mem_calloc_tiny(n * (MAX_KEYS_PER_CRYPT_X86>>MD5_X2) * sizeof(MD5_OUT), MEM_ALIGN_WORD);
+		dyna_omp.crypt_key2_X86 = mem_calloc_tiny(n * (MAX_KEYS_PER_CRYPT_X86>>MD5_X2) * sizeof(MD5_OUT), MEM_ALIGN_WORD);
+		dyna_omp.input_buf_X86 = mem_calloc_tiny(n * (MAX_KEYS_PER_CRYPT_X86>>MD5_X2) * sizeof(MD5_IN), MEM_ALIGN_WORD);
+		dyna_omp.input_buf2_X86 = mem_calloc_tiny(n * (MAX_KEYS_PER_CRYPT_X86>>MD5_X2) * sizeof(MD5_IN), MEM_ALIGN_WORD);
+		dyna_omp.total_len_X86 = mem_calloc_tiny(n * MAX_KEYS_PER_CRYPT_X86 * sizeof(*total_len_X86), MEM_ALIGN_WORD);
+		dyna_omp.total_len2_X86 = mem_calloc_tiny(n * MAX_KEYS_PER_CRYPT_X86 * sizeof(*total_len2_X86), MEM_ALIGN_WORD);
+		dyna_omp.saved_key = mem_calloc_tiny(n * EFFECTIVE_MKPC * sizeof(*saved_key), MEM_ALIGN_WORD);
+		dyna_omp.saved_key_len = mem_calloc_tiny(n * EFFECTIVE_MKPC * sizeof(*saved_key_len), MEM_ALIGN_WORD);
+	}
+#ifdef MMX_COEF
+	input_buf = dyna_omp.input_buf + first / MMX_COEF;
+	input_buf2 = dyna_omp.input_buf2 + first / MMX_COEF;
+	crypt_key = dyna_omp.crypt_key + first / MMX_COEF;
+	crypt_key2 = dyna_omp.crypt_key2 + first / MMX_COEF;
+	total_len = dyna_omp.total_len + first / MMX_COEF;
+	total_len2 = dyna_omp.total_len2 + first / MMX_COEF;
+#endif
+	crypt_key_X86 = dyna_omp.crypt_key_X86 + (first >> MD5_X2);
+	crypt_key2_X86 = dyna_omp.crypt_key2_X86 + (first >> MD5_X2);
+	input_buf_X86 = dyna_omp.input_buf_X86 + (first >> MD5_X2);
+	input_buf2_X86 = dyna_omp.input_buf2_X86 + (first >> MD5_X2);
+	total_len_X86 = dyna_omp.total_len_X86 + first;
+	total_len2_X86 = dyna_omp.total_len2_X86 + first;
+	saved_key = dyna_omp.saved_key + first;
+	saved_key_len = dyna_omp.saved_key_len + first;
+	if (keys) {
+#ifdef MMX_COEF
+		dyna_blocks = keys / MMX_COEF;
+#endif
+		dyna_keys = keys;
+	} else {
+		// never less than what the clean functions wipe without OpenMP
+		int all = curdat.omp_slice * omp_get_max_threads() * OMP_SCALE;
+
+		dyna_blocks = BLOCK_LOOPS;
+		dyna_keys = MAX_KEYS_PER_CRYPT_X86;
+#ifdef MMX_COEF
+		if (all / MMX_COEF > BLOCK_LOOPS)
+			dyna_blocks = all / MMX_COEF;
+#endif
+		if (all > MAX_KEYS_PER_CRYPT_X86)
+			dyna_keys = all;
+	}
+}
+#endif
+
 // Helper function that loads out 256 unsigned short array that does base-16 conversions
 // This function is called at the 'validation' call that loads our preloads (i.e. only
 // called one time, pre 'run' (but will be called multiple times when benchmarking, but
@@ -754,6 +923,11 @@ static void init(struct fmt_main *pFmt)
 	if (!pPriv || (pPriv->init == 1 && !strcmp(curdat.dynamic_WHICH_TYPE_SIG, pPriv->dynamic_WHICH_TYPE_SIG)))
 		return;
 
+#ifdef _OPENMP
+	if (!dyna_omp.slices)
+		dynamic_omp_slice(0, 0);
+#endif
+
 	DynamicFunc__clean_input_full();
 	DynamicFunc__clean_input2_full();
 
@@ -764,8 +938,12 @@ static void init(struct fmt_main *pFmt)
 	pPriv->init = 1;
 
 	memcpy(&curdat, pPriv, sizeof(private_subformat_data));
+#ifdef _OPENMP
+	dynamic_omp_slice(0, 0);
+#endif
 	dynamic_use_sse = curdat.dynamic_use_sse;
 	force_md5_ctx = curdat.force_md5_ctx;
+	prefix_saltlen = -1;
 
 	fmt_Dynamic.params.max_keys_per_crypt = pFmt->params.max_keys_per_crypt;
 	fmt_Dynamic.params.min_keys_per_crypt = pFmt->params.min_keys_per_crypt;
@@ -786,6 +964,7 @@ static void init(struct fmt_main *pFmt)
 	fmt_Dynamic.methods.set_salt   = pFmt->methods.set_salt;
 	fmt_Dynamic.methods.salt       = pFmt->methods.salt;
 	fmt_Dynamic.methods.salt_hash  = pFmt->methods.salt_hash;
+	fmt_Dynamic.methods.salt_compare = pFmt->methods.salt_compare;
 	fmt_Dynamic.methods.split      = pFmt->methods.split;
 	fmt_Dynamic.methods.set_key    = pFmt->methods.set_key;
 	fmt_Dynamic.methods.get_key    = pFmt->methods.get_key;
@@ -805,23 +984,22 @@ static void init(struct fmt_main *pFmt)
 #endif
 
 	if (curdat.input2_set_len32) {
-		for (i = 0; i < MAX_KEYS_PER_CRYPT_X86; ++i)
+		for (i = 0; i < DYNA_X86_KEYS; ++i)
 			total_len2_X86[i] = 32;
 #ifdef MMX_COEF
-		for (i = 0; i < BLOCK_LOOPS; ++i) {
+		for (i = 0; i < DYNA_SSE_BLOCKS; ++i) {
 			input_buf2[i][GETPOS(32,0)] = 0x80;
 			input_buf2[i][GETPOS(57,0)] = 0x1;
 			input_buf2[i][GETPOS(32,1)] = 0x80;
 			input_buf2[i][GETPOS(57,1)] = 0x1;
-			total_len2[i*MMX_COEF] = 32;
-			total_len2[i*MMX_COEF+1] = 32;
 #if (MMX_COEF==4)
 			input_buf2[i][GETPOS(32,2)] = 0x80;
 			input_buf2[i][GETPOS(57,2)] = 0x1;
 			input_buf2[i][GETPOS(32,3)] = 0x80;
 			input_buf2[i][GETPOS(57,3)] = 0x1;
-			total_len2[i*MMX_COEF+2] = 32;
-			total_len2[i*MMX_COEF+3] = 32;
+			total_len2[i] = 0x20202020;
+#else
+			total_len2[i] = 0x200020;
 #endif
 		}
 #endif
@@ -1076,6 +1254,8 @@ static void set_key(char *key, int index)
 {
 	unsigned int len;
 
+	prefix_saltlen = -1;
+
 #ifdef MMX_COEF
 	if (curdat.store_keys_in_input==2)
 		dynamic_use_sse = 3;
@@ -1218,6 +1398,7 @@ key_cleaning2:
 }
 
 static void clear_keys(void) {
+	prefix_saltlen = -1;
 #ifdef MMX_COEF
 	if (curdat.pSetup->flags & MGF_FULL_CLEAN_REQUIRED) {
 		DynamicFunc__clean_input_full();
@@ -1233,7 +1414,7 @@ static void clear_keys(void) {
 	DynamicFunc__clean_input_full();
 #endif
 #ifndef SHA1_SSE_PARA
-	memset(total_len, 0, sizeof(total_len));
+	memset(total_len, 0, TOTAL_LEN_SIZE);
 #endif
 }
 
@@ -1453,7 +1634,7 @@ static int cmp_one_64_4x6(void *binary, int index)
  *  at a time from the array of functions.
  *********************************************************************************
  *********************************************************************************/
-static void crypt_all(int count)
+static void crypt_script(int count, int precompute, int prefix_reuse)
 {
 	int i;
 	DYNAMIC_primitive_funcp *pFuncs;
@@ -1463,17 +1644,6 @@ static void crypt_all(int count)
 	m_count = count;
 	eLargeOut = eBase16;
 
-#ifdef MMX_COEF
-	// If this format is MMX built, but is supposed to start in X86 (but be switchable), then we
-	// set that value here.
-	if (curdat.store_keys_in_input==2)
-		dynamic_use_sse = 3;
-	else if (curdat.md5_startup_in_x86)
-		dynamic_use_sse = 2;
-	else if (dynamic_use_sse==2)
-		dynamic_use_sse = 1;
-#endif
-
 	md5_unicode_convert = 0;
 
 	if (curdat.dynamic_base16_upcase) {
@@ -1491,35 +1661,31 @@ static void crypt_all(int count)
 	// md5(md5($p).$s)  we could md5 the pass, and base-16 put it into a input buffer.  Then when john sets salt
 	// and calls crypt all, the crypt script would simply set the input len to 32, append the salt and call a
 	// single crypt.  That eliminates almost 1/2 of the calls to md5_crypt() for the format show in this example.
-	if (keys_dirty)
+	if (precompute)
 	{
-		if (curdat.store_keys_normal_but_precompute_md5_to_output2)
+		DynamicFunc__clean_input2();
+		if (curdat.store_keys_in_input_unicode_convert)
+			md5_unicode_convert = 1;
+		DynamicFunc__append_keys2();
+		md5_unicode_convert = 0;
+		DynamicFunc__crypt2_md5();
+
+		if (curdat.store_keys_normal_but_precompute_md5_to_output2_base16_to_input1)
+		{
+			if (curdat.store_keys_normal_but_precompute_md5_to_output2_base16_to_input1==2)
+				DynamicFunc__SSEtoX86_switch_output2();
+			DynamicFunc__clean_input();
+			DynamicFunc__append_from_last_output2_to_input1_as_base16();
+		}
+		if (curdat.store_keys_normal_but_precompute_md5_to_output2_base16_to_input1_offset32)
 		{
-			keys_dirty = 0;
-			DynamicFunc__clean_input2();
-			if (curdat.store_keys_in_input_unicode_convert)
-				md5_unicode_convert = 1;
-			DynamicFunc__append_keys2();
-			md5_unicode_convert = 0;
-			DynamicFunc__crypt2_md5();
-
-			if (curdat.store_keys_normal_but_precompute_md5_to_output2_base16_to_input1)
-			{
-				if (curdat.store_keys_normal_but_precompute_md5_to_output2_base16_to_input1==2)
-					DynamicFunc__SSEtoX86_switch_output2();
-				DynamicFunc__clean_input();
-				DynamicFunc__append_from_last_output2_to_input1_as_base16();
-			}
-			if (curdat.store_keys_normal_but_precompute_md5_to_output2_base16_to_input1_offset32)
-			{
 #ifndef MMX_COEF
-				if (curdat.store_keys_normal_but_precompute_md5_to_output2_base16_to_input1_offset32==2)
+			if (curdat.store_keys_normal_but_precompute_md5_to_output2_base16_to_input1_offset32==2)
 #endif
-					DynamicFunc__SSEtoX86_switch_output2();
-				DynamicFunc__clean_input();
-				DynamicFunc__set_input_len_32();
-				DynamicFunc__append_from_last_output2_to_input1_as_base16();
-			}
+				DynamicFunc__SSEtoX86_switch_output2();
+			DynamicFunc__clean_input();
+			DynamicFunc__set_input_len_32();
+			DynamicFunc__append_from_last_output2_to_input1_as_base16();
 		}
 	}
 
@@ -1539,10 +1705,88 @@ static void crypt_all(int count)
 	// Since this array is in a structure, we assign a simple pointer to it
 	// before walking.  Trivial improvement, but every cycle counts :)
 	pFuncs = curdat.dynamic_FUNCTIONS;
+
+	// For md5($s.$p) like scripts, the keys are still in input 1 from the
+	// previous salt.  If this salt has the same length (the loader sorted
+	// the salts by length for us), we only write the new salt over the old
+	// one, and skip the clean_input, append_salt and append_keys steps.
+	if (prefix_reuse) {
+		unsigned j;
+#ifdef MMX_COEF
+		if (dynamic_use_sse==1) {
+			for (j = 0; j < m_count; ++j)
+				__SSE_append_string_to_input((unsigned char*)(&input_buf[j>>(MMX_COEF>>1)]), j&(MMX_COEF-1), cursalt, saltlen, 0, 0);
+		} else
+#endif
+		for (j = 0; j < m_count; ++j) {
+#if MD5_X2
+			if (j&1)
+				memcpy(input_buf_X86[j>>MD5_X2].x2.b2, cursalt, saltlen);
+			else
+#endif
+			memcpy(input_buf_X86[j>>MD5_X2].x1.b, cursalt, saltlen);
+		}
+		pFuncs += 3;
+	}
+
 	for (i = 0; pFuncs[i]; ++i)
 		(*(pFuncs[i]))();
 }
 
+static void crypt_all(int count)
+{
+	int precompute = 0, prefix_reuse = 0;
+
+#ifdef MMX_COEF
+	// If this format is MMX built, but is supposed to start in X86 (but be switchable), then we
+	// set that value here.
+	if (curdat.store_keys_in_input==2)
+		dynamic_use_sse = 3;
+	else if (curdat.md5_startup_in_x86)
+		dynamic_use_sse = 2;
+	else if (dynamic_use_sse==2)
+		dynamic_use_sse = 1;
+#endif
+
+	if (keys_dirty && curdat.store_keys_normal_but_precompute_md5_to_output2)
+	{
+		keys_dirty = 0;
+		precompute = 1;
+	}
+
+	if (curdat.salt_prefix_reuse) {
+		if (prefix_saltlen == saltlen && prefix_count == count &&
+		    prefix_sse == dynamic_use_sse)
+			prefix_reuse = 1;
+		else {
+			prefix_saltlen = saltlen;
+			prefix_count = count;
+			prefix_sse = dynamic_use_sse;
+		}
+	}
+
+#ifdef _OPENMP
+	// Each slice always gets the same keys, so what the script (or the
+	// precompute above) left in the buffers for a slice is still there for
+	// it on the next call.  The master runs slice 0, and ends up in the same
+	// SSE/x86 mode as the other threads.
+	if (curdat.omp_slice && count > curdat.omp_slice) {
+		int slice = curdat.omp_slice, use_sse = dynamic_use_sse, first;
+
+#pragma omp parallel for schedule(static)
+		for (first = 0; first < count; first += slice) {
+			dynamic_use_sse = use_sse;
+			dynamic_omp_slice(first, slice);
+			crypt_script(count - first < slice ? count - first : slice, precompute, prefix_reuse);
+		}
+		dynamic_omp_slice(0, 0);
+		m_count = count;
+		return;
+	}
+#endif
+	crypt_script(count, precompute, prefix_reuse);
+}
+
 /*********************************************************************************
  * 'normal' hashing functions
  *********************************************************************************/
@@ -2129,6 +2373,18 @@ static void *salt_phpass(char *ciphertext)
 	return union_x.salt_p;
 }
 
+/*********************************************************************************
+ * Orders the salts by length, so that crypt_all() of a salt_prefix_reuse format
+ * mostly finds the keys already in place after a salt of the same length.
+ *********************************************************************************/
+static int salt_compare(void *x, void *y)
+{
+	unsigned char *cpx = *((unsigned char**)x), *cpy = *((unsigned char**)y);
+
+	// the first 2 bytes of the salt are its length in base-8, see set_salt()
+	return ((cpx[0] - '0') * 8 + cpx[1] - '0') - ((cpy[0] - '0') * 8 + cpy[1] - '0');
+}
+
 /*********************************************************************************
  * Now our salt is returned only as a pointer.  We
  *********************************************************************************/
@@ -3580,12 +3836,12 @@ void DynamicFunc__clean_input()
 	unsigned i=0;
 #ifdef MMX_COEF
 	if (dynamic_use_sse==1) {
-		memset(input_buf, 0, sizeof(input_buf));
-		memset(total_len, 0, sizeof(total_len));
+		memset(input_buf, 0, INPUT_BUF_SIZE);
+		memset(total_len, 0, TOTAL_LEN_SIZE);
 		return;
 	}
 #endif
-	for (; i < MAX_KEYS_PER_CRYPT_X86; ++i) {
+	for (; i < DYNA_X86_KEYS; ++i) {
 		//if (total_len_X86[i]) {
 #if MD5_X2
 			if (i&1)
@@ -3603,12 +3859,12 @@ void DynamicFunc__clean_input2()
 	unsigned i=0;
 #ifdef MMX_COEF
 	if (dynamic_use_sse==1) {
-		memset(input_buf2, 0, sizeof(input_buf2));
-		memset(total_len2, 0, sizeof(total_len2));
+		memset(input_buf2, 0, INPUT_BUF_SIZE);
+		memset(total_len2, 0, TOTAL_LEN_SIZE);
 		return;
 	}
 #endif
-	for (; i < MAX_KEYS_PER_CRYPT_X86; ++i) {
+	for (; i < DYNA_X86_KEYS; ++i) {
 		//if (total_len2_X86[i]) {
 #if MD5_X2
 			if (i&1)
@@ -3624,45 +3880,45 @@ void DynamicFunc__clean_input2()
 void DynamicFunc__clean_input_full()
 {
 #ifdef MMX_COEF
-	memset(input_buf, 0, sizeof(input_buf));
-	memset(total_len, 0, sizeof(total_len));
+	memset(input_buf, 0, INPUT_BUF_SIZE);
+	memset(total_len, 0, TOTAL_LEN_SIZE);
 #endif
-	memset(input_buf_X86, 0, sizeof(input_buf_X86));
-	memset(total_len_X86, 0, sizeof(total_len_X86));
+	memset(input_buf_X86, 0, INPUT_BUF_X86_SIZE);
+	memset(total_len_X86, 0, TOTAL_LEN_X86_SIZE);
 }
 void DynamicFunc__clean_input2_full()
 {
 #ifdef MMX_COEF
-	memset(input_buf2, 0, sizeof(input_buf));
-	memset(total_len2, 0, sizeof(total_len));
+	memset(input_buf2, 0, INPUT_BUF_SIZE);
+	memset(total_len2, 0, TOTAL_LEN_SIZE);
 #endif
-	memset(input_buf2_X86, 0, sizeof(input_buf2_X86));
-	memset(total_len2_X86, 0, sizeof(total_len2_X86));
+	memset(input_buf2_X86, 0, INPUT_BUF_X86_SIZE);
+	memset(total_len2_X86, 0, TOTAL_LEN_X86_SIZE);
 }
 void DynamicFunc__clean_input_kwik()
 {
 #ifdef MMX_COEF
 	if (dynamic_use_sse==1) {
-		memset(total_len, 0, sizeof(total_len));
+		memset(total_len, 0, TOTAL_LEN_SIZE);
 		return;
 	}
 #endif
-	memset(total_len_X86, 0, sizeof(total_len_X86));
+	memset(total_len_X86, 0, TOTAL_LEN_X86_SIZE);
 #if !ARCH_LITTLE_ENDIAN
-	memset(input_buf_X86, 0, sizeof(input_buf_X86));
+	memset(input_buf_X86, 0, INPUT_BUF_X86_SIZE);
 #endif
 }
 void DynamicFunc__clean_input2_kwik()
 {
 #ifdef MMX_COEF
 	if (dynamic_use_sse==1) {
-		memset(total_len2, 0, sizeof(total_len2));
+		memset(total_len2, 0, TOTAL_LEN_SIZE);
 		return;
 	}
 #endif
-	memset(total_len2_X86, 0, sizeof(total_len2_X86));
+	memset(total_len2_X86, 0, TOTAL_LEN_X86_SIZE);
 #if !ARCH_LITTLE_ENDIAN
-	memset(input_buf2_X86, 0, sizeof(input_buf2_X86));
+	memset(input_buf2_X86, 0, INPUT_BUF_X86_SIZE);
 #endif
 }
 
@@ -3953,10 +4209,27 @@ void DynamicFunc__set_input_len_32()
 	unsigned i;
 #ifdef MMX_COEF
 	if (dynamic_use_sse==1) {
-		unsigned cnt;
+		unsigned cnt, k;
 		cnt = ( ((unsigned)m_count+MMX_COEF-1)>>(MMX_COEF>>1));
 		for (i = 0; i < cnt; ++i)
 		{
+			// If a longer string (e.g. the salt of the previous crypt) was
+			// appended after the 32 bytes, wipe it along with its end of
+			// buffer marker, else it stays in the block after a shorter one.
+			unsigned cur_block_len = total_len[i];
+			for (k = 0; k < MMX_COEF; ++k) {
+				unsigned this_item_len = cur_block_len & 0xFF;
+#if (MMX_COEF==4)
+				cur_block_len >>= 8;
+#else
+				cur_block_len >>= 16;
+#endif
+				if (this_item_len > 32) {
+					for (; this_item_len > 32; --this_item_len)
+						input_buf[i][GETPOS(this_item_len, k&(MMX_COEF-1))] = 0x00;
+					input_buf[i][GETPOS(32, k&(MMX_COEF-1))] = 0x80;
+				}
+			}
 #if (MMX_COEF==4)
 			total_len[i] = 0x20202020;
 #else
@@ -3968,8 +4241,8 @@ void DynamicFunc__set_input_len_32()
 #endif
 	for (i = 0; i < m_count; ++i)
 	{
-		total_len_X86[i] = 32;
 #if !ARCH_LITTLE_ENDIAN
+		total_len_X86[i] = 32;
 #if MD5_X2
 		if (i&1) {
 			//MD5_swap(input_buf_X86[i>>MD5_X2].x2.w2, input_buf_X86[i>>MD5_X2].x2.w2, 8);
@@ -3981,6 +4254,18 @@ void DynamicFunc__set_input_len_32()
 			//MD5_swap(input_buf_X86[i>>MD5_X2].x1.w, input_buf_X86[i>>MD5_X2].x1.w, 8);
 			memset(&(input_buf_X86[i>>MD5_X2].x1.B[32]), 0, 24);
 		}
+#else
+		// wipe whatever was appended after the 32 bytes last time, along with
+		// the 0x80 DoMD5 put at its end.
+		if (total_len_X86[i] > 32) {
+#if MD5_X2
+			if (i&1)
+				memset(&(input_buf_X86[i>>MD5_X2].x2.b2[32]), 0, total_len_X86[i]-31);
+			else
+#endif
+			memset(&(input_buf_X86[i>>MD5_X2].x1.b[32]), 0, total_len_X86[i]-31);
+		}
+		total_len_X86[i] = 32;
 #endif
 	}
 }
@@ -3990,10 +4275,27 @@ void DynamicFunc__set_input2_len_32()
 	unsigned i;
 #ifdef MMX_COEF
 	if (dynamic_use_sse==1) {
-		unsigned cnt;
+		unsigned cnt, k;
 		cnt = ( ((unsigned)m_count+MMX_COEF-1)>>(MMX_COEF>>1));
 		for (i = 0; i < cnt; ++i)
 		{
+			// If a longer string (e.g. the salt of the previous crypt) was
+			// appended after the 32 bytes, wipe it along with its end of
+			// buffer marker, else it stays in the block after a shorter one.
+			unsigned cur_block_len = total_len2[i];
+			for (k = 0; k < MMX_COEF; ++k) {
+				unsigned this_item_len = cur_block_len & 0xFF;
+#if (MMX_COEF==4)
+				cur_block_len >>= 8;
+#else
+				cur_block_len >>= 16;
+#endif
+				if (this_item_len > 32) {
+					for (; this_item_len > 32; --this_item_len)
+						input_buf2[i][GETPOS(this_item_len, k&(MMX_COEF-1))] = 0x00;
+					input_buf2[i][GETPOS(32, k&(MMX_COEF-1))] = 0x80;
+				}
+			}
 #if (MMX_COEF==4)
 			total_len2[i] = 0x20202020;
 #else
@@ -4005,8 +4307,8 @@ void DynamicFunc__set_input2_len_32()
 #endif
 	for (i = 0; i < m_count; ++i)
 	{
-		total_len2_X86[i] = 32;
 #if !ARCH_LITTLE_ENDIAN
+		total_len2_X86[i] = 32;
 #if MD5_X2
 		if (i&1) {
 			//MD5_swap(input_buf2_X86[i>>MD5_X2].x2.w2, input_buf2_X86[i>>MD5_X2].x2.w2, 8);
@@ -4018,6 +4320,18 @@ void DynamicFunc__set_input2_len_32()
 			//MD5_swap(input_buf2_X86[i>>MD5_X2].x1.w, input_buf2_X86[i>>MD5_X2].x1.w, 8);
 			memset(&(input_buf2_X86[i>>MD5_X2].x1.B[32]), 0, 24);
 		}
+#else
+		// wipe whatever was appended after the 32 bytes last time, along with
+		// the 0x80 DoMD5 put at its end.
+		if (total_len2_X86[i] > 32) {
+#if MD5_X2
+			if (i&1)
+				memset(&(input_buf2_X86[i>>MD5_X2].x2.b2[32]), 0, total_len2_X86[i]-31);
+			else
+#endif
+			memset(&(input_buf2_X86[i>>MD5_X2].x1.b[32]), 0, total_len2_X86[i]-31);
+		}
+		total_len2_X86[i] = 32;
 #endif
 	}
 }
@@ -4294,6 +4608,89 @@ void DynamicFunc__crypt_md4()
 	}
 }
 
+/**************************************************************
+ * DYNAMIC fused primitives
+ * set_input_len_32, append_salt, crypt_md5 (or crypt_md4) in a
+ * single pass, for md5(md5($p).$s) style scripts. dynamic_SETUP
+ * puts these in place of the three primitives. The last 32 bytes
+ * of every SSE block (salt, 0x80, bit length) are the same for
+ * all the keys, so they are built once and stored right before
+ * each group of blocks is hashed, while it is still in cache.
+ * Anything the fast path can not do (x86 buffers, unicode, salts
+ * longer than 23 bytes, which do not fit in one block) calls the
+ * original primitives.
+ *************************************************************/
+#if defined(MMX_COEF) && ARCH_LITTLE_ENDIAN && (defined(MD5_SSE_PARA) || defined(MD4_SSE_PARA))
+static void __SSE_len_32_salt_crypt(int md4)
+{
+	ARCH_WORD_32 tail[8];
+	unsigned i, j, k, cnt, para, blen;
+
+	cnt = ( ((unsigned)m_count+MMX_COEF-1)>>(MMX_COEF>>1));
+	memset(tail, 0, sizeof(tail));
+	memcpy(tail, cursalt, saltlen);
+	((unsigned char*)tail)[saltlen] = 0x80;
+	tail[6] = (32+saltlen)<<3;
+#if (MMX_COEF==4)
+	blen = (32+saltlen)*0x01010101;
+#else
+	blen = (32+saltlen)*0x00010001;
+#endif
+	para = 1;
+#ifdef MD5_SSE_PARA
+	if (!md4)
+		para = MD5_SSE_PARA;
+#endif
+#ifdef MD4_SSE_PARA
+	if (md4)
+		para = MD4_SSE_PARA;
+#endif
+	for (i = 0; i < cnt; i += para) {
+		for (j = i; j < i+para && j < cnt; ++j) {
+			ARCH_WORD_32 *p = (ARCH_WORD_32 *)(&input_buf[j]) + 8*MMX_COEF;
+			for (k = 0; k < 8*MMX_COEF; ++k)
+				p[k] = tail[k/MMX_COEF];
+			total_len[j] = blen;
+		}
+#ifdef MD4_SSE_PARA
+		if (md4) {
+			SSEmd4body((unsigned char*)(&input_buf[i]), (unsigned int*)(&crypt_key[i]), 1);
+			continue;
+		}
+#endif
+#ifdef MD5_SSE_PARA
+		SSEmd5body((unsigned char*)(&input_buf[i]), (unsigned int*)(&crypt_key[i]), 1);
+#endif
+	}
+}
+#endif
+
+void DynamicFunc__set_input_len_32_append_salt_crypt_md5()
+{
+#if defined(MMX_COEF) && ARCH_LITTLE_ENDIAN && defined(MD5_SSE_PARA)
+	if (dynamic_use_sse==1 && !md5_unicode_convert && saltlen <= 23) {
+		__SSE_len_32_salt_crypt(0);
+		return;
+	}
+#endif
+	DynamicFunc__set_input_len_32();
+	DynamicFunc__append_salt();
+	DynamicFunc__crypt_md5();
+}
+
+void DynamicFunc__set_input_len_32_append_salt_crypt_md4()
+{
+#if defined(MMX_COEF) && ARCH_LITTLE_ENDIAN && defined(MD4_SSE_PARA)
+	if (dynamic_use_sse==1 && !md5_unicode_convert && saltlen <= 23) {
+		__SSE_len_32_salt_crypt(1);
+		return;
+	}
+#endif
+	DynamicFunc__set_input_len_32();
+	DynamicFunc__append_salt();
+	DynamicFunc__crypt_md4();
+}
+
 #ifndef MMX_COEF
 typedef struct {
 	union {
@@ -7449,297 +7846,314 @@ void DynamicFunc__SHA1_crypt_input2_to_output1_FINAL()
 /********************************************************************
  ****  Here are the SHA224 and SHA256 functions!!!
  *******************************************************************/
+
+/*
+ * Returns the SHA224 (sha224 set) or SHA256 of key idx of in[] and len[].
+ * The keys have to be asked for in order, starting from 0: with
+ * SHA256_SSE_PARA, the first key of each group hashes the whole group of
+ * MMX_COEF*SHA256_SSE_PARA keys at once, in SSESHA256body() for those that
+ * fit in one block and with the plain code for the rest.
+ */
+#if defined(MMX_COEF) && defined(SHA256_SSE_PARA)
+#define SHA256_SSE_KEYS		(MMX_COEF*SHA256_SSE_PARA)
+#ifdef _MSC_VER
+static __declspec(align(16)) unsigned char sha256_sinput[SHA256_SSE_PARA][64*MMX_COEF];
+static __declspec(align(16)) ARCH_WORD_32 sha256_sout[SHA256_SSE_PARA*8*MMX_COEF];
+#else
+static unsigned char sha256_sinput[SHA256_SSE_PARA][64*MMX_COEF] __attribute__ ((aligned(16)));
+static ARCH_WORD_32 sha256_sout[SHA256_SSE_PARA*8*MMX_COEF] __attribute__ ((aligned(16)));
+#endif
+static unsigned char sha256_hashes[SHA256_SSE_KEYS][32];
+#ifdef _OPENMP
+#pragma omp threadprivate(sha256_sinput, sha256_sout, sha256_hashes)
+#endif
+static int sha256_use_sse = 1;
+
+/*
+ * OpenSSL's SHA-256 is faster than the 4 lane SSE2 code on CPUs with the
+ * SHA extensions, so it is kept there. The AVX2 and AVX-512 builds always
+ * use SSESHA256body().
+ */
+static int sha256_sse_wanted(void)
+{
+#if !defined(SHA256_SSE_WIDE) && !defined(GENERIC_SHA2) && \
+    !defined(COMMON_DIGEST_FOR_OPENSSL) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+	unsigned int a, b, c, d;
+
+	if (__get_cpuid_max(0, NULL) >= 7) {
+		__cpuid_count(7, 0, a, b, c, d);
+		if (b & (1 << 29))
+			return 0;
+	}
+#endif
+	return 1;
+}
+#else
+static unsigned char sha256_hashes[1][32];
+#ifdef _OPENMP
+#pragma omp threadprivate(sha256_hashes)
+#endif
+#endif
+
+static unsigned char *sha224_256_crypt(MD5_IN *in, unsigned int *len, int idx, int sha224)
+{
+	SHA256_CTX ctx;
+	unsigned char *cp;
+	int i, j, first = idx, last = idx + 1;
+#ifdef SHA256_SSE_KEYS
+	int k, ssedone = 0;
+
+	if (idx % SHA256_SSE_KEYS)
+		return sha256_hashes[idx % SHA256_SSE_KEYS];
+	last = idx + SHA256_SSE_KEYS;
+	if (last > m_count)
+		last = m_count;
+	if (sha256_use_sse)
+	for (i = first; i < last; ++i) {
+		ARCH_WORD_32 *si = (ARCH_WORD_32 *)sha256_sinput[(i-first)/MMX_COEF], w;
+		j = (i-first)&(MMX_COEF-1);
+		if (j == 0)
+			memset(si, 0, 64*MMX_COEF);
+		if (len[i] > 55)
+			continue;
+#if (MD5_X2)
+		if (i & 1)
+			cp = in[i>>1].x2.B2;
+		else
+#endif
+		cp = in[i>>MD5_X2].x1.B;
+		for (k = 0; k + 4 <= len[i]; k += 4)
+			si[(k>>2)*MMX_COEF+j] = JOHNSWAP(*(ARCH_WORD_32 *)&cp[k]);
+		for (w = 0x80 << 8*(3-(len[i]&3)); k < len[i]; ++k)
+			w |= cp[k] << 8*(3-(k&3));
+		si[(k>>2)*MMX_COEF+j] = w;
+		si[15*MMX_COEF+j] = len[i]<<3;
+		ssedone = 1;
+	}
+	if (ssedone) {
+		SSESHA256body((__m128i *)sha256_sinput, sha256_sout, sha224);
+		for (i = first; i < last; ++i) {
+			ARCH_WORD_32 *so = &sha256_sout[((i-first)/MMX_COEF)*8*MMX_COEF + ((i-first)&(MMX_COEF-1))];
+			if (len[i] > 55)
+				continue;
+			cp = sha256_hashes[i-first];
+			for (k = 0; k < 8; ++k, cp += 4) {
+				ARCH_WORD_32 w = so[k*MMX_COEF];
+				cp[0] = w>>24; cp[1] = w>>16; cp[2] = w>>8; cp[3] = w;
+			}
+		}
+	}
+#endif
+	for (i = first; i < last; ++i) {
+#ifdef SHA256_SSE_KEYS
+		if (sha256_use_sse && len[i] <= 55)
+			continue;
+#endif
+#if (MD5_X2)
+		if (i & 1)
+			cp = in[i>>1].x2.B2;
+		else
+#endif
+		cp = in[i>>MD5_X2].x1.B;
+		if (sha224) {
+			SHA224_Init(&ctx);
+			SHA224_Update(&ctx, cp, len[i]);
+			SHA224_Final(sha256_hashes[i-first], &ctx);
+		} else {
+			SHA256_Init(&ctx);
+			SHA256_Update(&ctx, cp, len[i]);
+			SHA256_Final(sha256_hashes[i-first], &ctx);
+		}
+	}
+	return sha256_hashes[0];
+}
 void DynamicFunc__SHA224_crypt_input1_append_input2() {
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u, *cpo;
+	unsigned char *crypt_out, *cpo;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA224_Init(&ctx);
+		crypt_out = sha224_256_crypt(input_buf_X86, total_len_X86, i, 1);
 #if (MD5_X2)
-		if (i & 1) {
-			SHA224_Update(&ctx, input_buf_X86[i>>MD5_X2].x2.b2, total_len_X86[i]);
+		if (i & 1)
 			cpo = (unsigned char *)&(input_buf2_X86[i>>MD5_X2].x2.b2[total_len2_X86[i]]);
-		}
 		else
 #endif
-		{
-			SHA224_Update(&ctx, input_buf_X86[i>>MD5_X2].x1.b, total_len_X86[i]);
 			cpo = (unsigned char *)&(input_buf2_X86[i>>MD5_X2].x1.b[total_len2_X86[i]]);
-		}
-		SHA224_Final(crypt_out, &ctx);
 		total_len2_X86[i] += large_hash_output(crypt_out, cpo, 28);
 	}
 }
 void DynamicFunc__SHA256_crypt_input1_append_input2() {
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u, *cpo;
+	unsigned char *crypt_out, *cpo;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA256_Init(&ctx);
+		crypt_out = sha224_256_crypt(input_buf_X86, total_len_X86, i, 0);
 #if (MD5_X2)
-		if (i & 1) {
-			SHA256_Update(&ctx, input_buf_X86[i>>MD5_X2].x2.b2, total_len_X86[i]);
+		if (i & 1)
 			cpo = (unsigned char *)&(input_buf2_X86[i>>MD5_X2].x2.b2[total_len2_X86[i]]);
-		}
 		else
 #endif
-		{
-			SHA256_Update(&ctx, input_buf_X86[i>>MD5_X2].x1.b, total_len_X86[i]);
 			cpo = (unsigned char *)&(input_buf2_X86[i>>MD5_X2].x1.b[total_len2_X86[i]]);
-		}
-		SHA256_Final(crypt_out, &ctx);
 		total_len2_X86[i] += large_hash_output(crypt_out, cpo, 32);
 	}
 }
 void DynamicFunc__SHA224_crypt_input2_append_input1() {
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u, *cpo;
+	unsigned char *crypt_out, *cpo;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA224_Init(&ctx);
+		crypt_out = sha224_256_crypt(input_buf2_X86, total_len2_X86, i, 1);
 #if (MD5_X2)
-		if (i & 1) {
-			SHA224_Update(&ctx, input_buf2_X86[i>>MD5_X2].x2.b2, total_len2_X86[i]);
+		if (i & 1)
 			cpo = (unsigned char *)&(input_buf_X86[i>>MD5_X2].x2.b2[total_len_X86[i]]);
-		}
 		else
 #endif
-		{
-			SHA224_Update(&ctx, input_buf2_X86[i>>MD5_X2].x1.b, total_len2_X86[i]);
 			cpo = (unsigned char *)&(input_buf_X86[i>>MD5_X2].x1.b[total_len_X86[i]]);
-		}
-		SHA224_Final(crypt_out, &ctx);
 		total_len_X86[i] += large_hash_output(crypt_out, cpo, 28);
 	}
 }
 void DynamicFunc__SHA256_crypt_input2_append_input1() {
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u, *cpo;
+	unsigned char *crypt_out, *cpo;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA256_Init(&ctx);
+		crypt_out = sha224_256_crypt(input_buf2_X86, total_len2_X86, i, 0);
 #if (MD5_X2)
-		if (i & 1) {
-			SHA256_Update(&ctx, input_buf2_X86[i>>MD5_X2].x2.b2, total_len2_X86[i]);
+		if (i & 1)
 			cpo = (unsigned char *)&(input_buf_X86[i>>MD5_X2].x2.b2[total_len_X86[i]]);
-		}
 		else
 #endif
-		{
-			SHA256_Update(&ctx, input_buf2_X86[i>>MD5_X2].x1.b, total_len2_X86[i]);
 			cpo = (unsigned char *)&(input_buf_X86[i>>MD5_X2].x1.b[total_len_X86[i]]);
-		}
-		SHA256_Final(crypt_out, &ctx);
 		total_len_X86[i] += large_hash_output(crypt_out, cpo, 32);
 	}
 }
 void DynamicFunc__SHA224_crypt_input1_overwrite_input1(){
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u, *cpo;
+	unsigned char *crypt_out, *cpo;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA224_Init(&ctx);
+		crypt_out = sha224_256_crypt(input_buf_X86, total_len_X86, i, 1);
 #if (MD5_X2)
-		if (i & 1) {
-			SHA224_Update(&ctx, input_buf_X86[i>>MD5_X2].x2.b2, total_len_X86[i]);
+		if (i & 1)
 			cpo = (unsigned char *)input_buf_X86[i>>MD5_X2].x2.b2;
-		}
 		else
 #endif
-		{
-			SHA224_Update(&ctx, input_buf_X86[i>>MD5_X2].x1.b, total_len_X86[i]);
 			cpo = (unsigned char *)input_buf_X86[i>>MD5_X2].x1.b;
-		}
-		SHA224_Final(crypt_out, &ctx);
 		total_len_X86[i] += large_hash_output_no_null(crypt_out, cpo, 28);
 	}
 }
 void DynamicFunc__SHA256_crypt_input1_overwrite_input1(){
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u, *cpo;
+	unsigned char *crypt_out, *cpo;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA256_Init(&ctx);
+		crypt_out = sha224_256_crypt(input_buf_X86, total_len_X86, i, 0);
 #if (MD5_X2)
-		if (i & 1) {
-			SHA256_Update(&ctx, input_buf_X86[i>>MD5_X2].x2.b2, total_len_X86[i]);
+		if (i & 1)
 			cpo = (unsigned char *)input_buf_X86[i>>MD5_X2].x2.b2;
-		}
 		else
 #endif
-		{
-			SHA256_Update(&ctx, input_buf_X86[i>>MD5_X2].x1.b, total_len_X86[i]);
 			cpo = (unsigned char *)input_buf_X86[i>>MD5_X2].x1.b;
-		}
-		SHA256_Final(crypt_out, &ctx);
 		total_len_X86[i] += large_hash_output_no_null(crypt_out, cpo, 32);
 	}
 }
 void DynamicFunc__SHA224_crypt_input1_overwrite_input2(){
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u, *cpo;
+	unsigned char *crypt_out, *cpo;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA224_Init(&ctx);
+		crypt_out = sha224_256_crypt(input_buf_X86, total_len_X86, i, 1);
 #if (MD5_X2)
-		if (i & 1) {
-			SHA224_Update(&ctx, input_buf_X86[i>>MD5_X2].x2.b2, total_len_X86[i]);
+		if (i & 1)
 			cpo = (unsigned char *)input_buf2_X86[i>>MD5_X2].x2.b2;
-		}
 		else
 #endif
-		{
-			SHA224_Update(&ctx, input_buf_X86[i>>MD5_X2].x1.b, total_len_X86[i]);
 			cpo = (unsigned char *)input_buf2_X86[i>>MD5_X2].x1.b;
-		}
-		SHA224_Final(crypt_out, &ctx);
 		total_len2_X86[i] += large_hash_output_no_null(crypt_out, cpo, 28);
 	}
 }
 void DynamicFunc__SHA256_crypt_input1_overwrite_input2(){
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u, *cpo;
+	unsigned char *crypt_out, *cpo;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA256_Init(&ctx);
+		crypt_out = sha224_256_crypt(input_buf_X86, total_len_X86, i, 0);
 #if (MD5_X2)
-		if (i & 1) {
-			SHA256_Update(&ctx, input_buf_X86[i>>MD5_X2].x2.b2, total_len_X86[i]);
+		if (i & 1)
 			cpo = (unsigned char *)input_buf2_X86[i>>MD5_X2].x2.b2;
-		}
 		else
 #endif
-		{
-			SHA256_Update(&ctx, input_buf_X86[i>>MD5_X2].x1.b, total_len_X86[i]);
 			cpo = (unsigned char *)input_buf2_X86[i>>MD5_X2].x1.b;
-		}
-		SHA256_Final(crypt_out, &ctx);
 		total_len2_X86[i] += large_hash_output_no_null(crypt_out, cpo, 32);
 	}
 }
 void DynamicFunc__SHA224_crypt_input2_overwrite_input1(){
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u, *cpo;
+	unsigned char *crypt_out, *cpo;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA224_Init(&ctx);
+		crypt_out = sha224_256_crypt(input_buf2_X86, total_len2_X86, i, 1);
 #if (MD5_X2)
-		if (i & 1) {
-			SHA224_Update(&ctx, input_buf2_X86[i>>MD5_X2].x2.b2, total_len2_X86[i]);
+		if (i & 1)
 			cpo = (unsigned char *)input_buf_X86[i>>MD5_X2].x2.b2;
-		}
 		else
 #endif
-		{
-			SHA224_Update(&ctx, input_buf2_X86[i>>MD5_X2].x1.b, total_len2_X86[i]);
 			cpo = (unsigned char *)input_buf_X86[i>>MD5_X2].x1.b;
-		}
-		SHA224_Final(crypt_out, &ctx);
 		total_len_X86[i] += large_hash_output_no_null(crypt_out, cpo, 28);
 	}
 }
 void DynamicFunc__SHA256_crypt_input2_overwrite_input1(){
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u, *cpo;
+	unsigned char *crypt_out, *cpo;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA256_Init(&ctx);
+		crypt_out = sha224_256_crypt(input_buf2_X86, total_len2_X86, i, 0);
 #if (MD5_X2)
-		if (i & 1) {
-			SHA256_Update(&ctx, input_buf2_X86[i>>MD5_X2].x2.b2, total_len2_X86[i]);
+		if (i & 1)
 			cpo = (unsigned char *)input_buf_X86[i>>MD5_X2].x2.b2;
-		}
 		else
 #endif
-		{
-			SHA256_Update(&ctx, input_buf2_X86[i>>MD5_X2].x1.b, total_len2_X86[i]);
 			cpo = (unsigned char *)input_buf_X86[i>>MD5_X2].x1.b;
-		}
-		SHA256_Final(crypt_out, &ctx);
 		total_len_X86[i] += large_hash_output_no_null(crypt_out, cpo, 32);
 	}
 }
 void DynamicFunc__SHA224_crypt_input2_overwrite_input2(){
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u, *cpo;
+	unsigned char *crypt_out, *cpo;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA224_Init(&ctx);
+		crypt_out = sha224_256_crypt(input_buf2_X86, total_len2_X86, i, 1);
 #if (MD5_X2)
-		if (i & 1) {
-			SHA224_Update(&ctx, input_buf2_X86[i>>MD5_X2].x2.b2, total_len2_X86[i]);
+		if (i & 1)
 			cpo = (unsigned char *)input_buf2_X86[i>>MD5_X2].x2.b2;
-		}
 		else
 #endif
-		{
-			SHA224_Update(&ctx, input_buf2_X86[i>>MD5_X2].x1.b, total_len2_X86[i]);
 			cpo = (unsigned char *)input_buf2_X86[i>>MD5_X2].x1.b;
-		}
-		SHA224_Final(crypt_out, &ctx);
 		total_len2_X86[i] += large_hash_output_no_null(crypt_out, cpo, 28);
 	}
 }
 void DynamicFunc__SHA256_crypt_input2_overwrite_input2(){
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u, *cpo;
+	unsigned char *crypt_out, *cpo;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA256_Init(&ctx);
+		crypt_out = sha224_256_crypt(input_buf2_X86, total_len2_X86, i, 0);
 #if (MD5_X2)
-		if (i & 1) {
-			SHA256_Update(&ctx, input_buf2_X86[i>>MD5_X2].x2.b2, total_len2_X86[i]);
+		if (i & 1)
 			cpo = (unsigned char *)input_buf2_X86[i>>MD5_X2].x2.b2;
-		}
 		else
 #endif
-		{
-			SHA256_Update(&ctx, input_buf2_X86[i>>MD5_X2].x1.b, total_len2_X86[i]);
 			cpo = (unsigned char *)input_buf2_X86[i>>MD5_X2].x1.b;
-		}
-		SHA256_Final(crypt_out, &ctx);
 		total_len2_X86[i] += large_hash_output_no_null(crypt_out, cpo, 32);
 	}
 }
 void DynamicFunc__SHA224_crypt_input1_to_output1_FINAL(){
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u;
+	unsigned char *crypt_out;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA224_Init(&ctx);
-#if (MD5_X2)
-		if (i & 1)
-			SHA224_Update(&ctx, input_buf_X86[i>>MD5_X2].x2.b2, total_len_X86[i]);
-		else
-#endif
-			SHA224_Update(&ctx, input_buf_X86[i>>MD5_X2].x1.b, total_len_X86[i]);
-		SHA224_Final(crypt_out, &ctx);
+		crypt_out = sha224_256_crypt(input_buf_X86, total_len_X86, i, 1);
 
 		// Only copies the first 16 out of 28 bytes.  Thus we do not have
 		// the entire SHA224. It would NOT be valid to continue from here. However
@@ -7758,20 +8172,11 @@ void DynamicFunc__SHA224_crypt_input1_to_output1_FINAL(){
 	}
 }
 void DynamicFunc__SHA256_crypt_input1_to_output1_FINAL(){
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u;
+	unsigned char *crypt_out;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA256_Init(&ctx);
-#if (MD5_X2)
-		if (i & 1)
-			SHA256_Update(&ctx, input_buf_X86[i>>MD5_X2].x2.b2, total_len_X86[i]);
-		else
-#endif
-			SHA256_Update(&ctx, input_buf_X86[i>>MD5_X2].x1.b, total_len_X86[i]);
-		SHA256_Final(crypt_out, &ctx);
+		crypt_out = sha224_256_crypt(input_buf_X86, total_len_X86, i, 0);
 
 		// Only copies the first 16 out of 32 bytes.  Thus we do not have
 		// the entire SHA256. It would NOT be valid to continue from here. However
@@ -7790,20 +8195,11 @@ void DynamicFunc__SHA256_crypt_input1_to_output1_FINAL(){
 	}
 }
 void DynamicFunc__SHA224_crypt_input2_to_output1_FINAL(){
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u;
+	unsigned char *crypt_out;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA224_Init(&ctx);
-#if (MD5_X2)
-		if (i & 1)
-			SHA224_Update(&ctx, input_buf2_X86[i>>MD5_X2].x2.b2, total_len2_X86[i]);
-		else
-#endif
-			SHA224_Update(&ctx, input_buf2_X86[i>>MD5_X2].x1.b, total_len2_X86[i]);
-		SHA224_Final(crypt_out, &ctx);
+		crypt_out = sha224_256_crypt(input_buf2_X86, total_len2_X86, i, 1);
 
 		// Only copies the first 16 out of 28 bytes.  Thus we do not have
 		// the entire SHA224. It would NOT be valid to continue from here. However
@@ -7822,20 +8218,11 @@ void DynamicFunc__SHA224_crypt_input2_to_output1_FINAL(){
 	}
 }
 void DynamicFunc__SHA256_crypt_input2_to_output1_FINAL(){
-	union xx { unsigned char u[32]; ARCH_WORD a[32/sizeof(ARCH_WORD)]; } u;
-	unsigned char *crypt_out=u.u;
+	unsigned char *crypt_out;
 	int i;
-	SHA256_CTX ctx;
 
 	for (i = 0; i < m_count; ++i) {
-		SHA256_Init(&ctx);
-#if (MD5_X2)
-		if (i & 1)
-			SHA256_Update(&ctx, input_buf2_X86[i>>MD5_X2].x2.b2, total_len2_X86[i]);
-		else
-#endif
-			SHA256_Update(&ctx, input_buf2_X86[i>>MD5_X2].x1.b, total_len2_X86[i]);
-		SHA256_Final(crypt_out, &ctx);
+		crypt_out = sha224_256_crypt(input_buf2_X86, total_len2_X86, i, 0);
 
 		// Only copies the first 16 out of 32 bytes.  Thus we do not have
 		// the entire SHA256. It would NOT be valid to continue from here. However
@@ -8756,6 +9143,7 @@ static int isSHA1Func(DYNAMIC_primitive_funcp p) {
 		return 1;
 	return 0;
 }
+// 2 for the SHA224 and SHA256 functions (see sha224_256_crypt), 1 for the others
 static int isSHA2Func(DYNAMIC_primitive_funcp p) {
 	if (p==DynamicFunc__SHA224_crypt_input1_append_input2_base16    || p==DynamicFunc__SHA224_crypt_input1_append_input2    ||
 		p==DynamicFunc__SHA224_crypt_input2_append_input1_base16    || p==DynamicFunc__SHA224_crypt_input2_append_input1    ||
@@ -8772,8 +9160,9 @@ static int isSHA2Func(DYNAMIC_primitive_funcp p) {
 		p==DynamicFunc__SHA256_crypt_input1_overwrite_input2_base16 || p==DynamicFunc__SHA256_crypt_input1_overwrite_input2 ||
 		p==DynamicFunc__SHA256_crypt_input2_overwrite_input1_base16 || p==DynamicFunc__SHA256_crypt_input2_overwrite_input1 ||
 		p==DynamicFunc__SHA256_crypt_input1_to_output1_FINAL ||
-		p==DynamicFunc__SHA256_crypt_input2_to_output1_FINAL ||
-		p==DynamicFunc__SHA384_crypt_input1_append_input2_base16    || p==DynamicFunc__SHA384_crypt_input1_append_input2    ||
+		p==DynamicFunc__SHA256_crypt_input2_to_output1_FINAL)
+		return 2;
+	if (p==DynamicFunc__SHA384_crypt_input1_append_input2_base16    || p==DynamicFunc__SHA384_crypt_input1_append_input2    ||
 		p==DynamicFunc__SHA384_crypt_input2_append_input1_base16    || p==DynamicFunc__SHA384_crypt_input2_append_input1    ||
 		p==DynamicFunc__SHA384_crypt_input1_overwrite_input1_base16 || p==DynamicFunc__SHA384_crypt_input1_overwrite_input1 ||
 		p==DynamicFunc__SHA384_crypt_input2_overwrite_input2_base16 || p==DynamicFunc__SHA384_crypt_input2_overwrite_input2 ||
@@ -8795,6 +9184,7 @@ static int isSHA2Func(DYNAMIC_primitive_funcp p) {
 
 static int isMD4Func(DYNAMIC_primitive_funcp p) {
 	if (p==DynamicFunc__crypt_md4 ||
+		p==DynamicFunc__set_input_len_32_append_salt_crypt_md4 ||
 		p==DynamicFunc__crypt2_md4 ||
 		p==DynamicFunc__crypt_md4_in1_to_out2 ||
 		p==DynamicFunc__crypt_md4_in2_to_out1)
@@ -8830,9 +9220,19 @@ static int isWHIRLFunc(DYNAMIC_primitive_funcp p) {
 	return 0;
 }
 
+// Primitive sequences, and the fused primitive dynamic_SETUP replaces them with.
+static struct {
+	DYNAMIC_primitive_funcp seq[3], fused;
+} dynamic_fused[] = {
+	{ { DynamicFunc__set_input_len_32, DynamicFunc__append_salt, DynamicFunc__crypt_md5 },
+	  DynamicFunc__set_input_len_32_append_salt_crypt_md5 },
+	{ { DynamicFunc__set_input_len_32, DynamicFunc__append_salt, DynamicFunc__crypt_md4 },
+	  DynamicFunc__set_input_len_32_append_salt_crypt_md4 },
+};
+
 int dynamic_SETUP(DYNAMIC_Setup *Setup, struct fmt_main *pFmt)
 {
-	int i, j, cnt, cnt2, x;
+	int i, j, k, cnt, cnt2, x;
 	DYNAMIC_primitive_funcp *pFuncs;
 
 	if (Setup->flags & MGF_ColonNOTValid)
@@ -9139,7 +9539,7 @@ int dynamic_SETUP(DYNAMIC_Setup *Setup, struct fmt_main *pFmt)
 		pFmt->params.algorithm_name = "64/64 " SHA1_SSE_type " 8x2";
 		pFmt->params.max_keys_per_crypt = 16;
 #elif defined (MD5_SSE_PARA)
-		pFmt->params.algorithm_name = "128/128 " SHA1_SSE_type " 4x4x" STRINGIZE(MD5_SSE_PARA);
+		pFmt->params.algorithm_name = MD5_SSE_BITS " " MD5_SSE_type " 4x4x" STRINGIZE(MD5_SSE_PARA);
 		pFmt->params.max_keys_per_crypt = 16*MD5_SSE_PARA;
 #else
 		pFmt->params.algorithm_name = "128/128 " SHA1_SSE_type " 4x4";
@@ -9293,6 +9693,12 @@ int dynamic_SETUP(DYNAMIC_Setup *Setup, struct fmt_main *pFmt)
 						pFmt->params.algorithm_name = ALGORITHM_NAME_X86_S;
 				}
 				if (isSHA2Func(pFuncs[x])) {
+#if defined(MMX_COEF) && defined(SHA256_SSE_PARA)
+					if (isSHA2Func(pFuncs[x]) == 2 &&
+					    (sha256_use_sse = sha256_sse_wanted()))
+						pFmt->params.algorithm_name = ALGORITHM_NAME_S2_256;
+					else
+#endif
 					if (!strcmp(pFmt->params.algorithm_name, ALGORITHM_NAME))
 						pFmt->params.algorithm_name = ALGORITHM_NAME_S2;
 					else if (!strcmp(pFmt->params.algorithm_name, ALGORITHM_NAME_X86))
@@ -9328,6 +9734,79 @@ int dynamic_SETUP(DYNAMIC_Setup *Setup, struct fmt_main *pFmt)
 			}
 		}
 		curdat.dynamic_FUNCTIONS[j] = NULL;
+
+		// Replace the primitive sequences that have a fused version (see
+		// DynamicFunc__set_input_len_32_append_salt_crypt_md5) with it.
+		for (i = 0; curdat.dynamic_FUNCTIONS[i]; ++i) {
+			for (x = 0; x < ARRAY_COUNT(dynamic_fused); ++x)
+				if (curdat.dynamic_FUNCTIONS[i] == dynamic_fused[x].seq[0] &&
+				    curdat.dynamic_FUNCTIONS[i+1] == dynamic_fused[x].seq[1] &&
+				    curdat.dynamic_FUNCTIONS[i+2] == dynamic_fused[x].seq[2])
+					break;
+			if (x == ARRAY_COUNT(dynamic_fused))
+				continue;
+			curdat.dynamic_FUNCTIONS[i] = dynamic_fused[x].fused;
+			for (k = i+1; (curdat.dynamic_FUNCTIONS[k] = curdat.dynamic_FUNCTIONS[k+2]); ++k)
+				;
+			j -= 2;
+		}
+
+		curdat.salt_prefix_reuse = 0;
+#if ARCH_LITTLE_ENDIAN
+		// md5($s.$p) and md4($s.$p) style scripts: crypt_all() can leave the keys
+		// in input 1 and only swap the salt in front of them, see there.
+		if (j > 3 && curdat.dynamic_FIXED_SALT_SIZE && !curdat.store_keys_in_input &&
+		    !curdat.store_keys_normal_but_precompute_md5_to_output2 &&
+		    curdat.dynamic_FUNCTIONS[0] == DynamicFunc__clean_input &&
+		    curdat.dynamic_FUNCTIONS[1] == DynamicFunc__append_salt &&
+		    curdat.dynamic_FUNCTIONS[2] == DynamicFunc__append_keys) {
+			for (i = 3; curdat.dynamic_FUNCTIONS[i]; ++i)
+				if (curdat.dynamic_FUNCTIONS[i] != DynamicFunc__crypt_md5 &&
+				    curdat.dynamic_FUNCTIONS[i] != DynamicFunc__crypt_md4)
+					break;
+			curdat.salt_prefix_reuse = !curdat.dynamic_FUNCTIONS[i];
+		}
+#endif
+		pFmt->methods.salt_compare = curdat.salt_prefix_reuse ? salt_compare : NULL;
+
+#ifdef _OPENMP
+		// Split the keys up among the threads, unless the script keeps state
+		// outside of the per key arrays: the FreeBSD md5crypt code, the raw
+		// sha1 input, or (without SHA1_SSE_PARA) the SHA1 FINAL crypts, which
+		// write past the last crypt_key block they fill.
+		curdat.omp_slice = 0;
+		if (omp_get_max_threads() > 1 && curdat.store_keys_in_input != 2 &&
+		    curdat.store_keys_in_input != 3 &&
+		    !(Setup->startFlags&(MGF_FreeBSDMD5Setup|MGF_RAW_SHA1_INPUT))) {
+			int slice = pFmt->params.max_keys_per_crypt;
+#ifdef MMX_COEF
+			if (curdat.dynamic_use_sse) {
+				int blocks = slice / MMX_COEF, para = 1;
+
+				// The SSE code runs MD5_SSE_PARA, MD4_SSE_PARA or SHA_BLOCKS
+				// blocks at a time, so a slice holds a multiple of each.
+				while (para % OMP_MD5_PARA || para % OMP_MD4_PARA || para % SHA_BLOCKS)
+					++para;
+				slice = (blocks - blocks % para) * MMX_COEF;
+#ifndef SHA1_SSE_PARA
+				for (i = 0; curdat.dynamic_FUNCTIONS[i]; ++i)
+					if (curdat.dynamic_FUNCTIONS[i] == DynamicFunc__SHA1_crypt_input1_to_output1_FINAL ||
+					    curdat.dynamic_FUNCTIONS[i] == DynamicFunc__SHA1_crypt_input2_to_output1_FINAL)
+						slice = 0;
+#endif
+			}
+#endif
+#if MD5_X2
+			slice &= ~1;
+#endif
+			if (slice > 0) {
+				curdat.omp_slice = slice;
+				pFmt->params.max_keys_per_crypt = slice * omp_get_max_threads() * OMP_SCALE;
+				pFmt->params.flags |= FMT_OMP;
+			}
+		}
+		dynamic_omp_slice(0, 0);
+#endif
 	}
 	if (!Setup->pPreloads || Setup->pPreloads[0].ciphertext == NULL)
 	{
@@ -9525,8 +10004,12 @@ static struct fmt_main *dynamic_Get_fmt_main(int which)
 void dynamic_RESET(struct fmt_main *fmt)
 {
 	memset(&curdat, 0, sizeof(curdat));
+#ifdef _OPENMP
+	dynamic_omp_slice(0, 0);
+#endif
 	m_count = 0;
 	keys_dirty = 0;
+	prefix_saltlen = -1;
 	cursalt=cursalt2=username=0;
 	saltlen=saltlen2=usernamelen=0;
 	// make 'sure' we startout with blank inputs.
@@ -9587,6 +10070,7 @@ struct fmt_main *dynamic_THIN_FORMAT_LINK(struct fmt_main *pFmt, char *ciphertex
 	pFmt->methods.set_salt   = pFmtLocal->methods.set_salt;
 	pFmt->methods.salt       = pFmtLocal->methods.salt;
 	pFmt->methods.salt_hash  = pFmtLocal->methods.salt_hash;
+	pFmt->methods.salt_compare = pFmtLocal->methods.salt_compare;
 	pFmt->methods.split      = pFmtLocal->methods.split;
 	pFmt->methods.set_key    = pFmtLocal->methods.set_key;
 	pFmt->methods.get_key    = pFmtLocal->methods.get_key;
@@ -101,6 +101,8 @@ static Dynamic_Predicate_t Dynamic_Predicate[] =  {
 	{ "DynamicFunc__crypt_to_input_raw_Overwrite_NoLen_but_setlen_in_SSE", DynamicFunc__crypt_md5_to_input_raw_Overwrite_NoLen_but_setlen_in_SSE }, // support deprecated function
 	{ "DynamicFunc__append_salt", DynamicFunc__append_salt },
 	{ "DynamicFunc__set_input_len_32", DynamicFunc__set_input_len_32 },
+	{ "DynamicFunc__set_input_len_32_append_salt_crypt_md5", DynamicFunc__set_input_len_32_append_salt_crypt_md5 },
+	{ "DynamicFunc__set_input_len_32_append_salt_crypt_md4", DynamicFunc__set_input_len_32_append_salt_crypt_md4 },
 	{ "DynamicFunc__clean_input2", DynamicFunc__clean_input2 },
 	{ "DynamicFunc__clean_input2_kwik", DynamicFunc__clean_input2_kwik },
 	{ "DynamicFunc__clean_input2_full", DynamicFunc__clean_input2_full },
@@ -22,13 +22,14 @@
 #include "options.h"
 #ifdef HAVE_MPI
 #include "john-mpi.h"
-
-static unsigned long long mpi_line = 0;
 #endif
 
 static char int_word[PLAINTEXT_BUFFER_SIZE];
 static char rec_word[PLAINTEXT_BUFFER_SIZE];
 
+/* Number of candidates generated so far, for splitting them over --node's */
+static unsigned long long node_line, rec_node_line;
+
 unsigned int ext_flags = 0;
 static char *ext_mode;
 
@@ -259,6 +260,7 @@ static void save_state(FILE *file)
 	do {
 		fprintf(file, "%d\n", (int)*ptr);
 	} while (*ptr++);
+	fprintf(file, "%llu\n", rec_node_line);
 }
 
 static int restore_state(FILE *file)
@@ -276,10 +278,11 @@ static int restore_state(FILE *file)
 		if (++count >= PLAINTEXT_BUFFER_SIZE) return 1;
 	} while ((*internal++ = *external++ = c));
 
+	/* Older session files do not have the candidate count */
+	if (fscanf(file, "%llu\n", &node_line) != 1)
+		node_line = options.node_min;
+
 	c_execute(c_lookup("restore"));
-#ifdef HAVE_MPI
-	mpi_line = mpi_id + 1;  // We just need the correct modulus
-#endif
 
 	return 0;
 }
@@ -287,6 +290,7 @@ static int restore_state(FILE *file)
 static void fix_state(void)
 {
 	strcpy(rec_word, int_word);
+	rec_node_line = node_line;
 }
 
 void do_external_crack(struct db_main *db)
@@ -296,9 +300,11 @@ void do_external_crack(struct db_main *db)
 
 	log_event("Proceeding with external mode: %.100s", ext_mode);
 
-#ifdef HAVE_MPI
-	if (mpi_p > 1) log_event("MPI: each node will process 1/%u of candidates", mpi_p);
-#endif
+	if (options.node_count)
+		log_event("- Node %u-%u/%u: will process %u/%u of candidates",
+		    options.node_min, options.node_max, options.node_count,
+		    options.node_max - options.node_min + 1,
+		    options.node_count);
 
 	internal = (unsigned char *)int_word;
 	external = ext_word;
@@ -324,10 +330,8 @@ void do_external_crack(struct db_main *db)
 				continue;
 		}
 
-#ifdef HAVE_MPI
-		// MPI distribution
-		if (mpi_line++ % mpi_p != mpi_id) continue;
-#endif
+		// Node distribution
+		if (options.node_count && !NODE_OWNS(node_line++)) continue;
 		int_word[0] = ext_word[0];
 		if ((int_word[1] = ext_word[1])) {
 			internal = (unsigned char *)&int_word[2];
@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include "params.h"
+#include "memory.h"
 #include "formats.h"
 #ifndef BENCH_BUILD
 #include "options.h"
@@ -63,7 +64,7 @@ char *fmt_self_test(struct fmt_main *format)
 	struct fmt_tests *current;
 	char *ciphertext, *plaintext;
 	int i, ntests, done, index, max, size;
-	void *binary, *salt;
+	void *binary, *salt, *prev_salt = NULL;
 #if defined(DEBUG) && !defined(BENCH_BUILD)
 	int validkiller = 0;
 #endif
@@ -244,6 +245,28 @@ char *fmt_self_test(struct fmt_main *format)
 			return s_size;
 		}
 
+/* Crypt the same keys for the previous salt and this one in a group, and
+ * check that we get this salt's outputs back when it's selected */
+		if (format->methods.crypt_all_salts && format->params.salt_size) {
+			void *salts[2];
+
+			if (!prev_salt) {
+				prev_salt = mem_alloc_tiny(format->params.salt_size,
+				    MEM_ALIGN_WORD);
+				memcpy(prev_salt, salt, format->params.salt_size);
+			}
+			salts[0] = prev_salt;
+			salts[1] = salt;
+			format->methods.crypt_all_salts(index + 1, salts, 2);
+			format->methods.select_salt(1);
+
+			if (!format->methods.cmp_all(binary, index + 1) ||
+			    !format->methods.cmp_one(binary, index))
+				return "crypt_all_salts";
+
+			memcpy(prev_salt, salt, format->params.salt_size);
+		}
+
 /* Remove some old keys to better test cmp_all() */
 		if (index & 1)
 			format->methods.set_key("", index);
@@ -48,6 +48,11 @@ struct fmt_main;
 /* We've already warned the user about hashes of this type being present */
 #define FMT_WARNED			0x80000000
 
+/*
+ * Maximum number of salts passed to one crypt_all_salts() call.
+ */
+#define FMT_SALT_GROUP			8
+
 /*
  * A password to test the methods for correct operation.
  */
@@ -181,6 +186,22 @@ struct fmt_methods {
 
 /* Compares an ASCII ciphertext against a particular crypt_all() output */
 	int (*cmp_exact)(char *source, int index);
+
+/* Optional (NULL if not supported): same as calling set_salt() and
+ * crypt_all() for each of up to FMT_SALT_GROUP salts, but the same keys are
+ * run over all of the salts at once while they're hot in cache.  The outputs
+ * for salts[index] are then made the ones used by get_hash[] and cmp_*()
+ * with select_salt(index). Neither method changes the salt set with
+ * set_salt(). */
+	void (*crypt_all_salts)(int count, void **salts, int salt_count);
+	void (*select_salt)(int index);
+
+/* Optional (NULL if not supported): compares two salts (in internal
+ * representation) the way strcmp() does. The loader sorts the salts with
+ * it, so that salts which share some of the per-salt work end up next to
+ * each other in the cracking loop and the format may reuse that work from
+ * the previous salt. */
+	int (*salt_compare)(void *x, void *y);
 };
 
 /*
@@ -29,6 +29,7 @@ static char *opt_find(struct opt_entry *list, char *opt,
 	char *name, *param;
 	size_t length;
 	struct opt_entry *found;
+	int ambiguous;
 
 	if (opt[0] == '-') {
 		if (*(name = opt + 1) == '-') name++;
@@ -41,18 +42,29 @@ static char *opt_find(struct opt_entry *list, char *opt,
 			length = strlen(name);
 
 		found = NULL;
+		ambiguous = 0;
 		do {
 			if (length <= strlen(list->name))
 			if (!strncmp(name, list->name, length)) {
-				if (!found)
+/* The full name of an option is never ambiguous, even if it's a prefix of
+ * another one's ("--markov" vs. "--markov-stats") */
+				if (length == strlen(list->name)) {
 					found = list;
-				else {
-					*entry = NULL;
-					return NULL;
+					ambiguous = 0;
+					break;
 				}
+				if (!found)
+					found = list;
+				else
+					ambiguous = 1;
 			}
 		} while ((++list)->name);
 
+		if (ambiguous) {
+			*entry = NULL;
+			return NULL;
+		}
+
 		if ((*entry = found))
 			return param;
 		else
@@ -650,14 +650,16 @@ void do_incremental_crack(struct db_main *db, char *mode)
 		chars[pos] = (chars_table)mem_alloc(sizeof(*chars[0]));
 
 	rec_compat = 0;
-#ifdef HAVE_MPI
-	/* *ptr has to start at different positions so they don't overlap */
-	rec_entry = mpi_id;
-#else
 	rec_entry = 0;
-#endif
 	memset(rec_numbers, 0, sizeof(rec_numbers));
 
+	if (options.node_count)
+		log_event("- Node %u-%u/%u: processing %u/%u of charset order "
+			"entries", options.node_min, options.node_max,
+			options.node_count,
+			options.node_max - options.node_min + 1,
+			options.node_count);
+
 	status_init(get_progress, 0);
 
 	rec_restore_mode(restore_state);
@@ -675,11 +677,9 @@ void do_incremental_crack(struct db_main *db, char *mode)
 		entry++;
 		length = *ptr++; fixed = *ptr++; count = *ptr++;
 
-#ifdef HAVE_MPI
-		/* increment *ptr with the number of processors after this */
-		ptr = ptr + (3 * (mpi_p - 1));
-		entry = entry + mpi_p - 1;
-#endif
+		/* Entries are dealt out to the nodes round-robin */
+		if (!NODE_OWNS(entry)) continue;
+
 		if (length >= CHARSET_LENGTH ||
 			fixed > length ||
 			count >= CHARSET_SIZE) inc_format_error(charset);
@@ -704,9 +704,8 @@ void do_incremental_crack(struct db_main *db, char *mode)
 
 		if (!length && !min_length) {
 			min_length = 1;
-#ifdef HAVE_MPI
-			if (mpi_id == 0)
-#endif
+			/* The empty password is tried by the first node only */
+			if (options.node_min <= 1)
 			if (crk_process_key("")) break;
 		}
 
@@ -37,6 +37,7 @@
 #include "signals.h"
 #include "common.h"
 #include "idle.h"
+#include "tune.h"
 #include "formats.h"
 #include "loader.h"
 #include "logger.h"
@@ -214,6 +215,7 @@ extern int racf2john(int argc, char **argv);
 extern int pwsafe2john(int argc, char **argv);
 #endif
 extern int zip2john(int argc, char **argv);
+extern int batch2john(int argc, char **argv);
 
 static struct db_main database;
 static struct fmt_main dummy_format;
@@ -375,6 +377,9 @@ static void john_log_format(void)
 	if (mpi_p > 1)
 		log_event("- MPI mode: %u nodes, this one running on %s", mpi_p, mpi_name);
 #endif
+	if (options.node_count)
+		log_event("- Node numbers %u-%u of %u", options.node_min,
+			options.node_max, options.node_count);
 	/* make sure the format is properly initialized */
 	fmt_init(database.format);
 
@@ -426,23 +431,10 @@ static void john_load(void)
 	if (options.flags & FLG_EXTERNAL_CHK)
 		ext_init(options.external, NULL);
 
+/* The plaintexts are read by do_makechars(), as it goes */
 	if (options.flags & FLG_MAKECHR_CHK) {
 		options.loader.flags |= DB_CRACKED;
 		ldr_init_database(&database, &options.loader);
-
-		if (options.flags & FLG_PASSWD) {
-			ldr_show_pot_file(&database, options.loader.activepot);
-
-			database.options->flags |= DB_PLAINTEXTS;
-			if ((current = options.passwd->head))
-			do {
-				ldr_show_pw_file(&database, current->data);
-			} while ((current = current->next));
-		} else {
-			database.options->flags |= DB_PLAINTEXTS;
-			ldr_show_pot_file(&database, options.loader.activepot);
-		}
-
 		return;
 	}
 
@@ -1246,6 +1238,9 @@ static void john_run(void)
 					fprintf(stderr, "Note: Running both MPI and OMP (see doc/README.mpi)\n");
 		}
 #endif
+		if (!(options.flags & FLG_STDOUT))
+			tune_keys_per_crypt(&database);
+
 		if (options.flags & FLG_SINGLE_CHK)
 			do_single_crack(&database);
 		else
@@ -1442,6 +1437,11 @@ int main(int argc, char **argv)
 		return hccap2john(argc, argv);
 	}
 
+	if (!strcmp(name, "batch2john")) {
+		CPU_detect_or_fallback(argv, 0);
+		return batch2john(argc, argv);
+	}
+
 #ifdef HAVE_MPI
 	mpi_setup(argc, argv);
 #else
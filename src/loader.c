@@ -52,12 +52,17 @@ int ldr_in_pot = 0;
 
 static char *no_username = "?";
 
-static void read_file(struct db_main *db, char *name, int flags,
-	void (*process_line)(struct db_main *db, char *line))
+/*
+ * With offset set, starts reading at *offset and sets it to the end of the
+ * last complete line read.
+ */
+static void read_file_at(struct db_main *db, char *name, int flags,
+	void (*process_line)(struct db_main *db, char *line), long *offset)
 {
 	struct stat file_stat;
 	FILE *file;
 	char line[LINE_BUFFER_SIZE];
+	long pos;
 
 	if (flags & RF_ALLOW_DIR) {
 		if (stat(name, &file_stat)) {
@@ -73,7 +78,17 @@ static void read_file(struct db_main *db, char *name, int flags,
 		pexit("fopen: %s", path_expand(name));
 	}
 
+	if (offset && *offset && fseek(file, *offset, SEEK_SET))
+		pexit("fseek: %s", path_expand(name));
+
 	while (fgets(line, sizeof(line), file)) {
+		if (offset) {
+/* Leave a line that is still being written for the next time */
+			if (!strchr(line, '\n') && feof(file))
+				break;
+			if ((pos = ftell(file)) < 0) pexit("ftell");
+			*offset = pos;
+		}
 		process_line(db, line);
 		check_abort(0);
 	}
@@ -83,6 +98,12 @@ static void read_file(struct db_main *db, char *name, int flags,
 	if (fclose(file)) pexit("fclose");
 }
 
+static void read_file(struct db_main *db, char *name, int flags,
+	void (*process_line)(struct db_main *db, char *line))
+{
+	read_file_at(db, name, flags, process_line, NULL);
+}
+
 void ldr_init_database(struct db_main *db, struct db_options *options)
 {
 	db->loaded = 0;
@@ -95,6 +116,9 @@ void ldr_init_database(struct db_main *db, struct db_options *options)
 	db->password_hash = NULL;
 	db->password_hash_func = NULL;
 
+	db->salt_fp = NULL;
+	db->salt_fp_size = 0;
+
 	if (options->flags & DB_CRACKED) {
 		db->salt_hash = NULL;
 
@@ -116,6 +140,7 @@ void ldr_init_database(struct db_main *db, struct db_options *options)
 	}
 
 	list_init(&db->plaintexts);
+	db->plaintext_hook = NULL;
 
 	db->salt_count = db->password_count = db->guess_count = 0;
 
@@ -150,6 +175,95 @@ static void ldr_init_password_hash(struct db_main *db)
 	memset(db->password_hash, 0, size);
 }
 
+/*
+ * Fingerprint of a salt's binary contents, for the loader's salt index.
+ */
+static ARCH_WORD_64 ldr_salt_fp(void *salt, int size)
+{
+	unsigned char *p = salt;
+	ARCH_WORD_64 h = size, w;
+
+	while (size >= 8) {
+		memcpy(&w, p, 8);
+		h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+		h ^= h >> 29;
+		p += 8;
+		size -= 8;
+	}
+	while (size--)
+		h = (h ^ *p++) * 0x100000001b3ULL;
+
+	h ^= h >> 32;
+	h *= 0xd6e8feb86659fd93ULL;
+	h ^= h >> 32;
+
+	return h;
+}
+
+/*
+ * Salts are looked up by fingerprint rather than by walking the salt_hash[]
+ * bucket for the format's salt_hash(), which may be short (or is always 0
+ * for formats without one), so loading many salts doesn't go quadratic.
+ * The salt_hash[] buckets are still kept, as they give the salts order.
+ * Open addressing, kept at most half full.
+ */
+static struct db_salt *ldr_find_salt(struct db_main *db, void *salt,
+	ARCH_WORD_64 fp)
+{
+	struct db_salt_fp *entry;
+	int mask = db->salt_fp_size - 1;
+	int index;
+
+	if (!db->salt_fp)
+		return NULL;
+
+	index = (int)fp & mask;
+	while ((entry = &db->salt_fp[index])->salt) {
+		if (entry->fp == fp && !memcmp(entry->salt->salt, salt,
+		    db->format->params.salt_size))
+			return entry->salt;
+		index = (index + 1) & mask;
+	}
+
+	return NULL;
+}
+
+static void ldr_put_salt_fp(struct db_main *db, struct db_salt *salt,
+	ARCH_WORD_64 fp)
+{
+	int mask = db->salt_fp_size - 1;
+	int index = (int)fp & mask;
+
+	while (db->salt_fp[index].salt)
+		index = (index + 1) & mask;
+	db->salt_fp[index].fp = fp;
+	db->salt_fp[index].salt = salt;
+}
+
+static void ldr_add_salt(struct db_main *db, struct db_salt *salt,
+	ARCH_WORD_64 fp)
+{
+	struct db_salt_fp *old;
+	int old_size, index;
+
+	if (db->salt_count * 2 >= db->salt_fp_size) {
+		old = db->salt_fp;
+		old_size = db->salt_fp_size;
+
+		db->salt_fp_size = old_size ? old_size * 2 : 0x100;
+		db->salt_fp = mem_alloc(db->salt_fp_size * sizeof(*old));
+		memset(db->salt_fp, 0, db->salt_fp_size * sizeof(*old));
+
+		for (index = 0; index < old_size; index++)
+		if (old[index].salt)
+			ldr_put_salt_fp(db, old[index].salt, old[index].fp);
+
+		MEM_FREE(old);
+	}
+
+	ldr_put_salt_fp(db, salt, fp);
+}
+
 static char *ldr_get_field(char **ptr, char field_sep_char)
 {
 	static char *last;
@@ -439,6 +553,7 @@ static void ldr_load_pw_line(struct db_main *db, char *line)
 	char *piece;
 	void *binary, *salt;
 	int salt_hash, pw_hash;
+	ARCH_WORD_64 salt_fp;
 	struct db_salt *current_salt, *last_salt;
 	struct db_password *current_pw, *last_pw;
 	struct list_main *words;
@@ -521,16 +636,10 @@ static void ldr_load_pw_line(struct db_main *db, char *line)
 		}
 
 		salt = format->methods.salt(piece);
-		salt_hash = format->methods.salt_hash(salt);
+		salt_fp = ldr_salt_fp(salt, format->params.salt_size);
 
-		if ((current_salt = db->salt_hash[salt_hash]))
-		do {
-			if (!memcmp(current_salt->salt, salt,
-			    format->params.salt_size))
-				break;
-		} while ((current_salt = current_salt->next));
-
-		if (!current_salt) {
+		if (!(current_salt = ldr_find_salt(db, salt, salt_fp))) {
+			salt_hash = format->methods.salt_hash(salt);
 			last_salt = db->salt_hash[salt_hash];
 			current_salt = db->salt_hash[salt_hash] =
 				mem_alloc_tiny(salt_size, MEM_ALIGN_WORD);
@@ -550,6 +659,7 @@ static void ldr_load_pw_line(struct db_main *db, char *line)
 			if (db->options->flags & DB_WORDS)
 				current_salt->keys = NULL;
 
+			ldr_add_salt(db, current_salt, salt_fp);
 			db->salt_count++;
 		}
 
@@ -762,6 +872,59 @@ static void ldr_filter_salts(struct db_main *db)
 	} while ((current = current->next));
 }
 
+/*
+ * Sort the salts with the format's salt_compare() method, if it has one.
+ * This is a merge sort, so salts which compare equal keep their order.
+ */
+static void ldr_sort_salts(struct db_main *db)
+{
+	int (*compare)(void *x, void *y);
+	struct db_salt *list, *p, *q, *e, *tail;
+	int size, merges, psize, qsize;
+
+	if (!db->format ||
+	    !(compare = db->format->methods.salt_compare) ||
+	    !(list = db->salts)) return;
+
+	for (size = 1; ; size <<= 1) {
+		p = list;
+		list = tail = NULL;
+		merges = 0;
+
+		while (p) {
+			merges++;
+			q = p;
+			for (psize = 0; psize < size && q; psize++)
+				q = q->next;
+			qsize = size;
+
+			while (psize || (qsize && q)) {
+				if (!psize) {
+					e = q; q = q->next; qsize--;
+				} else if (!qsize || !q ||
+				    compare(p->salt, q->salt) <= 0) {
+					e = p; p = p->next; psize--;
+				} else {
+					e = q; q = q->next; qsize--;
+				}
+
+				if (tail)
+					tail->next = e;
+				else
+					list = e;
+				tail = e;
+			}
+
+			p = q;
+		}
+
+		tail->next = NULL;
+		if (merges <= 1) break;
+	}
+
+	db->salts = list;
+}
+
 /*
  * Allocate memory for and initialize the hash table for this salt if needed.
  * Also initialize salt->count (the number of password hashes for this salt).
@@ -802,24 +965,19 @@ static void ldr_init_hash_for_salt(struct db_main *db, struct db_salt *salt)
 	} while ((current = current->next));
 }
 
-/*
- * Decide on whether to use a hash table and on its size for each salt, call
- * ldr_init_hash_for_salt() to allocate and initialize the hash tables.
- */
-static void ldr_init_hash(struct db_main *db)
+int ldr_hash_size(struct fmt_main *format, int count)
 {
-	struct db_salt *current;
 	int threshold, size;
 
 	threshold = password_hash_thresholds[0];
-	if (db->format && (db->format->params.flags & FMT_BS)) {
+	if (format && (format->params.flags & FMT_BS)) {
 /*
  * Estimate the complexity of DES_bs_get_hash() for each computed hash (but
  * comparing it against less than 1 loaded hash on average due to the use of a
  * hash table) vs. the complexity of DES_bs_cmp_all() for all computed hashes
  * at once (but calling it for each loaded hash individually).
  */
-		threshold = db->format->params.min_keys_per_crypt * 5;
+		threshold = format->params.min_keys_per_crypt * 5;
 #if DES_BS_VECTOR
 		threshold /= ARCH_BITS_LOG * DES_BS_VECTOR;
 #else
@@ -828,22 +986,32 @@ static void ldr_init_hash(struct db_main *db)
 		threshold++;
 	}
 
-	if ((current = db->salts))
-	do {
-		size = -1;
-		if (current->count >= threshold && mem_saving_level < 3)
-			for (size = PASSWORD_HASH_SIZES - 1; size >= 0; size--)
-				if (current->count >=
-				    password_hash_thresholds[size] &&
-				    db->format->methods.binary_hash[size] &&
-				    db->format->methods.binary_hash[size] !=
-				    fmt_default_binary_hash)
-					break;
+	size = -1;
+	if (count >= threshold && mem_saving_level < 3)
+		for (size = PASSWORD_HASH_SIZES - 1; size >= 0; size--)
+			if (count >= password_hash_thresholds[size] &&
+			    format->methods.binary_hash[size] &&
+			    format->methods.binary_hash[size] !=
+			    fmt_default_binary_hash)
+				break;
+
+	if (mem_saving_level >= 2)
+		size--;
+
+	return size;
+}
 
-		if (mem_saving_level >= 2)
-			size--;
+/*
+ * Decide on whether to use a hash table and on its size for each salt, call
+ * ldr_init_hash_for_salt() to allocate and initialize the hash tables.
+ */
+static void ldr_init_hash(struct db_main *db)
+{
+	struct db_salt *current;
 
-		current->hash_size = size;
+	if ((current = db->salts))
+	do {
+		current->hash_size = ldr_hash_size(db->format, current->count);
 		ldr_init_hash_for_salt(db, current);
 	} while ((current = current->next));
 }
@@ -853,9 +1021,11 @@ void ldr_fix_database(struct db_main *db)
 	ldr_init_salts(db);
 	MEM_FREE(db->password_hash);
 	MEM_FREE(db->salt_hash);
+	MEM_FREE(db->salt_fp);
 
 	ldr_filter_salts(db);
 	ldr_remove_marked(db);
+	ldr_sort_salts(db);
 
 	ldr_init_hash(db);
 
@@ -912,7 +1082,10 @@ static void ldr_show_pot_line(struct db_main *db, char *line)
 		} while (*pos++);
 
 		if (db->options->flags & DB_PLAINTEXTS) {
-			list_add(db->plaintexts, line);
+			if (db->plaintext_hook)
+				db->plaintext_hook(line);
+			else
+				list_add(db->plaintexts, line);
 			return;
 		}
 
@@ -940,6 +1113,17 @@ void ldr_show_pot_file(struct db_main *db, char *name)
 #endif
 }
 
+void ldr_show_pot_file_at(struct db_main *db, char *name, long *offset)
+{
+#ifdef HAVE_CRYPT
+	ldr_in_pot = 1;
+#endif
+	read_file_at(db, name, RF_ALLOW_MISSING, ldr_show_pot_line, offset);
+#ifdef HAVE_CRYPT
+	ldr_in_pot = 0;
+#endif
+}
+
 static void ldr_show_pw_line(struct db_main *db, char *line)
 {
 	int show;
@@ -1031,6 +1215,9 @@ static void ldr_show_pw_line(struct db_main *db, char *line)
 				if (show) {
 					printf("%s", current->plaintext);
 				} else
+				if (db->plaintext_hook)
+					db->plaintext_hook(current->plaintext);
+				else
 					list_add(db->plaintexts,
 						current->plaintext);
 
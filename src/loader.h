@@ -12,6 +12,7 @@
 #ifndef _JOHN_LOADER_H
 #define _JOHN_LOADER_H
 
+#include "common.h"
 #include "params.h"
 #include "list.h"
 #include "formats.h"
@@ -122,6 +123,14 @@ struct db_salt {
 	struct db_keys *keys;
 };
 
+/*
+ * Loader's salt index entry: a salt and a fingerprint of its contents.
+ */
+struct db_salt_fp {
+	ARCH_WORD_64 fp;
+	struct db_salt *salt;
+};
+
 /*
  * Structure to hold a cracked password.
  */
@@ -217,6 +226,10 @@ struct db_main {
 	struct db_salt **salt_hash;
 	struct db_password **password_hash;
 
+/* Salt index by fingerprint, used while loading; size is a power of 2 */
+	struct db_salt_fp *salt_fp;
+	int salt_fp_size;
+
 /* binary_hash function used by the loader itself */
 	int (*password_hash_func)(void *binary);
 
@@ -226,6 +239,9 @@ struct db_main {
 /* Cracked plaintexts list */
 	struct list_main *plaintexts;
 
+/* If set, gets the cracked plaintexts instead of the list above */
+	void (*plaintext_hook)(char *plaintext);
+
 /* Number of salts, passwords and guesses */
 	int salt_count, password_count, guess_count;
 
@@ -258,11 +274,24 @@ extern void ldr_load_pot_file(struct db_main *db, char *name);
  */
 extern void ldr_fix_database(struct db_main *db);
 
+/*
+ * Returns the hash table size code ldr_fix_database() picks for a salt
+ * with count password hashes of this format, or -1 for no hash table.
+ */
+extern int ldr_hash_size(struct fmt_main *format, int count);
+
 /*
  * Loads cracked passwords into the database.
  */
 extern void ldr_show_pot_file(struct db_main *db, char *name);
 
+/*
+ * As above, but starts at *offset into the pot file and sets it to where
+ * the next call should continue from.
+ */
+extern void ldr_show_pot_file_at(struct db_main *db, char *name,
+	long *offset);
+
 /*
  * Shows cracked passwords.
  */
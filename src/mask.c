@@ -11,6 +11,8 @@
 #include <string.h>
 
 #include "cracker.h"
+#include "logger.h"
+#include "options.h"
 #include "mask.h"
 
 static char alpha_low_set[] = {
@@ -47,6 +49,7 @@ static void mask_generate(char *param)
     unsigned key_len = 0;
     int index;
     int first_mask_index = -1, last_mask_index = -1;
+    unsigned long long keyspace = 1, start, end, pos;
     
     char *ch = param;
     
@@ -90,41 +93,63 @@ static void mask_generate(char *param)
     key[key_len] = '\0';
 
     if (first_mask_index == -1) { //No mask
-        crk_process_key(key);
+        if (options.node_min <= 1)
+            crk_process_key(key);
         return;
     }
-    
-    index = last_mask_index;
-    do {
-        switch (mask_type[index]) {
-            case constant:
-                break;
-            case low_char:
-                key[index] = alpha_low_set[maskset_pos[index]];
-                break;
-            case up_char:
-                key[index] = alpha_up_set[maskset_pos[index]];
-                break;
-            case number:
-                key[index] = num_set[maskset_pos[index]];
-                break;
-            default:
-                break;
+
+    for (index = first_mask_index; index <= last_mask_index; index++)
+        if (mask_type[index] != constant)
+            keyspace *= maskset_num[index];
+
+    // Each node gets a contiguous slice of the keyspace by index
+    start = 0;
+    end = keyspace;
+    if (options.node_count) {
+        start = keyspace / options.node_count * (options.node_min - 1);
+        if (options.node_max != options.node_count)
+            end = keyspace / options.node_count * options.node_max;
+        log_event("- Node %u-%u/%u: mask keys %llu - %llu of %llu",
+            options.node_min, options.node_max, options.node_count,
+            start, end, keyspace);
+    }
+
+    // Position the key at the start index, last position changes fastest
+    pos = start;
+    for (index = last_mask_index; index >= first_mask_index; index--) {
+        if (mask_type[index] == constant)
+            continue;
+        maskset_pos[index] = pos % maskset_num[index];
+        pos /= maskset_num[index];
+    }
+
+    for (pos = start; pos < end; pos++) {
+        for (index = first_mask_index; index <= last_mask_index; index++) {
+            switch (mask_type[index]) {
+                case low_char:
+                    key[index] = alpha_low_set[maskset_pos[index]];
+                    break;
+                case up_char:
+                    key[index] = alpha_up_set[maskset_pos[index]];
+                    break;
+                case number:
+                    key[index] = num_set[maskset_pos[index]];
+                    break;
+                default:
+                    break;
+            }
         }
-        if (index == last_mask_index) {
-            crk_process_key(key);
-            printf("key: %s\n", key);
-            maskset_pos[index]++;
-        } else
-            index++;
-        while (maskset_pos[index] == maskset_num[index]) {
+        if (crk_process_key(key))
+            break;
+
+        for (index = last_mask_index; index >= first_mask_index; index--) {
+            if (mask_type[index] == constant)
+                continue;
+            if (++maskset_pos[index] < maskset_num[index])
+                break;
             maskset_pos[index] = 0;
-            index--;
-            if (index < first_mask_index) break;
-            if (mask_type[index] != constant)
-                maskset_pos[index]++;
         }
-    } while (index <= last_mask_index && index >= first_mask_index);
+    }
 }
 
 void do_mask_crack(struct db_main *db, char *param)
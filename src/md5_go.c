@@ -35,6 +35,10 @@
 /* Output words */
 ARCH_WORD_32 MD5_out[4];
 ARCH_WORD_32 *pMD5_out=MD5_out;
+#ifdef _OPENMP
+// MD5_Go2() is called from the threads of the dynamic format
+#pragma omp threadprivate(pMD5_out)
+#endif
 
 #if !ARCH_LITTLE_ENDIAN
 /* Bit-swapped output words */
@@ -76,6 +80,9 @@ ARCH_WORD_32 MD5_bitswapped_out[4];
 	SET(n)
 #else
 static MD5_u32plus work[16];
+#ifdef _OPENMP
+#pragma omp threadprivate(work)
+#endif
 #define SET(n) \
 	(work[(n)] = \
 	(MD5_u32plus)ptr[(n) * 4] | \
@@ -103,6 +103,8 @@ static int show_pwd_rnbs(struct s_pwd * pwd)
 			if(show_pwd_rnbs(pwd))
 				return 1;
 		}
+		if(gidx>gend)
+			return 1;
 		if( (pwd->len >= gmin_len) && (pwd->level >= gmin_level) )
 		{
 			pass = (char*) pwd->password;
@@ -147,6 +149,8 @@ static int show_pwd_r(struct s_pwd * pwd, unsigned int bs)
 			if(show_pwd_r(pwd, 1))
 				return 1;
 		i -= nbparts[ pwd->password[pwd->len-1] + pwd->len*256 + pwd->level*256*gmax_len ];
+		if(gidx>gend)
+			return 1;
 		if( (pwd->len >= gmin_len) && (pwd->level >= gmin_level) )
 		{
 			pass = (char*) pwd->password;
@@ -169,6 +173,8 @@ static int show_pwd_r(struct s_pwd * pwd, unsigned int bs)
 			if(show_pwd_r(pwd, 0))
 				return 1;
 		}
+		if(gidx>gend)
+			return 1;
 		if( (pwd->len >= gmin_len) && (pwd->level >= gmin_level) )
 		{
 			pass = (char*) pwd->password;
@@ -209,6 +215,8 @@ static int show_pwd(unsigned long long start)
 		if(show_pwd_r(&pwd, 1))
 			return 1;
 
+		if(gidx>gend)
+			return 1;
 		if( (pwd.len >= gmin_len) && (pwd.level >= gmin_level) )
 		{
 			pass = (char*) pwd.password;
@@ -230,6 +238,8 @@ static int show_pwd(unsigned long long start)
 		pwd.password[1] = 0;
 		if(show_pwd_rnbs(&pwd))
 			return 1;
+		if(gidx>gend)
+			return 1;
 		if( (pwd.len >= gmin_len) && (pwd.level >= gmin_level) )
 		{
 			pass = (char*) pwd.password;
@@ -256,7 +266,7 @@ static int get_progress(int *hundth_perc)
 	lltmp = gidx;
 	lltmp -= gstart;
 	lltmp *= 10000;
-	lltmp /= (gend-gstart);
+	lltmp /= (gend-gstart+1);
 
 	hun = (unsigned)lltmp;
 	per = (int)(hun/100);
@@ -601,6 +611,29 @@ void get_markov_start_end(char *start_token, char *end_token,
 	}
 }
 
+/*
+ * Returns the name of the nbparts[] cache file for the stats file, level
+ * and length, or NULL if MarkovCache isn't set.
+ */
+static char *get_markov_cache(char *statfile, unsigned int level,
+                              unsigned int maxlen)
+{
+	char *dir, *base, *name;
+
+	if (!(dir = cfg_get_param(SECTION_OPTIONS, NULL, "MarkovCache")) ||
+	    !*dir)
+		return NULL;
+
+	base = strrchr(statfile, '/');
+	base = base ? base + 1 : statfile;
+	name = mem_alloc(strlen(dir) + strlen(base) + 32);
+	sprintf(name, "%s/%s.%u-%u.nbp", dir, base, level, maxlen);
+	dir = str_alloc_copy(path_expand(name));
+	MEM_FREE(name);
+
+	return dir;
+}
+
 void do_markov_crack(struct db_main *db, char *mkv_param)
 {
 	char *statfile = NULL;
@@ -609,10 +642,7 @@ void do_markov_crack(struct db_main *db, char *mkv_param)
 	char *param = NULL;
 	unsigned int mkv_minlevel, mkv_level,  mkv_maxlen, mkv_minlen;
 	unsigned long long mkv_start, mkv_end;
-
-#ifdef HAVE_MPI
 	unsigned long long mkv_size;
-#endif
 
 	if(mkv_param != NULL)
 	{
@@ -640,10 +670,8 @@ void do_markov_crack(struct db_main *db, char *mkv_param)
 	gmin_level = mkv_minlevel;
 	gmin_len = mkv_minlen;
 
-	nbparts = mem_alloc(256*(mkv_level+1)*sizeof(long long)*(mkv_maxlen+1));
-	memset(nbparts, 0, 256*(mkv_level+1)*(mkv_maxlen+1)*sizeof(long long));
-
-	nb_parts(0, 0, 0, mkv_level, mkv_maxlen);
+	init_nbparts(get_markov_cache(statfile, mkv_level, mkv_maxlen),
+	             mkv_level, mkv_maxlen);
 
 	get_markov_start_end(start_token, end_token, nbparts[0], &mkv_start, &mkv_end);
 
@@ -654,27 +682,34 @@ void do_markov_crack(struct db_main *db, char *mkv_param)
 		fprintf(stderr, "%d len=", mkv_level);
 		if(mkv_minlen>0) fprintf(stderr, "%d-", mkv_minlen);
 		fprintf(stderr, "%d pwd="LLd"%s)\n", mkv_maxlen, mkv_end-mkv_start,
-		mpi_p > 1 ? " split over MPI nodes" : "");
-	}
-
-	if (mpi_p > 1) {
-		mkv_size = mkv_end - mkv_start + 1;
-		if (mpi_id != (mpi_p - 1))
-			mkv_end = mkv_start + (mkv_size / mpi_p) * (mpi_id + 1) - 1;
-		mkv_start = mkv_start + (mkv_size / mpi_p) * mpi_id;
+		options.node_count ? " split over nodes" : "");
 	}
-#endif
-	gstart = mkv_start;
-	gend = mkv_end + 10; /* omg !! */
-
-#ifndef HAVE_MPI
+#else
 	fprintf(stderr, "MKV start (stats=%s, lvl=", statfile);
 	if(mkv_minlevel>0) fprintf(stderr, "%d-", mkv_minlevel);
 	fprintf(stderr, "%d len=", mkv_level);
 	if(mkv_minlen>0) fprintf(stderr, "%d-", mkv_minlen);
-	fprintf(stderr, "%d pwd="LLd")\n", mkv_maxlen, mkv_end-mkv_start);
+	fprintf(stderr, "%d pwd="LLd"%s)\n", mkv_maxlen, mkv_end-mkv_start,
+		options.node_count ? " split over nodes" : "");
 #endif
 
+	/* Each node gets a contiguous slice of the index range, so the
+	   others' candidates are never even generated.  A start of 0 is
+	   the same as 1: show_pwd() resumes at index N with the Nth
+	   candidate, so the slices have to count from 1 to line up. */
+	if (options.node_count) {
+		if (!mkv_start)
+			mkv_start = 1;
+		mkv_size = mkv_end - mkv_start + 1;
+		if (options.node_max != options.node_count)
+			mkv_end = mkv_start + (mkv_size / options.node_count) *
+				options.node_max - 1;
+		mkv_start = mkv_start + (mkv_size / options.node_count) *
+			(options.node_min - 1);
+	}
+	gstart = mkv_start;
+	gend = mkv_end;
+
 	/* Some formats may optimize for a decreased max. length with this
 	   call to clear_keys() */
 	/* FIXME: If any future batch-mode runs some other mode after running
@@ -697,12 +732,12 @@ void do_markov_crack(struct db_main *db, char *mkv_param)
 	show_pwd(mkv_start);
 
 	if (!event_abort)
-		gidx = gend; // For reporting DONE properly
+		gidx = gend + 1; // For reporting DONE properly
 
 	crk_done();
 	rec_done(event_abort);
 
-	MEM_FREE(nbparts);
+	done_nbparts();
 	MEM_FREE(proba1);
 	MEM_FREE(proba2);
 	MEM_FREE(first);
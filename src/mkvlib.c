@@ -5,6 +5,12 @@
 
 #include <stdio.h>
 #include <string.h>
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#define MKV_MMAP
+#endif
 
 #include "arch.h"
 #include "misc.h"
@@ -220,3 +226,214 @@ void init_probatables(char * filename)
 }
 
 
+
+/*
+ * nbparts[] cache file header, followed by the table.  The file is only
+ * meant to be reused on the same kind of system, so it's in native byte
+ * order.  The key is a hash of proba1[] and proba2[], which are all that
+ * nbparts[] depends upon besides max_lvl and max_len.
+ */
+#define MKV_CACHE_MAGIC "MKC1"
+
+struct mkv_cache_header {
+	char magic[4];
+	unsigned int max_lvl, max_len, size;
+	unsigned long long key;
+};
+
+#ifdef MKV_MMAP
+static void *nbparts_map;
+static size_t nbparts_map_size;
+#endif
+
+static unsigned long long probatables_key(void)
+{
+	unsigned long long key = 0xcbf29ce484222325ULL;
+	unsigned int i;
+
+	for(i=0;i<256;i++)
+		key = (key ^ proba1[i]) * 0x100000001b3ULL;
+	for(i=0;i<256*256;i++)
+		key = (key ^ proba2[i]) * 0x100000001b3ULL;
+
+	return key;
+}
+
+/*
+ * Same as nb_parts(0, 0, 0, max_lvl, max_len) on a zeroed nbparts[], but
+ * done one length at a time from the longest, so that all the characters at
+ * a given length can be done in parallel.  This also fills in entries which
+ * can't be reached from the first character, but those are never looked at.
+ * Entries for character 0 are left at 0 like nb_parts() does, print_pwd()
+ * depends on that.
+ */
+static void fill_nbparts(unsigned int max_lvl, unsigned int max_len)
+{
+	int c;
+	unsigned int len, level;
+	unsigned long long out;
+
+	if(max_len == 0)
+	{
+		nbparts[0] = 1;
+		return;
+	}
+
+	for(c=1;c<256;c++)
+		for(level=0;level<=max_lvl;level++)
+			nbparts[c + max_len*256 + level*256*max_len] = 1;
+
+	for(len=max_len-1;len>=1;len--)
+	{
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) private(level, out)
+#endif
+		for(c=1;c<256;c++)
+		{
+			unsigned char * sorted = &charsorted[c*256];
+			unsigned char * proba = &proba2[c*256];
+			unsigned int k, next;
+
+			for(level=0;level<=max_lvl;level++)
+			{
+				out = 1;
+				/* charsorted[] has the most likely followers first */
+				for(k=0;k<256;k++)
+				{
+					if( (next = level + proba[sorted[k]]) > max_lvl )
+						break;
+					if(sorted[k])
+						out += nbparts[sorted[k] + (len+1)*256 + next*256*max_len];
+				}
+				nbparts[c + len*256 + level*256*max_len] = out;
+			}
+		}
+	}
+
+	out = 1;
+	for(c=1;c<256;c++)
+		if(proba1[c] <= max_lvl)
+			out += nbparts[c + 256 + proba1[c]*256*max_len];
+	nbparts[0] = out;
+}
+
+static int load_nbparts(char * cache, unsigned int max_lvl, unsigned int max_len, size_t size)
+{
+	FILE * fichier;
+	struct mkv_cache_header header;
+	long total;
+
+	if( !(fichier = fopen(cache, "rb")) )
+		return 0;
+
+	if( fread(&header, sizeof(header), 1, fichier) != 1 ||
+	    memcmp(header.magic, MKV_CACHE_MAGIC, sizeof(header.magic)) ||
+	    header.max_lvl != max_lvl || header.max_len != max_len ||
+	    header.size != sizeof(unsigned long long) ||
+	    header.key != probatables_key() ||
+	    fseek(fichier, 0, SEEK_END) || (total = ftell(fichier)) < 0 ||
+	    (size_t)total != sizeof(header) + size)
+	{
+		fclose(fichier);
+		return 0;
+	}
+
+#ifdef MKV_MMAP
+	nbparts_map_size = total;
+	nbparts_map = mmap(NULL, nbparts_map_size, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE, fileno(fichier), 0);
+	fclose(fichier);
+	if(nbparts_map == MAP_FAILED)
+	{
+		nbparts_map = NULL;
+		return 0;
+	}
+	nbparts = (unsigned long long *)((char *)nbparts_map + sizeof(header));
+#else
+	nbparts = mem_alloc(size);
+	if( fseek(fichier, sizeof(header), SEEK_SET) ||
+	    fread(nbparts, size, 1, fichier) != 1 )
+	{
+		fclose(fichier);
+		MEM_FREE(nbparts);
+		return 0;
+	}
+	fclose(fichier);
+#endif
+
+	return 1;
+}
+
+/*
+ * Writes to a temporary file first and renames it, so that several
+ * processes (such as MPI nodes) starting at once never see a partial file.
+ */
+static void save_nbparts(char * cache, unsigned int max_lvl, unsigned int max_len, size_t size)
+{
+	FILE * fichier;
+	struct mkv_cache_header header;
+	char * tmp;
+	int failed;
+
+	tmp = mem_alloc(strlen(cache) + 16);
+#ifdef MKV_MMAP
+	sprintf(tmp, "%s.%u", cache, (unsigned int)getpid());
+#else
+	strcpy(tmp, cache);
+#endif
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MKV_CACHE_MAGIC, sizeof(header.magic));
+	header.max_lvl = max_lvl;
+	header.max_len = max_len;
+	header.size = sizeof(unsigned long long);
+	header.key = probatables_key();
+
+	if( !(fichier = fopen(tmp, "wb")) )
+		failed = 1;
+	else
+	{
+		failed = fwrite(&header, sizeof(header), 1, fichier) != 1 ||
+		    fwrite(nbparts, size, 1, fichier) != 1;
+		if(fclose(fichier))
+			failed = 1;
+	}
+	if(!failed && strcmp(tmp, cache) && rename(tmp, cache))
+		failed = 1;
+	if(failed)
+	{
+		fprintf(stderr, "Could not write Markov cache file %s\n", cache);
+		remove(tmp);
+	}
+
+	MEM_FREE(tmp);
+}
+
+void init_nbparts(char * cache, unsigned int max_lvl, unsigned int max_len)
+{
+	size_t size = 256 * (size_t)(max_lvl+1) * (max_len+1) * sizeof(unsigned long long);
+
+	if(cache && load_nbparts(cache, max_lvl, max_len, size))
+		return;
+
+	nbparts = mem_alloc(size);
+	memset(nbparts, 0, size);
+	fill_nbparts(max_lvl, max_len);
+
+	if(cache)
+		save_nbparts(cache, max_lvl, max_len, size);
+}
+
+void done_nbparts(void)
+{
+#ifdef MKV_MMAP
+	if(nbparts_map)
+	{
+		munmap(nbparts_map, nbparts_map_size);
+		nbparts_map = NULL;
+		nbparts = NULL;
+		return;
+	}
+#endif
+	MEM_FREE(nbparts);
+}
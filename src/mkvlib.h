@@ -33,4 +33,12 @@ extern unsigned long long gend;
 void print_pwd(unsigned long long index, struct s_pwd * pwd, unsigned int max_lvl, unsigned int max_len);
 unsigned long long nb_parts(unsigned char lettre, unsigned int len, unsigned int level, unsigned int max_lvl, unsigned int max_len);
 void init_probatables(char * filename);
+/*
+ * Sets up nbparts[] for max_lvl and max_len, once init_probatables() has
+ * been called.  If cache isn't NULL, the table is read from (mapped) that
+ * file when it holds one for the same statistics, or written there for the
+ * next time otherwise.
+ */
+void init_nbparts(char * cache, unsigned int max_lvl, unsigned int max_len);
+void done_nbparts(void);
 #endif
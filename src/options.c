@@ -99,6 +99,10 @@ static struct opt_entry opt_list[] = {
 	{"test", FLG_TEST_SET, FLG_TEST_CHK,
 		0, ~FLG_TEST_SET & ~FLG_FORMAT & ~FLG_SAVEMEM & ~FLG_DYNFMT &
 		~OPT_REQ_PARAM & ~FLG_NOLOG, "%u", &benchmark_time},
+	{"bench-db", FLG_NONE, FLG_NONE, FLG_TEST_CHK, OPT_REQ_PARAM,
+		OPT_FMT_STR_ALLOC, &options.bench_db_str},
+	{"bench-output", FLG_NONE, FLG_NONE, FLG_TEST_CHK, OPT_REQ_PARAM,
+		OPT_FMT_STR_ALLOC, &options.bench_output},
 	{"users", FLG_NONE, 0, FLG_PASSWD, OPT_REQ_PARAM,
 		OPT_FMT_ADD_LIST_MULTI, &options.loader.users},
 	{"groups", FLG_NONE, 0, FLG_PASSWD, OPT_REQ_PARAM,
@@ -143,6 +147,8 @@ static struct opt_entry opt_list[] = {
 		"%u", &options.force_minlength},
 	{"max-length", FLG_NONE, FLG_NONE, 0, OPT_REQ_PARAM,
 		"%u", &options.force_maxlength},
+	{"node", FLG_NONE, FLG_NONE, FLG_CRACKING_CHK, OPT_REQ_PARAM,
+		OPT_FMT_STR_ALLOC, &options.node_str},
 	{"max-run-time", FLG_NONE, FLG_NONE, 0, OPT_REQ_PARAM,
 		"%u", &options.max_run_time},
 	{"progress-every", FLG_NONE, FLG_NONE, 0, OPT_REQ_PARAM,
@@ -305,6 +311,9 @@ void print_hidden_usage(void)
 	puts("--progress-every=N        emit a status line every N seconds");
 	puts("--crack-status            emit a status line whenever a password is cracked");
 	puts("--max-run-time=N          gracefully exit after this many seconds");
+	puts("--node=MIN[-MAX]/TOTAL    this node's number range out of TOTAL count");
+	puts("--bench-db=HASHES[/SALTS] --test against a synthetic database of this size");
+	puts("--bench-output=csv|json   --test results as CSV or JSON records");
 	puts("--regen-lost-salts=N      regenerate lost salts (see doc/OPTIONS)");
 #ifdef HAVE_DL
 	puts("--plugin=NAME[,..]        load this (these) dynamic plugin(s)");
@@ -422,6 +431,95 @@ void opt_init(char *name, int argc, char **argv, int show_usage)
 		}
 	}
 
+	if (options.node_str) {
+		if (sscanf(options.node_str, "%u-%u/%u", &options.node_min,
+		    &options.node_max, &options.node_count) != 3) {
+			if (sscanf(options.node_str, "%u/%u",
+			    &options.node_min, &options.node_count) != 2) {
+#ifdef HAVE_MPI
+				if (mpi_id == 0)
+#endif
+				fprintf(stderr, "Invalid --node syntax, "
+				    "should be MIN[-MAX]/TOTAL\n");
+				error();
+			}
+			options.node_max = options.node_min;
+		}
+		if (!options.node_min || options.node_min > options.node_max ||
+		    options.node_max > options.node_count) {
+#ifdef HAVE_MPI
+			if (mpi_id == 0)
+#endif
+			fprintf(stderr, "Invalid node numbers %s\n",
+			    options.node_str);
+			error();
+		}
+	}
+
+#ifdef HAVE_MPI
+	/* MPI is just another way of telling us our node numbers. Given a
+	   --node range, its MPI processes split that range among them. */
+	if (mpi_p > 1) {
+		if (options.node_count) {
+			if (options.node_max - options.node_min + 1 != mpi_p) {
+				if (mpi_id == 0)
+				fprintf(stderr, "Node range %u-%u does not "
+				    "match the %u MPI processes\n",
+				    options.node_min, options.node_max, mpi_p);
+				error();
+			}
+			options.node_min += mpi_id;
+		} else {
+			options.node_min = mpi_id + 1;
+			options.node_count = mpi_p;
+		}
+		options.node_max = options.node_min;
+	}
+#endif
+
+	/* A node range covering everything is no split at all */
+	if (options.node_min == 1 && options.node_max == options.node_count)
+		options.node_count = 0;
+
+	if (options.bench_db_str) {
+		switch (sscanf(options.bench_db_str, "%u/%u",
+		    &options.bench_hashes, &options.bench_salts)) {
+		case 1:
+			options.bench_salts = 1;
+			/* fall through */
+		case 2:
+			break;
+		default:
+			options.bench_hashes = 0;
+		}
+		if (!options.bench_hashes || !options.bench_salts ||
+		    options.bench_salts > options.bench_hashes) {
+#ifdef HAVE_MPI
+			if (mpi_id == 0)
+#endif
+			fprintf(stderr, "Invalid --bench-db %s, should be "
+			    "HASHES[/SALTS] with 1 <= SALTS <= HASHES\n",
+			    options.bench_db_str);
+			error();
+		}
+	}
+
+	if (options.bench_output) {
+		if (!strcasecmp(options.bench_output, "csv"))
+			strcpy(options.bench_output, "csv");
+		else
+		if (!strcasecmp(options.bench_output, "json"))
+			strcpy(options.bench_output, "json");
+		else {
+#ifdef HAVE_MPI
+			if (mpi_id == 0)
+#endif
+			fprintf(stderr, "Invalid --bench-output %s, should be "
+			    "csv or json\n", options.bench_output);
+			error();
+		}
+	}
+
 	if (options.length < 0)
 		options.length = PLAINTEXT_BUFFER_SIZE - 3;
 	else
@@ -228,6 +228,19 @@ struct options_main {
 /* Requested MaxLen (max plaintext_length) */
 	int force_maxlength;
 
+/* --node=MIN[-MAX]/TOTAL as given, and the parsed values. A node_count
+   of zero means this session is not split at all */
+	char *node_str;
+	unsigned int node_min, node_max, node_count;
+
+/* --bench-db=HASHES[/SALTS] as given, and the parsed values. Zero hashes
+   means the ordinary --test benchmark */
+	char *bench_db_str;
+	unsigned int bench_hashes, bench_salts;
+
+/* --bench-output=csv|json, or NULL for the human readable --test output */
+	char *bench_output;
+
 /* Graceful exit after this many seconds of cracking */
 	int max_run_time;
 
@@ -251,6 +264,18 @@ struct options_main {
 
 extern struct options_main options;
 
+/*
+ * Returns non-zero if work unit N (counted from 0) belongs to this node,
+ * when a session is split with --node (or over MPI).  Units are dealt out
+ * round-robin, so a node owning a range of node numbers gets consecutive
+ * units of every round.  N is evaluated at most once (unsigned wrap-around
+ * does the lower bound check).
+ */
+#define NODE_OWNS(n) \
+	(!options.node_count || \
+	(unsigned int)(n) % options.node_count + 1 - options.node_min <= \
+	options.node_max - options.node_min)
+
 /*
  * Initializes the options structure.
  */
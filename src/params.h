@@ -141,6 +141,8 @@
 #define CFG_PRIVATE_ALT_NAME		JOHN_PRIVATE_HOME "/john.ini"
 #define POT_NAME			JOHN_PRIVATE_HOME "/john.pot"
 #define LOG_NAME			JOHN_PRIVATE_HOME "/john.log"
+#define TUNE_NAME			JOHN_PRIVATE_HOME "/john.tun"
+#define STATS_NAME			JOHN_PRIVATE_HOME "/john.stats"
 #ifdef HAVE_MPI
 #define RECOVERY_NAME			JOHN_PRIVATE_HOME "/john"
 #else
@@ -149,6 +151,8 @@
 #else
 #define POT_NAME			"$JOHN/john.pot"
 #define LOG_NAME			"$JOHN/john.log"
+#define TUNE_NAME			"$JOHN/john.tun"
+#define STATS_NAME			"$JOHN/john.stats"
 #ifdef HAVE_MPI
 #define RECOVERY_NAME			"$JOHN/john"
 #else
@@ -157,6 +161,7 @@
 #endif
 #define LOG_SUFFIX			".log"
 #define RECOVERY_SUFFIX			".rec"
+#define STATS_SUFFIX			".stats"
 #define WORDLIST_NAME			"$JOHN/password.lst"
 
 /*
@@ -77,10 +77,11 @@ typedef struct zip_salt_t {
 	u32 deCompLen;				// length of decompressed data (if full).
 	u32 compType;				// the type of compression  0 or 8
 	u32 full_zip_idx;			// the index (0, 1, 2) which contains the 'full zip' data.
-	char *fname;				// if the zip is too large, we open the file in cmp_exact read the
-								// data a small buffer at a time.  If the zip blob is small enough
-								// (under 16k), then it simply read into H[x].h at init() time.
-								// and cmp_exact does not need fname to be used.
+	u32 memLen;					// how much of the full zip blob is held in H[full_zip_idx].h.  The
+								// whole blob, unless it is larger than PkzipBlobCache in john.conf
+	char *fname;				// if only a prefix of the zip blob is held in memory, cmp_exact opens
+								// this file to read the rest of the data, a small buffer at a time.
+								// NULL when the whole blob is in memory.
 	u32 offset;					// this is the offset to zip data (if we have to read from the file).
 } PKZ_SALT;
 
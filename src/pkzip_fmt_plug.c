@@ -20,6 +20,8 @@
 #include "arch.h"
 #include "misc.h"
 #include "formats.h"
+#include "params.h"
+#include "config.h"
 #define USE_PKZIP_MAGIC 1
 #include "pkzip.h"
 
@@ -30,9 +32,25 @@
 #include <omp.h>
 #endif
 
+/*
+ * With AVX2 or AVX-512, crypt_all() first runs the password key setup and
+ * the 12 byte encryption header check of the first hash for 8 or 16 passwords
+ * at a time, and only those which pass it go through the scalar checks.
+ */
+#if defined(JOHN_AVX512)
+#include <immintrin.h>
+#define PKZ_SIMD_LANES			16
+#define ALGORITHM_NAME			"512/512 AVX-512 16x"
+#elif defined(JOHN_AVX2)
+#include <immintrin.h>
+#define PKZ_SIMD_LANES			8
+#define ALGORITHM_NAME			"256/256 AVX2 8x"
+#else
+#define ALGORITHM_NAME			"32/" ARCH_BITS_STR
+#endif
+
 #define FORMAT_LABEL			"pkzip"
 #define FORMAT_NAME			"PKZIP"
-#define ALGORITHM_NAME			"32/" ARCH_BITS_STR
 
 #define BENCHMARK_COMMENT		""
 #define BENCHMARK_LENGTH		-1000
@@ -151,6 +169,138 @@ static u8 mult_tab[16384];
 inline u8 PKZ_MULT(u8 b, MY_WORD w) {u16 t = w.u|2; return b ^ (u8)(((u16)(t*(t^1))>>8)); }
 #endif
 
+#ifdef PKZ_SIMD_LANES
+/* 0 if the password surely fails the first hash's encryption header check */
+static u8 hdr_pass[MAX_KEYS_PER_CRYPT];
+
+#if PKZ_SIMD_LANES == 16
+typedef __m512i pkz_vec;
+#define pkz_set1(x)		_mm512_set1_epi32(x)
+#define pkz_load(p)		_mm512_loadu_si512((void*)(p))
+#define pkz_store(p, x)		_mm512_storeu_si512((void*)(p), x)
+#define pkz_add			_mm512_add_epi32
+#define pkz_mul			_mm512_mullo_epi32
+#define pkz_and			_mm512_and_si512
+#define pkz_or			_mm512_or_si512
+#define pkz_xor			_mm512_xor_si512
+#define pkz_srl			_mm512_srli_epi32
+#define pkz_gather(t, i)	_mm512_i32gather_epi32(i, (const void*)(t), 4)
+#define pkz_cmpgt(a, b)		_mm512_maskz_mov_epi32(_mm512_cmpgt_epi32_mask(a, b), _mm512_set1_epi32(-1))
+#define pkz_cmpeq(a, b)		_mm512_maskz_mov_epi32(_mm512_cmpeq_epi32_mask(a, b), _mm512_set1_epi32(-1))
+#else
+typedef __m256i pkz_vec;
+#define pkz_set1(x)		_mm256_set1_epi32(x)
+#define pkz_load(p)		_mm256_loadu_si256((const __m256i*)(p))
+#define pkz_store(p, x)		_mm256_storeu_si256((__m256i*)(p), x)
+#define pkz_add			_mm256_add_epi32
+#define pkz_mul			_mm256_mullo_epi32
+#define pkz_and			_mm256_and_si256
+#define pkz_or			_mm256_or_si256
+#define pkz_xor			_mm256_xor_si256
+#define pkz_srl			_mm256_srli_epi32
+#define pkz_gather(t, i)	_mm256_i32gather_epi32((const int*)(t), i, 4)
+#define pkz_cmpgt		_mm256_cmpgt_epi32
+#define pkz_cmpeq		_mm256_cmpeq_epi32
+#endif
+
+/* pkzip_crc32() on all lanes, the table lookups done by gathers */
+#define PKZ_CRC32(crc, byte) \
+	pkz_xor(pkz_gather(pkz_crc_32_tab, \
+		pkz_and(pkz_xor(crc, byte), pkz_set1(0xff))), pkz_srl(crc, 8))
+
+/* PKZ_MULT() without the table: t = key2|2, (t*(t^1))>>8, all 16 bit math */
+#define PKZ_VMULT(b, key2, t) \
+	(t = pkz_and(pkz_or(key2, pkz_set1(2)), pkz_set1(0xffff)), \
+	pkz_xor(b, pkz_and(pkz_srl(pkz_mul(t, pkz_xor(t, pkz_set1(1))), 8), \
+		pkz_set1(0xff))))
+
+#define PKZ_VUPDATE_KEYS(key0, key1, key2, C) \
+	key0 = PKZ_CRC32(key0, C); \
+	key1 = pkz_add(pkz_mul(pkz_add(key1, pkz_and(key0, pkz_set1(0xff))), \
+		pkz_set1(134775813)), pkz_set1(1)); \
+	key2 = PKZ_CRC32(key2, pkz_srl(key1, 24))
+
+/* Sets up the keys of PKZ_SIMD_LANES passwords from index base on (only if
+ * they are dirty), and checks them against the encryption header of the
+ * first hash of the salt.  The byte order is the little endian one, which
+ * is all AVX2 runs on. */
+static void crypt_hdr_simd(int base)
+{
+	u32 pw[PLAINTEXT_LENGTH][PKZ_SIMD_LANES];
+	u32 K[3][PKZ_SIMD_LANES];
+	pkz_vec key0, key1, key2, C, t, u;
+	const u8 *b = salt->H[0].h;
+	u16 e = salt->H[0].c;
+	int i, j, len, max_len = 1;
+
+	if (dirty) {
+		/* transpose the passwords, so that byte j of all of them is in pw[j] */
+		for (i = 0; i < PKZ_SIMD_LANES; ++i) {
+			const u8 *p = (u8*)saved_key[base + i];
+
+			/* an empty password is hashed as a single NUL, as in the scalar code */
+			len = 0;
+			do
+				pw[len][i] = p[len];
+			while (p[++len]);
+			K[0][i] = len;
+			if (len > max_len)
+				max_len = len;
+		}
+		key0 = pkz_set1(0x12345678UL);
+		key1 = pkz_set1(0x23456789UL);
+		key2 = pkz_set1(0x34567890UL);
+		for (j = 0; j < max_len; ++j) {
+			/* lanes past the end of their password keep their keys */
+			pkz_vec k0 = key0, k1 = key1, k2 = key2, active;
+
+			/* (bytes past the end of a password are garbage, but masked off) */
+			active = pkz_cmpgt(pkz_load(K[0]), pkz_set1(j));
+			C = pkz_load(pw[j]);
+			PKZ_VUPDATE_KEYS(k0, k1, k2, C);
+			key0 = pkz_xor(key0, pkz_and(pkz_xor(key0, k0), active));
+			key1 = pkz_xor(key1, pkz_and(pkz_xor(key1, k1), active));
+			key2 = pkz_xor(key2, pkz_and(pkz_xor(key2, k2), active));
+		}
+		pkz_store(K[0], key0);
+		pkz_store(K[1], key1);
+		pkz_store(K[2], key2);
+		for (i = 0; i < PKZ_SIMD_LANES; ++i) {
+			K12[(base + i) * 3] = K[0][i];
+			K12[(base + i) * 3 + 1] = K[1][i];
+			K12[(base + i) * 3 + 2] = K[2][i];
+		}
+	} else {
+		for (i = 0; i < PKZ_SIMD_LANES; ++i) {
+			K[0][i] = K12[(base + i) * 3];
+			K[1][i] = K12[(base + i) * 3 + 1];
+			K[2][i] = K12[(base + i) * 3 + 2];
+		}
+		key0 = pkz_load(K[0]);
+		key1 = pkz_load(K[1]);
+		key2 = pkz_load(K[2]);
+	}
+
+	/* decrypt the first 11 bytes of the IV, the 11th is the low checksum byte */
+	for (j = 0; ; ++j) {
+		C = PKZ_VMULT(pkz_set1(b[j]), key2, t);
+		if (j == 10)
+			break;
+		PKZ_VUPDATE_KEYS(key0, key1, key2, C);
+	}
+	if (salt->chk_bytes == 2)
+		t = pkz_cmpeq(C, pkz_set1(e & 0xff));
+	else
+		t = pkz_set1(-1);
+	PKZ_VUPDATE_KEYS(key0, key1, key2, C);
+	C = PKZ_VMULT(pkz_set1(b[11]), key2, u);
+	t = pkz_and(t, pkz_cmpeq(C, pkz_set1(e >> 8)));
+	pkz_store(K[0], t);
+	for (i = 0; i < PKZ_SIMD_LANES; ++i)
+		hdr_pass[base + i] = K[0][i] != 0;
+}
+#endif
+
 extern struct fmt_main fmt_pkzip;
 static const char *ValidateZipContents(FILE *in, long offset, u32 offex, int len, u32 crc);
 
@@ -484,6 +634,25 @@ static void set_salt(void *_salt) {
 	salt = *((PKZ_SALT**)_salt);
 }
 
+/* How many bytes of a zip blob which is read from the .zip file get held in
+ * memory.  Only a blob larger than this is read from the file again (past
+ * this prefix) by cmp_exact().  We always keep at least the first 384 bytes,
+ * which crypt_all() checks. */
+static u32 get_blob_cache(void)
+{
+	static u32 blob_cache;
+	int kb;
+
+	if (!blob_cache) {
+		if ((kb = cfg_get_int(SECTION_OPTIONS, NULL, "PkzipBlobCache")) < 0)
+			kb = 16*1024;
+		blob_cache = kb < 1024*1024 ? kb*1024 : 1024*1024*1024;
+		if (blob_cache < 384)
+			blob_cache = 384;
+	}
+	return blob_cache;
+}
+
 static void *get_salt(char *ciphertext)
 {
 	/* NOTE, almost NO error checking at all in this function.  Proper error checking done in valid() */
@@ -551,34 +720,26 @@ static void *get_salt(char *ciphertext)
 					return 0;
 				}
 				fseek(fp, offset+offex, SEEK_SET);
-				if (salt->compLen < 16*1024) {
-					/* simply load the whole blob */
-					salt->H[i].h = mem_alloc_tiny(salt->compLen, MEM_ALIGN_WORD);
-					if (fread(salt->H[i].h, 1, salt->compLen, fp) != salt->compLen) {
-						fprintf (stderr, "Error reading zip file for pkzip data:  %s\n", cp);
-						fclose(fp);
-						MEM_FREE(cpalloc);
-						return 0;
-					}
-					fclose(fp);
-					salt->H[i].datlen = salt->compLen;
-				}
-				else {
-					/* Only load a small part (to be used in crypt_all), and set the filename in */
-					/* the salt->fname string, so that cmp_all can open the file, and buffered   */
-					/* read the zip data only when it 'needs' it.                                */
+				/* Load as much of the blob as we are allowed to (all of it, unless it */
+				/* is huge), so that cmp_exact() can validate candidate passwords from */
+				/* memory.  If only a prefix fits, set the filename in salt->fname, so  */
+				/* cmp_exact() can buffered read the rest only when it 'needs' it.     */
+				salt->memLen = salt->compLen;
+				if (salt->memLen > get_blob_cache())
+					salt->memLen = get_blob_cache();
+				if (salt->memLen < salt->compLen) {
 					salt->fname = str_alloc_copy((c8*)cp);
 					salt->offset = offset+offex;
-					salt->H[i].h = mem_alloc_tiny(384, MEM_ALIGN_WORD);
-					if (fread(salt->H[i].h, 1, 384, fp) != 384) {
-						fprintf (stderr, "Error reading zip file for pkzip data:  %s\n", cp);
-						fclose(fp);
-						MEM_FREE(cpalloc);
-						return 0;
-					}
+				}
+				salt->H[i].h = mem_alloc_tiny(salt->memLen, MEM_ALIGN_WORD);
+				if (fread(salt->H[i].h, 1, salt->memLen, fp) != salt->memLen) {
+					fprintf (stderr, "Error reading zip file for pkzip data:  %s\n", cp);
 					fclose(fp);
-					salt->H[i].datlen = 384;
+					MEM_FREE(cpalloc);
+					return 0;
 				}
+				fclose(fp);
+				salt->H[i].datlen = salt->memLen;
 			} else {
 				/* 'inline' data. */
 				if (salt->compLen != salt->H[i].datlen) {
@@ -586,6 +747,7 @@ static void *get_salt(char *ciphertext)
 					return 0;
 				}
 				salt->H[i].h = mem_alloc_tiny(salt->compLen, MEM_ALIGN_WORD);
+				salt->memLen = salt->compLen;
 				for (j = 0; j < salt->H[i].datlen; ++j)
 					salt->H[i].h[j] = (atoi16[ARCH_INDEX(cp[j*2])]<<4) + atoi16[ARCH_INDEX(cp[j*2+1])];
 			}
@@ -662,14 +824,19 @@ static int cmp_all(void *binary, int count)
 	return j;
 }
 
-/* this function is used by cmp_exact_loadfile.  It will load the next
- * part of the file then decrypt the data, and return just how many
- * bytes were loaded.
+/* this function is used by cmp_exact.  It will get the next part of the
+ * zip blob, decrypt the data, and return just how many bytes were loaded.
+ * The bytes come from the copy of the blob held in the salt for as long as
+ * that lasts (the salt is only read, so this is safe for all threads). Only
+ * if the blob was too large to be held in memory, the rest is read from the
+ * .zip file, which is opened the first time it is needed. Returns -1 on a
+ * file error.
  *
  * This function is 'similar' to an fread().  However, it also decrypts data
  */
-static int get_next_decrypted_block(u8 *in, int sizeof_n, FILE *fp, u32 *inp_used, MY_WORD *pkey0, MY_WORD *pkey1, MY_WORD *pkey2) {
+static int get_next_decrypted_block(u8 *in, int sizeof_n, FILE **fp, u32 *inp_used, MY_WORD *pkey0, MY_WORD *pkey1, MY_WORD *pkey2) {
 	u32 new_bytes = sizeof_n, k;
+	const u8 *src;
 	u8 C;
 
 	/* we have read all the bytes, we're done */
@@ -678,70 +845,81 @@ static int get_next_decrypted_block(u8 *in, int sizeof_n, FILE *fp, u32 *inp_use
 	if (*inp_used + new_bytes > salt->compLen)
 		/* this is the last block.  Only load the bytes that are left */
 		new_bytes = salt->compLen - *inp_used;
-	/* return the correct 'offset', so we can track when the file buffer has been fully read */
+	if (*inp_used < salt->memLen) {
+		/* decrypt straight out of the in-memory copy of the blob */
+		if (*inp_used + new_bytes > salt->memLen)
+			new_bytes = salt->memLen - *inp_used;
+		src = &salt->H[salt->full_zip_idx].h[*inp_used];
+	} else {
+		/* Open the zip file, and 'seek' to where our in-memory copy ends */
+		if (!*fp) {
+			if (!(*fp = fopen(salt->fname, "rb"))) {
+				fprintf (stderr, "\nERROR, the zip file: %s has been removed.\nWe are a possible password has been found, but FULL validation can not be done!\n", salt->fname);
+				return -1;
+			}
+			if (fseek(*fp, salt->offset + *inp_used, SEEK_SET)) {
+				fprintf (stderr, "\nERROR, the zip file: %s fseek() failed.\nWe are a possible password has been found, but FULL validation can not be done!\n", salt->fname);
+				return -1;
+			}
+		}
+		if (fread(in, 1, new_bytes, *fp) != new_bytes) {
+			fprintf (stderr, "\nERROR, the zip file: %s fread() failed.\nWe are a possible password has been found, but FULL validation can not be done!\n", salt->fname);
+			return -1;
+		}
+		src = in;
+	}
+	/* return the correct 'offset', so we can track when the blob has been fully read */
 	*inp_used += new_bytes;
-	/* read the data */
-	if (fread(in, 1, new_bytes, fp) != new_bytes)
-		return 0;
 
-	/* decrypt the data bytes (in place, in same buffer). Easy to do, only requires 1 temp character variable.  */
+	/* decrypt the data bytes (in place, if read from the file). Easy to do, only requires 1 temp character variable.  */
 	for (k = 0; k < new_bytes; ++k) {
-		C = PKZ_MULT(in[k],(*pkey2));
+		C = PKZ_MULT(src[k],(*pkey2));
 		pkey0->u = pkzip_crc32 (pkey0->u, C);
 		pkey1->u = (pkey1->u + pkey0->c[KB1]) * 134775813 + 1;
 		pkey2->u = pkzip_crc32 (pkey2->u, pkey1->c[KB2]);
 		in[k] = C;
 	}
-	/* return the number of bytes we read from the file on this read */
+	/* return the number of bytes we decrypted on this call */
 	return new_bytes;
 }
 
-/* Ok, this is the more complex example.  Here we have to load the file (which may be HUGE)
- * decrypt the bytes from this file, and then inflate that data, and crc the bytes which we
- * have inflated from that stream. Then in the end, when we use all input bytes, if we have
- * inflated the right amount of data, ended up with a Z_STREAM_END, and the proper sized
- * decompression buffer, and the CRC matches, then we know we have the correct password
- *
- * This function is called from cmp_exact(), when cmp_exact finds out we have to decrypt from
- * the stored .zip file.
+/* Ok, this is the more complex example.  Here we have to decrypt the blob (which may be HUGE)
+ * a chunk at a time, and then inflate that data, and crc the bytes which we have inflated
+ * from that stream. Then in the end, when we use all input bytes, if we have inflated the
+ * right amount of data, ended up with a Z_STREAM_END, and the proper sized decompression
+ * buffer, and the CRC matches, then we know we have the correct password.  A wrong password
+ * almost always gets a Z_DATA_ERROR within the first chunk, so we stop right there, without
+ * ever touching the .zip file, nor allocating buffers the size of the whole blob.
  *
  * this code is modifications made to the zpipe.c 'example' code from the zlib web site.
  */
 #define CHUNK (64*1024)
-static int cmp_exact_loadfile(int index) {
-
-    int ret;
+static int cmp_exact(char *source, int index)
+{
+    int ret, avail_in;
     u32 have, k;
     z_stream strm;
     unsigned char in[CHUNK];
     unsigned char out[CHUNK];
-	FILE *fp;
+	FILE *fp = NULL;
 	MY_WORD key0, key1, key2;
 	u8 *b, C;
 	u32 inp_used, decomp_len=0;
 	u32 crc = 0xFFFFFFFF;
 
-	/* Open the zip file, and 'seek' to the proper offset of the binary zip blob */
-	fp = fopen(salt->fname, "rb");
-	if (!fp) {
-		fprintf (stderr, "\nERROR, the zip file: %s has been removed.\nWe are a possible password has been found, but FULL validation can not be done!\n", salt->fname);
-		return 1;
-	}
-	if (fseek(fp, salt->offset, SEEK_SET)) {
-		fprintf (stderr, "\nERROR, the zip file: %s fseek() failed.\nWe are a possible password has been found, but FULL validation can not be done!\n", salt->fname);
-		fclose(fp);
+	if (salt->H[salt->full_zip_idx].full_zip == 0)
+		/* we do not have a zip file, this is 'checksum' only
+		 * POSSIBLY, we should log and output to screen that
+		 * we are not 100% 'sure' we have the right password!! */
 		return 1;
-	}
+
+#ifdef ZIP_DEBUG
+	fprintf(stderr, "FULL zip test being done. (pass=%s)\n", saved_key[index]);
+#endif
 
 	/* 'seed' the decryption with the IV. We do NOT use these bytes, they simply seed us. */
 	key0.u = K12[index*3], key1.u = K12[index*3+1], key2.u = K12[index*3+2];
 	k=12;
-	if (fread(in, 1, 12, fp) != 12) {
-		fprintf (stderr, "\nERROR, the zip file: %s fread() failed.\nWe are a possible password has been found, but FULL validation can not be done!\n", salt->fname);
-		fclose(fp);
-		return 1;
-	}
-
 	b = salt->H[salt->full_zip_idx].h;
 	do {
 		C = PKZ_MULT(*b++,key2);
@@ -751,23 +929,21 @@ static int cmp_exact_loadfile(int index) {
 	}
 	while(--k);
 
-	/* this is 'sort of' our file pointer.  It is the 'index' into the file's encrypted, compressed data buffer. */
-	/* we have read the 12 bytes of IV data, and updated our keys. Now we start processing the rest of the bytes */
-	/* to get the data to inflate, and crc check                                                                 */
+	/* this is 'sort of' our file pointer.  It is the 'index' into the encrypted, compressed data buffer. */
+	/* we have used the 12 bytes of IV data, and updated our keys. Now we start processing the rest of    */
+	/* the bytes to get the data to inflate, and crc check                                                */
 	inp_used = 12;
 
 	if (salt->H[salt->full_zip_idx].compType == 0) {
 		// handle a stored blob (we do not have to decrypt it.
-		int avail_in;
 		crc = 0xFFFFFFFF;
-        avail_in = get_next_decrypted_block(in, CHUNK, fp, &inp_used, &key0, &key1, &key2);
-		while (avail_in) {
-			for (k = 0; k < avail_in; ++k)
+		while ((avail_in = get_next_decrypted_block(in, CHUNK, &fp, &inp_used, &key0, &key1, &key2)) > 0) {
+			for (k = 0; k < (u32)avail_in; ++k)
 				crc = pkzip_crc32(crc,in[k]);
-			avail_in = get_next_decrypted_block(in, CHUNK, fp, &inp_used, &key0, &key1, &key2);
 		}
-		fclose(fp);
-		return ~crc == salt->crc32;
+		if (fp)
+			fclose(fp);
+		return avail_in < 0 || ~crc == salt->crc32;
 	}
 
     /* allocate inflate state */
@@ -776,21 +952,22 @@ static int cmp_exact_loadfile(int index) {
     strm.opaque = Z_NULL;
     strm.avail_in = 0;
     strm.next_in = Z_NULL;
-    ret = inflateInit2(&strm, -15);
+    ret = inflateInit2(&strm, -15); /* 'raw', since we do not have gzip header, or gzip crc. .ZIP files are 'raw' implode data. */
 	if (ret != Z_OK) /* if zlib is hosed, then likely there is no reason at all to continue.  Better to exit, and let the user 'fix' the system */
 		perror("Error, initializing the libz inflateInit2() system\n");
 
-    /* decompress until deflate stream ends or end of file */
+    /* decompress until deflate stream ends or end of data */
     do {
-        strm.avail_in = get_next_decrypted_block(in, CHUNK, fp, &inp_used, &key0, &key1, &key2);
-        if (ferror(fp)) {
+        avail_in = get_next_decrypted_block(in, CHUNK, &fp, &inp_used, &key0, &key1, &key2);
+        if (avail_in < 0) {
             inflateEnd(&strm);
-			fclose(fp);
-			fprintf (stderr, "\nERROR, the zip file: %s fread() failed.\nWe are a possible password has been found, but FULL validation can not be done!\n", salt->fname);
+			if (fp)
+				fclose(fp);
             return 1;
         }
-        if (strm.avail_in == 0)
+        if (avail_in == 0)
             break;
+        strm.avail_in = avail_in;
         strm.next_in = in;
 
         /* run inflate() on input until output buffer not full */
@@ -803,7 +980,8 @@ static int cmp_exact_loadfile(int index) {
 			    case Z_DATA_ERROR:
 				case Z_MEM_ERROR:
 					inflateEnd(&strm);
-					fclose(fp);
+					if (fp)
+						fclose(fp);
 					return 0;
             }
             have = CHUNK - strm.avail_out;
@@ -811,6 +989,13 @@ static int cmp_exact_loadfile(int index) {
 			for (k = 0; k < have; ++k)
 				crc = pkzip_crc32(crc,out[k]);
 			decomp_len += have;
+			/* inflating past the stored length can only be a wrong password */
+			if (decomp_len > salt->deCompLen) {
+				inflateEnd(&strm);
+				if (fp)
+					fclose(fp);
+				return 0;
+			}
         } while (strm.avail_out == 0);
 
         /* done when inflate() says it's done */
@@ -818,100 +1003,11 @@ static int cmp_exact_loadfile(int index) {
 
     /* clean up and return */
     inflateEnd(&strm);
-	fclose(fp);
+	if (fp)
+		fclose(fp);
 	return ret == Z_STREAM_END && inp_used == salt->compLen && decomp_len == salt->deCompLen && salt->crc32 == ~crc;
 }
 
-
-static int cmp_exact(char *source, int index)
-{
-	const u8 *b;
-	u8 C, *decompBuf, *decrBuf, *B;
-	u32 k, crc;
-	MY_WORD key0, key1, key2;
-	z_stream strm;
-	int ret;
-
-	if (salt->H[salt->full_zip_idx].full_zip == 0)
-		/* we do not have a zip file, this is 'checksum' only
-		 * POSSIBLY, we should log and output to screen that
-		 * we are not 100% 'sure' we have the right password!! */
-		return 1;
-
-#ifdef ZIP_DEBUG
-	fprintf(stderr, "FULL zip test being done. (pass=%s)\n", saved_key[index]);
-#endif
-
-	if (salt->fname == NULL) {
-		/* we have the whole zip blob in memory, simply allocate a decrypt buffer, decrypt
-		 * in one step, crc and be done with it. This is the 'trivial' type. */
-
-		decrBuf = mem_alloc(salt->compLen-12);
-
-		key0.u = K12[index*3], key1.u = K12[index*3+1], key2.u = K12[index*3+2];
-
-		b = salt->H[salt->full_zip_idx].h;
-		k=12;
-		do {
-			C = PKZ_MULT(*b++,key2);
-			key0.u = pkzip_crc32 (key0.u, C);
-			key1.u = (key1.u + key0.c[KB1]) * 134775813 + 1;
-			key2.u = pkzip_crc32 (key2.u, key1.c[KB2]);
-		}
-		while(--k);
-		B = decrBuf;
-		k = salt->compLen-12;
-		do {
-			C = PKZ_MULT(*b++,key2);
-			key0.u = pkzip_crc32 (key0.u, C);
-			*B++ = C;
-			key1.u = (key1.u + key0.c[KB1]) * 134775813 + 1;
-			key2.u = pkzip_crc32 (key2.u, key1.c[KB2]);
-		} while (--k);
-
-		if (salt->H[salt->full_zip_idx].compType == 0) {
-			// handle a stored blob (we do not have to decrypt it.
-			crc = 0xFFFFFFFF;
-			for (k = 0; k < salt->compLen-12; ++k)
-				crc = pkzip_crc32(crc,decrBuf[k]);
-			MEM_FREE(decrBuf);
-			return ~crc == salt->crc32;
-		}
-
-		strm.zalloc = Z_NULL; strm.zfree = Z_NULL; strm.opaque = Z_NULL; strm.next_in = Z_NULL; strm.avail_in = 0;
-
-		ret = inflateInit2(&strm, -15); /* 'raw', since we do not have gzip header, or gzip crc. .ZIP files are 'raw' implode data. */
-		if (ret != Z_OK)
-		   perror("Error, initializing the libz inflateInit2() system\n");
-
-		decompBuf = mem_alloc(salt->deCompLen);
-
-		strm.next_in = decrBuf;
-		strm.avail_in = salt->compLen-12;
-		strm.avail_out = salt->deCompLen;
-		strm.next_out = decompBuf;
-
-		ret = inflate(&strm, Z_SYNC_FLUSH);
-		inflateEnd(&strm);
-		if (ret != Z_STREAM_END || strm.total_out != salt->deCompLen) {
-			MEM_FREE(decompBuf);
-			MEM_FREE(decrBuf);
-			return 0;
-		}
-
-		crc = 0xFFFFFFFF;
-		for (k = 0; k < strm.total_out; ++k)
-			crc = pkzip_crc32(crc,decompBuf[k]);
-		MEM_FREE(decompBuf);
-		MEM_FREE(decrBuf);
-		return ~crc == salt->crc32;
-	}
-	/* we have a stand alone function to handle this more complex method of
-	 * loading from file, decrypting, decompressing, and crc'ing the data
-	 * It is complex enough of a task, to have it's own function. */
-	return cmp_exact_loadfile(index);
-}
-
 #if USE_PKZIP_MAGIC
 const char exBytesUTF8[64] = {
 	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
@@ -1302,6 +1398,19 @@ static void crypt_all(int _count)
 	// Also, since we have 'multiple' files in a .zip file (and multiple checksums), we bail as at the
 	// first time we fail to match checksum.  So, there may be some threads which check more checksums.
 	// Again, hopefully globbing many tests into a threads working set will flatten out these differences.
+#ifdef PKZ_SIMD_LANES
+	{
+		int simd_count = _count / PKZ_SIMD_LANES * PKZ_SIMD_LANES;
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (idx = 0; idx < simd_count; idx += PKZ_SIMD_LANES)
+			crypt_hdr_simd(idx);
+		for (idx = simd_count; idx < _count; ++idx)
+			hdr_pass[idx] = 1;
+	}
+#endif
 #ifdef _OPENMP
 #pragma omp parallel for private(idx)
 #endif
@@ -1320,6 +1429,12 @@ static void crypt_all(int _count)
 		z_stream strm;
 		int ret;
 
+#ifdef PKZ_SIMD_LANES
+		/* the vector code has already set up the keys, and checked the first header */
+		if (!hdr_pass[idx])
+			goto Failed_Bailout;
+#endif
+
 		/* use the pwkey for each hash.  We mangle on the 12 bytes of IV to what  was computed in the pwkey load. */
 
 		if (dirty) {
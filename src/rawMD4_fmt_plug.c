@@ -13,6 +13,8 @@
 
 #ifdef MD4_SSE_PARA
 #define NBKEYS				(MMX_COEF * MD4_SSE_PARA)
+/* binary() undoes the final steps, which the SSE body then skips */
+#define REVERSE_STEPS
 #elif MMX_COEF
 #define NBKEYS				MMX_COEF
 #endif
@@ -119,14 +121,11 @@ static char *split(char *ciphertext, int index)
 	return out;
 }
 
-static void *binary(char *ciphertext)
+static void get_digest(char *ciphertext, unsigned char *out)
 {
-	static unsigned char *out;
 	char *p;
 	int i;
 
-	if (!out) out = mem_alloc_tiny(DIGEST_SIZE, MEM_ALIGN_WORD);
-
 	p = ciphertext + TAG_LENGTH;
 	for (i = 0; i < DIGEST_SIZE; i++) {
 		out[i] =
@@ -134,6 +133,32 @@ static void *binary(char *ciphertext)
 		    atoi16[ARCH_INDEX(p[1])];
 		p += 2;
 	}
+}
+
+static void *binary(char *ciphertext)
+{
+	static unsigned char *out;
+
+	if (!out) out = mem_alloc_tiny(DIGEST_SIZE, MEM_ALIGN_WORD);
+
+	get_digest(ciphertext, out);
+#ifdef REVERSE_STEPS
+	{
+		ARCH_WORD_32 *w = (ARCH_WORD_32*)out;
+		ARCH_WORD_32 a, b, c, d;
+
+		/* Undo steps 48 (word 15 is zero) and 47, but for adding its
+		   message word (7) */
+		a = w[0] - 0x67452301;
+		b = w[1] - 0xefcdab89;
+		c = w[2] - 0x98badcfe;
+		d = w[3] - 0x10325476;
+		b = (b >> 15) | (b << 17);
+		b -= (c ^ d ^ a) + 0x6ed9eba1;
+		c = (c >> 11) | (c << 21);
+		w[0] = c - (d ^ a ^ b) - 0x6ed9eba1;
+	}
+#endif
 
 	return out;
 }
@@ -244,7 +269,7 @@ static char *get_key(int index)
 static void crypt_all(int count)
 {
 #ifdef MD4_SSE_PARA
-	SSEmd4body(saved_key, (unsigned int*)crypt_key, 1);
+	SSEmd4body(saved_key, (unsigned int*)crypt_key, SSEi_REVERSE_STEPS);
 #elif MMX_COEF
 	mdfourmmx(crypt_key, saved_key, total_len);
 #else
@@ -293,7 +318,18 @@ static int cmp_one(void *binary, int index)
 
 static int cmp_exact(char *source, int index)
 {
-#if BINARY_SIZE == DIGEST_SIZE
+#ifdef REVERSE_STEPS
+	/* Only the first (reversed) word was computed, so hash the key again */
+	ARCH_WORD_32 digest[DIGEST_SIZE / 4], full[DIGEST_SIZE / 4];
+	MD4_CTX ctx;
+	char *key = get_key(index);
+
+	MD4_Init(&ctx);
+	MD4_Update(&ctx, key, strlen(key));
+	MD4_Final((unsigned char*)full, &ctx);
+	get_digest(source, (unsigned char*)digest);
+	return !memcmp(full, digest, DIGEST_SIZE);
+#elif BINARY_SIZE == DIGEST_SIZE
 	return 1;
 #else
 #ifdef MMX_COEF
@@ -20,7 +20,10 @@
 #ifdef MD5_SSE_PARA
 #  define MMX_COEF			4
 #  define NBKEYS			(MMX_COEF * MD5_SSE_PARA)
-#  define DO_MMX_MD5(in, out)		SSEmd5body(in, (unsigned int*)out, 1)
+#  define DO_MMX_MD5(in, out) \
+	SSEmd5body(in, (unsigned int*)out, SSEi_REVERSE_STEPS)
+/* binary() undoes the final steps, which the SSE body then skips */
+#  define REVERSE_STEPS
 #elif defined(MMX_COEF)
 #  define NBKEYS			MMX_COEF
 #  define DO_MMX_MD5(in, out)		mdfivemmx_nosizeupdate(out, in, 1)
@@ -106,14 +109,11 @@ static char *split(char *ciphertext, int index)
 	return out;
 }
 
-static void *binary(char *ciphertext)
+static void get_digest(char *ciphertext, unsigned char *out)
 {
-	static unsigned char *out;
 	char *p;
 	int i;
 
-	if (!out) out = mem_alloc_tiny(DIGEST_SIZE, MEM_ALIGN_WORD);
-
 	p = ciphertext + TAG_LENGTH;
 	for (i = 0; i < DIGEST_SIZE; i++) {
 		out[i] =
@@ -121,6 +121,30 @@ static void *binary(char *ciphertext)
 		    atoi16[ARCH_INDEX(p[1])];
 		p += 2;
 	}
+}
+
+static void *binary(char *ciphertext)
+{
+	static unsigned char *out;
+
+	if (!out) out = mem_alloc_tiny(DIGEST_SIZE, MEM_ALIGN_WORD);
+
+	get_digest(ciphertext, out);
+#ifdef REVERSE_STEPS
+	{
+		ARCH_WORD_32 *w = (ARCH_WORD_32*)out;
+		ARCH_WORD_32 a, b, c, d;
+
+		/* Undo step 64, but for adding its message word (9) */
+		a = w[0] - 0x67452301;
+		b = w[1] - 0xefcdab89;
+		c = w[2] - 0x98badcfe;
+		d = w[3] - 0x10325476;
+		b -= c;
+		b = (b >> 21) | (b << 11);
+		w[0] = b - (d ^ (c | ~a)) - 0xeb86d391;
+	}
+#endif
 
 	return out;
 }
@@ -275,7 +299,18 @@ static int cmp_one(void *binary, int index)
 
 static int cmp_exact(char *source, int index)
 {
-#if BINARY_SIZE == DIGEST_SIZE
+#ifdef REVERSE_STEPS
+	/* Only the first (reversed) word was computed, so hash the key again */
+	ARCH_WORD_32 digest[DIGEST_SIZE / 4], full[DIGEST_SIZE / 4];
+	MD5_CTX ctx;
+	char *key = get_key(index);
+
+	MD5_Init(&ctx);
+	MD5_Update(&ctx, key, strlen(key));
+	MD5_Final((unsigned char*)full, &ctx);
+	get_digest(source, (unsigned char*)digest);
+	return !memcmp(full, digest, DIGEST_SIZE);
+#elif BINARY_SIZE == DIGEST_SIZE
 	return 1;
 #else
 #ifdef MMX_COEF
@@ -146,11 +146,12 @@
 # pragma GCC optimize "-fprefetch-loop-arrays"
 #endif
 
-// M and N contain the first and last 128bits of a 512bit SHA-1 message block
-// respectively. The remaining 256bits are always zero, and so are not stored
-// here to avoid the load overhead.
+// M contains the first 128bits of a 512bit SHA-1 message block, and N the
+// last word (the message length in bits). The remaining words are always
+// zero, and so are not stored here to avoid the load overhead. N is already
+// laid out the way crypt_all() wants it, four keys to a vector.
 static uint32_t __aligned_16 M[SHA1_PARALLEL_HASH][4];
-static uint32_t __aligned_16 N[SHA1_PARALLEL_HASH][4];
+static uint32_t __aligned_16 N[SHA1_PARALLEL_HASH];
 
 // MD contains the state of the SHA-1 A register at R75 for each of the input
 // messages.
@@ -378,7 +379,7 @@ static void sha1_fmt_set_key(char *key, int index)
     // message block (or only message block, in this case). The << 3 is to find
     // the length in bits (multiply by 8).
     _mm_store_si128(&M[index], X);
-    _mm_store_si128(&N[index], _mm_set_epi32(len << 3, 0, 0, 0));
+    N[index] = len << 3;
 
     return;
 }
@@ -400,136 +401,159 @@ static char * sha1_fmt_get_key(int index)
     return (char *) key;
 }
 
-static void sha1_fmt_crypt_all(int count)
+// Hash the four keys starting at index i, whose lengths in bits are in L.
+// Only the first 'words' message words can be non-zero for any of them; the
+// callers pass a constant so that GCC folds the zero words out of the
+// rounds and the message schedule, giving one kernel per length bucket.
+static inline void __attribute__((always_inline)) sha1_fmt_crypt_block(int32_t i, __m128i L, const int32_t words)
 {
     __m128i W[SHA1_BLOCK_WORDS];
     __m128i A, B, C, D, E;
     __m128i K;
+
+    // Fetch the message, then use a 4x4 matrix transpose to shuffle them
+    // into place.
+    W[0]  = _mm_load_si128(&M[i + 0]);
+    W[1]  = _mm_load_si128(&M[i + 1]);
+    W[2]  = _mm_load_si128(&M[i + 2]);
+    W[3]  = _mm_load_si128(&M[i + 3]);
+
+    _MM_TRANSPOSE4_EPI32(W[0],  W[1],  W[2],  W[3]);
+
+    if (words < 4) W[3] = _mm_setzero_si128();
+    if (words < 3) W[2] = _mm_setzero_si128();
+    if (words < 2) W[1] = _mm_setzero_si128();
+
+    A = _mm_set1_epi32(0x67452301);
+    B = _mm_set1_epi32(0xEFCDAB89);
+    C = _mm_set1_epi32(0x98BADCFE);
+    D = _mm_set1_epi32(0x10325476);
+    E = _mm_set1_epi32(0xC3D2E1F0);
+    K = _mm_set1_epi32(0x5A827999);
+
+    R1(W[0],  A, B, C, D, E);
+    R1(W[1],  E, A, B, C, D);
+    R1(W[2],  D, E, A, B, C);
+    R1(W[3],  C, D, E, A, B); W[4]  = _mm_setzero_si128();
+    R1(W[4],  B, C, D, E, A); W[5]  = _mm_setzero_si128();
+    R1(W[5],  A, B, C, D, E); W[6]  = _mm_setzero_si128();      // 5
+    R1(W[6],  E, A, B, C, D); W[7]  = _mm_setzero_si128();
+    R1(W[7],  D, E, A, B, C); W[8]  = _mm_setzero_si128();
+    R1(W[8],  C, D, E, A, B); W[9]  = _mm_setzero_si128();
+    R1(W[9],  B, C, D, E, A); W[10] = _mm_setzero_si128();
+    R1(W[10], A, B, C, D, E); W[11] = _mm_setzero_si128();      // 10
+
+    // Only the message lengths are left, the words before them are zero.
+    W[12] = _mm_setzero_si128();
+    W[13] = _mm_setzero_si128();
+    W[14] = _mm_setzero_si128();
+    W[15] = L;
+
+    R1(W[11], E, A, B, C, D);
+    R1(W[12], D, E, A, B, C);
+    R1(W[13], C, D, E, A, B);
+    R1(W[14], B, C, D, E, A);
+    R1(W[15], A, B, C, D, E);                                   // 15
+
+    X(W[0],  W[2],  W[8],  W[13]);  R1(W[0],  E, A, B, C, D);
+    X(W[1],  W[3],  W[9],  W[14]);  R1(W[1],  D, E, A, B, C);
+    X(W[2],  W[4],  W[10], W[15]);  R1(W[2],  C, D, E, A, B);
+    X(W[3],  W[5],  W[11], W[0]);   R1(W[3],  B, C, D, E, A);
+
+    K = _mm_set1_epi32(0x6ED9EBA1);
+
+    X(W[4],  W[6],  W[12], W[1]);   R2(W[4],  A, B, C, D, E);   // 20
+    X(W[5],  W[7],  W[13], W[2]);   R2(W[5],  E, A, B, C, D);
+    X(W[6],  W[8],  W[14], W[3]);   R2(W[6],  D, E, A, B, C);
+    X(W[7],  W[9],  W[15], W[4]);   R2(W[7],  C, D, E, A, B);
+    X(W[8],  W[10], W[0],  W[5]);   R2(W[8],  B, C, D, E, A);
+    X(W[9],  W[11], W[1],  W[6]);   R2(W[9],  A, B, C, D, E);   // 25
+    X(W[10], W[12], W[2],  W[7]);   R2(W[10], E, A, B, C, D);
+    X(W[11], W[13], W[3],  W[8]);   R2(W[11], D, E, A, B, C);
+    X(W[12], W[14], W[4],  W[9]);   R2(W[12], C, D, E, A, B);
+    X(W[13], W[15], W[5],  W[10]);  R2(W[13], B, C, D, E, A);
+    X(W[14], W[0],  W[6],  W[11]);  R2(W[14], A, B, C, D, E);   // 30
+    X(W[15], W[1],  W[7],  W[12]);  R2(W[15], E, A, B, C, D);
+    X(W[0],  W[2],  W[8],  W[13]);  R2(W[0],  D, E, A, B, C);
+    X(W[1],  W[3],  W[9],  W[14]);  R2(W[1],  C, D, E, A, B);
+    X(W[2],  W[4],  W[10], W[15]);  R2(W[2],  B, C, D, E, A);
+    X(W[3],  W[5],  W[11], W[0]);   R2(W[3],  A, B, C, D, E);   // 35
+    X(W[4],  W[6],  W[12], W[1]);   R2(W[4],  E, A, B, C, D);
+    X(W[5],  W[7],  W[13], W[2]);   R2(W[5],  D, E, A, B, C);
+    X(W[6],  W[8],  W[14], W[3]);   R2(W[6],  C, D, E, A, B);
+    X(W[7],  W[9],  W[15], W[4]);   R2(W[7],  B, C, D, E, A);
+
+    K = _mm_set1_epi32(0x8F1BBCDC);
+
+    X(W[8],  W[10], W[0],  W[5]);   R3(W[8],  A, B, C, D, E);   // 40
+    X(W[9],  W[11], W[1],  W[6]);   R3(W[9],  E, A, B, C, D);
+    X(W[10], W[12], W[2],  W[7]);   R3(W[10], D, E, A, B, C);
+    X(W[11], W[13], W[3],  W[8]);   R3(W[11], C, D, E, A, B);
+    X(W[12], W[14], W[4],  W[9]);   R3(W[12], B, C, D, E, A);
+    X(W[13], W[15], W[5],  W[10]);  R3(W[13], A, B, C, D, E);   // 45
+    X(W[14], W[0],  W[6],  W[11]);  R3(W[14], E, A, B, C, D);
+    X(W[15], W[1],  W[7],  W[12]);  R3(W[15], D, E, A, B, C);
+    X(W[0],  W[2],  W[8],  W[13]);  R3(W[0],  C, D, E, A, B);
+    X(W[1],  W[3],  W[9],  W[14]);  R3(W[1],  B, C, D, E, A);
+    X(W[2],  W[4],  W[10], W[15]);  R3(W[2],  A, B, C, D, E);   // 50
+    X(W[3],  W[5],  W[11], W[0]);   R3(W[3],  E, A, B, C, D);
+    X(W[4],  W[6],  W[12], W[1]);   R3(W[4],  D, E, A, B, C);
+    X(W[5],  W[7],  W[13], W[2]);   R3(W[5],  C, D, E, A, B);
+    X(W[6],  W[8],  W[14], W[3]);   R3(W[6],  B, C, D, E, A);
+    X(W[7],  W[9],  W[15], W[4]);   R3(W[7],  A, B, C, D, E);   // 55
+    X(W[8],  W[10], W[0],  W[5]);   R3(W[8],  E, A, B, C, D);
+    X(W[9],  W[11], W[1],  W[6]);   R3(W[9],  D, E, A, B, C);
+    X(W[10], W[12], W[2],  W[7]);   R3(W[10], C, D, E, A, B);
+    X(W[11], W[13], W[3],  W[8]);   R3(W[11], B, C, D, E, A);
+
+    K = _mm_set1_epi32(0xCA62C1D6);
+
+    X(W[12], W[14], W[4],  W[9]);   R2(W[12], A, B, C, D, E);   // 60
+    X(W[13], W[15], W[5],  W[10]);  R2(W[13], E, A, B, C, D);
+    X(W[14], W[0],  W[6],  W[11]);  R2(W[14], D, E, A, B, C);
+    X(W[15], W[1],  W[7],  W[12]);  R2(W[15], C, D, E, A, B);
+    X(W[0],  W[2],  W[8],  W[13]);  R2(W[0],  B, C, D, E, A);
+    X(W[1],  W[3],  W[9],  W[14]);  R2(W[1],  A, B, C, D, E);   // 65
+    X(W[2],  W[4],  W[10], W[15]);  R2(W[2],  E, A, B, C, D);
+    X(W[3],  W[5],  W[11], W[0]);   R2(W[3],  D, E, A, B, C);
+    X(W[4],  W[6],  W[12], W[1]);   R2(W[4],  C, D, E, A, B);
+    X(W[5],  W[7],  W[13], W[2]);   R2(W[5],  B, C, D, E, A);
+    X(W[6],  W[8],  W[14], W[3]);   R2(W[6],  A, B, C, D, E);   // 70
+    X(W[7],  W[9],  W[15], W[4]);   R2(W[7],  E, A, B, C, D);
+    X(W[8],  W[10], W[0],  W[5]);   R2(W[8],  D, E, A, B, C);
+    X(W[9],  W[11], W[1],  W[6]);   R2(W[9],  C, D, E, A, B);
+    X(W[10], W[12], W[2],  W[7]);   R2(W[10], B, C, D, E, A);
+    X(W[11], W[13], W[3],  W[8]);   R4(W[11], A, B, C, D, E);   // 75
+
+    // A75 has an interesting property, it is the first word that is (almost)
+    // part of the final MD (E79 ror 2). The common case will be that this
+    // doesn't match, so we stop here and save 5 rounds.
+    //
+    // Note that I'm using E due to the displacement caused by vectorization,
+    // this is A in standard SHA-1.
+    _mm_store_si128(&MD[i], E);
+}
+
+static void sha1_fmt_crypt_all(int count)
+{
+    __m128i L;
     int32_t i;
 
     // To reduce the overhead of multiple function calls, we buffer lots of
-    // passwords, and then hash them in multiples of 4 all at once.
+    // passwords, and then hash them in multiples of 4 all at once. Each
+    // group goes to the kernel for the longest of its keys, a key of up to
+    // 4n-1 bytes (plus the trailing bit) fitting in n words.
     for (i = 0; i < count; i += 4) {
-        // Fetch the message, then use a 4x4 matrix transpose to shuffle them
-        // into place.
-        W[0]  = _mm_load_si128(&M[i + 0]);
-        W[1]  = _mm_load_si128(&M[i + 1]);
-        W[2]  = _mm_load_si128(&M[i + 2]);
-        W[3]  = _mm_load_si128(&M[i + 3]);
-
-        _MM_TRANSPOSE4_EPI32(W[0],  W[1],  W[2],  W[3]);
-
-        A = _mm_set1_epi32(0x67452301);
-        B = _mm_set1_epi32(0xEFCDAB89);
-        C = _mm_set1_epi32(0x98BADCFE);
-        D = _mm_set1_epi32(0x10325476);
-        E = _mm_set1_epi32(0xC3D2E1F0);
-        K = _mm_set1_epi32(0x5A827999);
-
-        R1(W[0],  A, B, C, D, E);
-        R1(W[1],  E, A, B, C, D);
-        R1(W[2],  D, E, A, B, C);
-        R1(W[3],  C, D, E, A, B); W[4]  = _mm_setzero_si128();
-        R1(W[4],  B, C, D, E, A); W[5]  = _mm_setzero_si128();
-        R1(W[5],  A, B, C, D, E); W[6]  = _mm_setzero_si128();      // 5
-        R1(W[6],  E, A, B, C, D); W[7]  = _mm_setzero_si128();
-        R1(W[7],  D, E, A, B, C); W[8]  = _mm_setzero_si128();
-        R1(W[8],  C, D, E, A, B); W[9]  = _mm_setzero_si128();
-        R1(W[9],  B, C, D, E, A); W[10] = _mm_setzero_si128();
-        R1(W[10], A, B, C, D, E); W[11] = _mm_setzero_si128();      // 10
-
-        // Fetch the message lengths, we can use a 4x4 matrix transpose to
-        // shuffle the words into the correct position.
-        W[12] = _mm_load_si128(&N[i + 0]);
-        W[13] = _mm_load_si128(&N[i + 1]);
-        W[14] = _mm_load_si128(&N[i + 2]);
-        W[15] = _mm_load_si128(&N[i + 3]);
-
-        _MM_TRANSPOSE4_EPI32(W[12], W[13], W[14], W[15]);
-
-        R1(W[11], E, A, B, C, D);
-        R1(W[12], D, E, A, B, C);
-        R1(W[13], C, D, E, A, B);
-        R1(W[14], B, C, D, E, A);
-        R1(W[15], A, B, C, D, E);                                   // 15
-
-        X(W[0],  W[2],  W[8],  W[13]);  R1(W[0],  E, A, B, C, D);
-        X(W[1],  W[3],  W[9],  W[14]);  R1(W[1],  D, E, A, B, C);
-        X(W[2],  W[4],  W[10], W[15]);  R1(W[2],  C, D, E, A, B);
-        X(W[3],  W[5],  W[11], W[0]);   R1(W[3],  B, C, D, E, A);
-
-        K = _mm_set1_epi32(0x6ED9EBA1);
-
-        X(W[4],  W[6],  W[12], W[1]);   R2(W[4],  A, B, C, D, E);   // 20
-        X(W[5],  W[7],  W[13], W[2]);   R2(W[5],  E, A, B, C, D);
-        X(W[6],  W[8],  W[14], W[3]);   R2(W[6],  D, E, A, B, C);
-        X(W[7],  W[9],  W[15], W[4]);   R2(W[7],  C, D, E, A, B);
-        X(W[8],  W[10], W[0],  W[5]);   R2(W[8],  B, C, D, E, A);
-        X(W[9],  W[11], W[1],  W[6]);   R2(W[9],  A, B, C, D, E);   // 25
-        X(W[10], W[12], W[2],  W[7]);   R2(W[10], E, A, B, C, D);
-        X(W[11], W[13], W[3],  W[8]);   R2(W[11], D, E, A, B, C);
-        X(W[12], W[14], W[4],  W[9]);   R2(W[12], C, D, E, A, B);
-        X(W[13], W[15], W[5],  W[10]);  R2(W[13], B, C, D, E, A);
-        X(W[14], W[0],  W[6],  W[11]);  R2(W[14], A, B, C, D, E);   // 30
-        X(W[15], W[1],  W[7],  W[12]);  R2(W[15], E, A, B, C, D);
-        X(W[0],  W[2],  W[8],  W[13]);  R2(W[0],  D, E, A, B, C);
-        X(W[1],  W[3],  W[9],  W[14]);  R2(W[1],  C, D, E, A, B);
-        X(W[2],  W[4],  W[10], W[15]);  R2(W[2],  B, C, D, E, A);
-        X(W[3],  W[5],  W[11], W[0]);   R2(W[3],  A, B, C, D, E);   // 35
-        X(W[4],  W[6],  W[12], W[1]);   R2(W[4],  E, A, B, C, D);
-        X(W[5],  W[7],  W[13], W[2]);   R2(W[5],  D, E, A, B, C);
-        X(W[6],  W[8],  W[14], W[3]);   R2(W[6],  C, D, E, A, B);
-        X(W[7],  W[9],  W[15], W[4]);   R2(W[7],  B, C, D, E, A);
-
-        K = _mm_set1_epi32(0x8F1BBCDC);
-
-        X(W[8],  W[10], W[0],  W[5]);   R3(W[8],  A, B, C, D, E);   // 40
-        X(W[9],  W[11], W[1],  W[6]);   R3(W[9],  E, A, B, C, D);
-        X(W[10], W[12], W[2],  W[7]);   R3(W[10], D, E, A, B, C);
-        X(W[11], W[13], W[3],  W[8]);   R3(W[11], C, D, E, A, B);
-        X(W[12], W[14], W[4],  W[9]);   R3(W[12], B, C, D, E, A);
-        X(W[13], W[15], W[5],  W[10]);  R3(W[13], A, B, C, D, E);   // 45
-        X(W[14], W[0],  W[6],  W[11]);  R3(W[14], E, A, B, C, D);
-        X(W[15], W[1],  W[7],  W[12]);  R3(W[15], D, E, A, B, C);
-        X(W[0],  W[2],  W[8],  W[13]);  R3(W[0],  C, D, E, A, B);
-        X(W[1],  W[3],  W[9],  W[14]);  R3(W[1],  B, C, D, E, A);
-        X(W[2],  W[4],  W[10], W[15]);  R3(W[2],  A, B, C, D, E);   // 50
-        X(W[3],  W[5],  W[11], W[0]);   R3(W[3],  E, A, B, C, D);
-        X(W[4],  W[6],  W[12], W[1]);   R3(W[4],  D, E, A, B, C);
-        X(W[5],  W[7],  W[13], W[2]);   R3(W[5],  C, D, E, A, B);
-        X(W[6],  W[8],  W[14], W[3]);   R3(W[6],  B, C, D, E, A);
-        X(W[7],  W[9],  W[15], W[4]);   R3(W[7],  A, B, C, D, E);   // 55
-        X(W[8],  W[10], W[0],  W[5]);   R3(W[8],  E, A, B, C, D);
-        X(W[9],  W[11], W[1],  W[6]);   R3(W[9],  D, E, A, B, C);
-        X(W[10], W[12], W[2],  W[7]);   R3(W[10], C, D, E, A, B);
-        X(W[11], W[13], W[3],  W[8]);   R3(W[11], B, C, D, E, A);
-
-        K = _mm_set1_epi32(0xCA62C1D6);
-
-        X(W[12], W[14], W[4],  W[9]);   R2(W[12], A, B, C, D, E);   // 60
-        X(W[13], W[15], W[5],  W[10]);  R2(W[13], E, A, B, C, D);
-        X(W[14], W[0],  W[6],  W[11]);  R2(W[14], D, E, A, B, C);
-        X(W[15], W[1],  W[7],  W[12]);  R2(W[15], C, D, E, A, B);
-        X(W[0],  W[2],  W[8],  W[13]);  R2(W[0],  B, C, D, E, A);
-        X(W[1],  W[3],  W[9],  W[14]);  R2(W[1],  A, B, C, D, E);   // 65
-        X(W[2],  W[4],  W[10], W[15]);  R2(W[2],  E, A, B, C, D);
-        X(W[3],  W[5],  W[11], W[0]);   R2(W[3],  D, E, A, B, C);
-        X(W[4],  W[6],  W[12], W[1]);   R2(W[4],  C, D, E, A, B);
-        X(W[5],  W[7],  W[13], W[2]);   R2(W[5],  B, C, D, E, A);
-        X(W[6],  W[8],  W[14], W[3]);   R2(W[6],  A, B, C, D, E);   // 70
-        X(W[7],  W[9],  W[15], W[4]);   R2(W[7],  E, A, B, C, D);
-        X(W[8],  W[10], W[0],  W[5]);   R2(W[8],  D, E, A, B, C);
-        X(W[9],  W[11], W[1],  W[6]);   R2(W[9],  C, D, E, A, B);
-        X(W[10], W[12], W[2],  W[7]);   R2(W[10], B, C, D, E, A);
-        X(W[11], W[13], W[3],  W[8]);   R4(W[11], A, B, C, D, E);   // 75
-
-        // A75 has an interesting property, it is the first word that is (almost)
-        // part of the final MD (E79 ror 2). The common case will be that this
-        // doesn't match, so we stop here and save 5 rounds.
-        //
-        // Note that I'm using E due to the displacement caused by vectorization,
-        // this is A in standard SHA-1.
-        _mm_store_si128(&MD[i], E);
+        L = _mm_load_si128(&N[i]);
+
+        if (!_mm_movemask_epi8(_mm_cmpgt_epi32(L, _mm_set1_epi32(3 << 3))))
+            sha1_fmt_crypt_block(i, L, 1);
+        else if (!_mm_movemask_epi8(_mm_cmpgt_epi32(L, _mm_set1_epi32(7 << 3))))
+            sha1_fmt_crypt_block(i, L, 2);
+        else if (!_mm_movemask_epi8(_mm_cmpgt_epi32(L, _mm_set1_epi32(11 << 3))))
+            sha1_fmt_crypt_block(i, L, 3);
+        else
+            sha1_fmt_crypt_block(i, L, 4);
     }
     return;
 }
@@ -49,12 +49,14 @@
 #include "config.h"
 #include "options.h"
 #include "bench.h"
+#include "status.h"
 
 volatile int event_pending = 0;
 volatile int event_abort = 0, event_save = 0, event_status = 0;
 volatile int event_ticksafety = 0;
+volatile int event_phase_stats = 0;
 
-volatile int timer_abort = -1, timer_status = -1;
+volatile int timer_abort = -1, timer_status = -1, timer_phase_stats = -1;
 static int timer_save_interval, timer_save_value;
 static clock_t timer_ticksafety_interval, timer_ticksafety_value;
 
@@ -117,6 +119,9 @@ static void sig_handle_update(int signum)
 
 #ifdef HAVE_MPI
 	event_status = 1;
+#elif defined(SIGUSR1)
+	if (signum == SIGUSR1)
+		event_status = 1;
 #endif
 #ifndef SA_RESTART
 	sig_install_update();
@@ -132,21 +137,21 @@ static void sig_install_update(void)
 	sa.sa_handler = sig_handle_update;
 	sa.sa_flags = SA_RESTART;
 	sigaction(SIGHUP, &sa, NULL);
-#ifdef HAVE_MPI
+#ifdef SIGUSR1
 	sigaction(SIGUSR1, &sa, NULL);
-#endif /* HAVE_MPI */
+#endif
 #else
 	signal(SIGHUP, sig_handle_update);
-#ifdef HAVE_MPI
+#ifdef SIGUSR1
 	signal(SIGUSR1, sig_handle_update);
-#endif /* HAVE_MPI */
+#endif
 #endif
 }
 
 static void sig_remove_update(void)
 {
 	signal(SIGHUP, SIG_IGN);
-#ifdef HAVE_MPI
+#ifdef SIGUSR1
 	signal(SIGUSR1, SIG_DFL);
 #endif
 }
@@ -289,6 +294,11 @@ static void sig_handle_timer(int signum)
 		event_status = event_pending = 1;
 		timer_status = options.status_interval;
 	}
+
+	if (!--timer_phase_stats) {
+		event_phase_stats = event_pending = 1;
+		timer_phase_stats = status_phase_interval;
+	}
 #endif
 
 	if (!--timer_ticksafety_value) {
@@ -26,6 +26,7 @@ extern volatile int event_abort;	/* Abort requested */
 extern volatile int event_save;		/* Save the crash recovery file */
 extern volatile int event_status;	/* Status display requested */
 extern volatile int event_ticksafety;	/* System time in ticks may overflow */
+extern volatile int event_phase_stats;	/* Rewrite the phase stats file */
 
 /* Zero if --max-run-time was reached */
 extern volatile int timer_abort;
@@ -33,6 +34,9 @@ extern volatile int timer_abort;
 /* Zero if --progress-every was reached */
 extern volatile int timer_status;
 
+/* Zero when the phase stats file is due for a rewrite (PhaseStats) */
+extern volatile int timer_phase_stats;
+
 #if !OS_TIMER
 /*
  * Timer emulation for systems with no setitimer(2).
@@ -128,16 +128,24 @@ static void single_init(void)
 
 	log_event("- %d preprocessed word mangling rules", rule_count);
 
+	if (options.node_count) {
+		int my_rules, rule;
+
+		for (rule = my_rules = 0; rule < rule_count; rule++)
+			if (NODE_OWNS(rule))
+				my_rules++;
+		log_event("- Node %u-%u/%u: processing %d of %d rules",
+		    options.node_min, options.node_max, options.node_count,
+		    my_rules, rule_count);
 #ifdef HAVE_MPI
-	if (mpi_p > 1) {
-		log_event("MPI hack active: processsing 1/%d of rules, total %d for "
-		    "this node", mpi_p, (rule_count / mpi_p) +
-		    (rule_count % mpi_p > mpi_id ? 1 : 0));
-		if (mpi_id == 0) fprintf(stderr,"MPI: each node processing 1/%d of %d "
-		    "rules. (%seven split)\n",
-		    mpi_p, rule_count, rule_count % mpi_p ? "un" : "");
-	}
+		if (mpi_id == 0)
 #endif
+		fprintf(stderr, "Node %u-%u/%u: processing %d of %d rules. "
+		    "(%seven split)\n",
+		    options.node_min, options.node_max, options.node_count,
+		    my_rules, rule_count,
+		    rule_count % options.node_count ? "un" : "");
+	}
 	status_init(get_progress, 0);
 
 	rec_restore_mode(restore_state);
@@ -297,6 +305,17 @@ static int single_process_buffer(struct db_salt *salt)
 	return 0;
 }
 
+static char *single_rules_apply(char *word, char *rule, int split)
+{
+	char *key;
+
+	status_phase(PHASE_RULES);
+	key = rules_apply(word, rule, split, NULL);
+	status_phase(PHASE_GENERATE);
+
+	return key;
+}
+
 static int single_process_pw(struct db_salt *salt, struct db_password *pw,
 	char *rule)
 {
@@ -314,7 +333,7 @@ static int single_process_pw(struct db_salt *salt, struct db_password *pw,
 
 	first_number = 0;
 	do {
-		if ((key = rules_apply(first->data, rule, 0, NULL)))
+		if ((key = single_rules_apply(first->data, rule, 0)))
 		if (ext_filter(key))
 		if (single_add_key(keys, key))
 		if (single_process_buffer(salt)) return 1;
@@ -334,7 +353,7 @@ static int single_process_pw(struct db_salt *salt, struct db_password *pw,
 				strnzcpy(pair, first->data, RULE_WORD_SIZE);
 				strnzcat(pair, second->data, RULE_WORD_SIZE);
 
-				if ((key = rules_apply(pair, rule, split, NULL)))
+				if ((key = single_rules_apply(pair, rule, split)))
 				if (ext_filter(key))
 				if (single_add_key(keys, key))
 				if (single_process_buffer(salt)) return 1;
@@ -347,7 +366,7 @@ static int single_process_pw(struct db_salt *salt, struct db_password *pw,
 				pair[1] = 0;
 				strnzcat(pair, second->data, RULE_WORD_SIZE);
 
-				if ((key = rules_apply(pair, rule, 1, NULL)))
+				if ((key = single_rules_apply(pair, rule, 1)))
 				if (ext_filter(key))
 				if (single_add_key(keys, key))
 				if (single_process_buffer(salt)) return 1;
@@ -419,13 +438,11 @@ static void single_run(void)
 
 	saved_min = rec_rule;
 	while ((prerule = rpp_next(rule_ctx))) {
-#ifdef HAVE_MPI
-		// MPI distribution: leapfrog rules
-		if (rule_number % mpi_p != mpi_id) {
+		// Node distribution: leapfrog rules
+		if (!NODE_OWNS(rule_number)) {
 			rule_number++;
 			continue;
 		}
-#endif
 		if (!(rule = rules_reject(prerule, 0, NULL, single_db))) {
 			log_event("- Rule #%d: '%.100s' rejected",
 				++rule_number, prerule);
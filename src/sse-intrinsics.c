@@ -12,9 +12,13 @@
 #ifdef __XOP__
 #include <x86intrin.h>
 #endif
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
 #include "memory.h"
 #include "md5.h"
 #include "MD5_std.h"
+#include "sse-intrinsics.h"
 
 #ifndef __XOP__
 #define _mm_slli_epi32a(a, s) \
@@ -85,6 +89,215 @@ void sse_debug(void)
 	debug = 1;
 }
 
+/*
+ * The 64 MD5 steps, for the 128-bit and the wider bodies below.  The last
+ * four are kept apart so that SSEi_REVERSE_STEPS can stop short of them.
+ */
+#define MD5_ROUNDS_60(STEP, F, G, H, I) \
+	/* Round 1 */ \
+	STEP(F, a, b, c, d, 0, 0xd76aa478, 7) \
+	STEP(F, d, a, b, c, 1, 0xe8c7b756, 12) \
+	STEP(F, c, d, a, b, 2, 0x242070db, 17) \
+	STEP(F, b, c, d, a, 3, 0xc1bdceee, 22) \
+	STEP(F, a, b, c, d, 4, 0xf57c0faf, 7) \
+	STEP(F, d, a, b, c, 5, 0x4787c62a, 12) \
+	STEP(F, c, d, a, b, 6, 0xa8304613, 17) \
+	STEP(F, b, c, d, a, 7, 0xfd469501, 22) \
+	STEP(F, a, b, c, d, 8, 0x698098d8, 7) \
+	STEP(F, d, a, b, c, 9, 0x8b44f7af, 12) \
+	STEP(F, c, d, a, b, 10, 0xffff5bb1, 17) \
+	STEP(F, b, c, d, a, 11, 0x895cd7be, 22) \
+	STEP(F, a, b, c, d, 12, 0x6b901122, 7) \
+	STEP(F, d, a, b, c, 13, 0xfd987193, 12) \
+	STEP(F, c, d, a, b, 14, 0xa679438e, 17) \
+	STEP(F, b, c, d, a, 15, 0x49b40821, 22) \
+\
+	/* Round 2 */ \
+	STEP(G, a, b, c, d, 1, 0xf61e2562, 5) \
+	STEP(G, d, a, b, c, 6, 0xc040b340, 9) \
+	STEP(G, c, d, a, b, 11, 0x265e5a51, 14) \
+	STEP(G, b, c, d, a, 0, 0xe9b6c7aa, 20) \
+	STEP(G, a, b, c, d, 5, 0xd62f105d, 5) \
+	STEP(G, d, a, b, c, 10, 0x02441453, 9) \
+	STEP(G, c, d, a, b, 15, 0xd8a1e681, 14) \
+	STEP(G, b, c, d, a, 4, 0xe7d3fbc8, 20) \
+	STEP(G, a, b, c, d, 9, 0x21e1cde6, 5) \
+	STEP(G, d, a, b, c, 14, 0xc33707d6, 9) \
+	STEP(G, c, d, a, b, 3, 0xf4d50d87, 14) \
+	STEP(G, b, c, d, a, 8, 0x455a14ed, 20) \
+	STEP(G, a, b, c, d, 13, 0xa9e3e905, 5) \
+	STEP(G, d, a, b, c, 2, 0xfcefa3f8, 9) \
+	STEP(G, c, d, a, b, 7, 0x676f02d9, 14) \
+	STEP(G, b, c, d, a, 12, 0x8d2a4c8a, 20) \
+\
+	/* Round 3 */ \
+	STEP(H, a, b, c, d, 5, 0xfffa3942, 4) \
+	STEP(H, d, a, b, c, 8, 0x8771f681, 11) \
+	STEP(H, c, d, a, b, 11, 0x6d9d6122, 16) \
+	STEP(H, b, c, d, a, 14, 0xfde5380c, 23) \
+	STEP(H, a, b, c, d, 1, 0xa4beea44, 4) \
+	STEP(H, d, a, b, c, 4, 0x4bdecfa9, 11) \
+	STEP(H, c, d, a, b, 7, 0xf6bb4b60, 16) \
+	STEP(H, b, c, d, a, 10, 0xbebfbc70, 23) \
+	STEP(H, a, b, c, d, 13, 0x289b7ec6, 4) \
+	STEP(H, d, a, b, c, 0, 0xeaa127fa, 11) \
+	STEP(H, c, d, a, b, 3, 0xd4ef3085, 16) \
+	STEP(H, b, c, d, a, 6, 0x04881d05, 23) \
+	STEP(H, a, b, c, d, 9, 0xd9d4d039, 4) \
+	STEP(H, d, a, b, c, 12, 0xe6db99e5, 11) \
+	STEP(H, c, d, a, b, 15, 0x1fa27cf8, 16) \
+	STEP(H, b, c, d, a, 2, 0xc4ac5665, 23) \
+\
+	/* Round 4 */ \
+	STEP(I, a, b, c, d, 0, 0xf4292244, 6) \
+	STEP(I, d, a, b, c, 7, 0x432aff97, 10) \
+	STEP(I, c, d, a, b, 14, 0xab9423a7, 15) \
+	STEP(I, b, c, d, a, 5, 0xfc93a039, 21) \
+	STEP(I, a, b, c, d, 12, 0x655b59c3, 6) \
+	STEP(I, d, a, b, c, 3, 0x8f0ccc92, 10) \
+	STEP(I, c, d, a, b, 10, 0xffeff47d, 15) \
+	STEP(I, b, c, d, a, 1, 0x85845dd1, 21) \
+	STEP(I, a, b, c, d, 8, 0x6fa87e4f, 6) \
+	STEP(I, d, a, b, c, 15, 0xfe2ce6e0, 10) \
+	STEP(I, c, d, a, b, 6, 0xa3014314, 15) \
+	STEP(I, b, c, d, a, 13, 0x4e0811a1, 21)
+
+#define MD5_ROUNDS_LAST(STEP, F, G, H, I) \
+	STEP(I, a, b, c, d, 4, 0xf7537e82, 6) \
+	STEP(I, d, a, b, c, 11, 0xbd3af235, 10) \
+	STEP(I, c, d, a, b, 2, 0x2ad7d2bb, 15) \
+	STEP(I, b, c, d, a, 9, 0xeb86d391, 21)
+
+#if MD5_SSE_WIDE > 1
+/*
+ * Groups of MD5_SSE_WIDE consecutive 4-lane blocks are processed as one
+ * vector: the words of the blocks are put together on load and split back
+ * on store, so that callers keep using the 4-lane layout.
+ */
+#define MD5_WPARA			(MD5_SSE_PARA / MD5_SSE_WIDE)
+#define MD5_WPARA_DO(x)			for((x)=0;(x)<MD5_WPARA;(x)++)
+
+#if MD5_SSE_WIDE == 4
+typedef __m512i md5_vtype;
+#define md5_vadd			_mm512_add_epi32
+#define md5_vset1			_mm512_set1_epi32
+#define md5_vroti			_mm512_rol_epi32
+/* x ? y : z, z ? x : y, x ^ y ^ z and y ^ (x | ~z) */
+#define MD5_WF(x,y,z)			_mm512_ternarylogic_epi32(x, y, z, 0xCA)
+#define MD5_WG(x,y,z)			_mm512_ternarylogic_epi32(z, x, y, 0xCA)
+#define MD5_WH(x,y,z)			_mm512_ternarylogic_epi32(x, y, z, 0x96)
+#define MD5_WI(x,y,z)			_mm512_ternarylogic_epi32(x, y, z, 0x39)
+#define md5_vload(p, s) \
+	_mm512_inserti64x4(_mm512_castsi256_si512( \
+	    _mm256_inserti128_si256(_mm256_castsi128_si256((p)[0]), \
+	    (p)[s], 1)), \
+	    _mm256_inserti128_si256(_mm256_castsi128_si256((p)[2 * (s)]), \
+	    (p)[3 * (s)], 1), 1)
+#define md5_vstore(p, s, v) \
+	(p)[0] = _mm512_extracti32x4_epi32(v, 0); \
+	(p)[s] = _mm512_extracti32x4_epi32(v, 1); \
+	(p)[2 * (s)] = _mm512_extracti32x4_epi32(v, 2); \
+	(p)[3 * (s)] = _mm512_extracti32x4_epi32(v, 3);
+#else
+typedef __m256i md5_vtype;
+#define md5_vadd			_mm256_add_epi32
+#define md5_vset1			_mm256_set1_epi32
+#define md5_vroti(a, s) \
+	_mm256_or_si256(_mm256_slli_epi32(a, s), _mm256_srli_epi32(a, 32 - (s)))
+#define MD5_WF(x,y,z) \
+	_mm256_xor_si256(_mm256_and_si256(_mm256_xor_si256(y, z), x), z)
+#define MD5_WG(x,y,z) \
+	_mm256_xor_si256(_mm256_and_si256(_mm256_xor_si256(y, x), z), y)
+#define MD5_WH(x,y,z) \
+	_mm256_xor_si256(_mm256_xor_si256(y, z), x)
+#define MD5_WI(x,y,z) \
+	_mm256_xor_si256(_mm256_or_si256(_mm256_andnot_si256(z, mask), x), y)
+#define md5_vload(p, s) \
+	_mm256_inserti128_si256(_mm256_castsi128_si256((p)[0]), (p)[s], 1)
+#define md5_vstore(p, s, v) \
+	(p)[0] = _mm256_castsi256_si128(v); \
+	(p)[s] = _mm256_extracti128_si256(v, 1);
+#endif
+
+#define MD5_WSTEP(f, a, b, c, d, x, t, s) \
+	MD5_WPARA_DO(i) a[i] = md5_vadd( a[i], md5_vset1(t) ); \
+	MD5_WPARA_DO(i) a[i] = md5_vadd( a[i], f(b[i], c[i], d[i]) ); \
+	MD5_WPARA_DO(i) a[i] = md5_vadd( a[i], w[i*16+x] ); \
+	MD5_WPARA_DO(i) a[i] = md5_vroti( a[i], (s) ); \
+	MD5_WPARA_DO(i) a[i] = md5_vadd( a[i], b[i] );
+
+void SSEmd5body(__m128i* data, unsigned int * out, int init)
+{
+	md5_vtype w[MD5_WPARA*16];
+	md5_vtype a[MD5_WPARA];
+	md5_vtype b[MD5_WPARA];
+	md5_vtype c[MD5_WPARA];
+	md5_vtype d[MD5_WPARA];
+#if MD5_SSE_WIDE == 2
+	md5_vtype mask = _mm256_set1_epi32(0xffffffff);
+#endif
+	__m128i *state = (__m128i *)out;
+	unsigned int i, x;
+
+	MD5_WPARA_DO(i)
+	for (x = 0; x < 16; x++)
+		w[i*16+x] = md5_vload(&data[i*MD5_SSE_WIDE*16+x], 16);
+
+	if(init)
+	{
+		MD5_WPARA_DO(i)
+		{
+			a[i] = md5_vset1(0x67452301);
+			b[i] = md5_vset1(0xefcdab89);
+			c[i] = md5_vset1(0x98badcfe);
+			d[i] = md5_vset1(0x10325476);
+		}
+	}
+	else
+	{
+		MD5_WPARA_DO(i)
+		{
+			a[i] = md5_vload(&state[i*MD5_SSE_WIDE*4+0], 4);
+			b[i] = md5_vload(&state[i*MD5_SSE_WIDE*4+1], 4);
+			c[i] = md5_vload(&state[i*MD5_SSE_WIDE*4+2], 4);
+			d[i] = md5_vload(&state[i*MD5_SSE_WIDE*4+3], 4);
+		}
+	}
+
+	MD5_ROUNDS_60(MD5_WSTEP, MD5_WF, MD5_WG, MD5_WH, MD5_WI)
+
+	if (init & SSEi_REVERSE_STEPS)
+	{
+		MD5_WPARA_DO(i)
+		{
+			b[i] = md5_vadd(b[i], w[i*16+9]);
+			md5_vstore(&state[i*MD5_SSE_WIDE*4+0], 4, b[i])
+		}
+		return;
+	}
+
+	MD5_ROUNDS_LAST(MD5_WSTEP, MD5_WF, MD5_WG, MD5_WH, MD5_WI)
+
+	MD5_WPARA_DO(i)
+	{
+		if (init) {
+			a[i] = md5_vadd(a[i], md5_vset1(0x67452301));
+			b[i] = md5_vadd(b[i], md5_vset1(0xefcdab89));
+			c[i] = md5_vadd(c[i], md5_vset1(0x98badcfe));
+			d[i] = md5_vadd(d[i], md5_vset1(0x10325476));
+		} else {
+			a[i] = md5_vadd(a[i], md5_vload(&state[i*MD5_SSE_WIDE*4+0], 4));
+			b[i] = md5_vadd(b[i], md5_vload(&state[i*MD5_SSE_WIDE*4+1], 4));
+			c[i] = md5_vadd(c[i], md5_vload(&state[i*MD5_SSE_WIDE*4+2], 4));
+			d[i] = md5_vadd(d[i], md5_vload(&state[i*MD5_SSE_WIDE*4+3], 4));
+		}
+		md5_vstore(&state[i*MD5_SSE_WIDE*4+0], 4, a[i])
+		md5_vstore(&state[i*MD5_SSE_WIDE*4+1], 4, b[i])
+		md5_vstore(&state[i*MD5_SSE_WIDE*4+2], 4, c[i])
+		md5_vstore(&state[i*MD5_SSE_WIDE*4+3], 4, d[i])
+	}
+}
+#else
 void SSEmd5body(__m128i* data, unsigned int * out, int init)
 {
 	__m128i a[MD5_SSE_PARA];
@@ -118,77 +331,19 @@ void SSEmd5body(__m128i* data, unsigned int * out, int init)
 		}
 	}
 
-/* Round 1 */
-		MD5_STEP(MD5_F, a, b, c, d, 0, 0xd76aa478, 7)
-		MD5_STEP(MD5_F, d, a, b, c, 1, 0xe8c7b756, 12)
-		MD5_STEP(MD5_F, c, d, a, b, 2, 0x242070db, 17)
-		MD5_STEP(MD5_F, b, c, d, a, 3, 0xc1bdceee, 22)
-		MD5_STEP(MD5_F, a, b, c, d, 4, 0xf57c0faf, 7)
-		MD5_STEP(MD5_F, d, a, b, c, 5, 0x4787c62a, 12)
-		MD5_STEP(MD5_F, c, d, a, b, 6, 0xa8304613, 17)
-		MD5_STEP(MD5_F, b, c, d, a, 7, 0xfd469501, 22)
-		MD5_STEP(MD5_F, a, b, c, d, 8, 0x698098d8, 7)
-		MD5_STEP(MD5_F, d, a, b, c, 9, 0x8b44f7af, 12)
-		MD5_STEP(MD5_F, c, d, a, b, 10, 0xffff5bb1, 17)
-		MD5_STEP(MD5_F, b, c, d, a, 11, 0x895cd7be, 22)
-		MD5_STEP(MD5_F, a, b, c, d, 12, 0x6b901122, 7)
-		MD5_STEP(MD5_F, d, a, b, c, 13, 0xfd987193, 12)
-		MD5_STEP(MD5_F, c, d, a, b, 14, 0xa679438e, 17)
-		MD5_STEP(MD5_F, b, c, d, a, 15, 0x49b40821, 22)
+	MD5_ROUNDS_60(MD5_STEP, MD5_F, MD5_G, MD5_H, MD5_I)
 
-/* Round 2 */
-		MD5_STEP(MD5_G, a, b, c, d, 1, 0xf61e2562, 5)
-		MD5_STEP(MD5_G, d, a, b, c, 6, 0xc040b340, 9)
-		MD5_STEP(MD5_G, c, d, a, b, 11, 0x265e5a51, 14)
-		MD5_STEP(MD5_G, b, c, d, a, 0, 0xe9b6c7aa, 20)
-		MD5_STEP(MD5_G, a, b, c, d, 5, 0xd62f105d, 5)
-		MD5_STEP(MD5_G, d, a, b, c, 10, 0x02441453, 9)
-		MD5_STEP(MD5_G, c, d, a, b, 15, 0xd8a1e681, 14)
-		MD5_STEP(MD5_G, b, c, d, a, 4, 0xe7d3fbc8, 20)
-		MD5_STEP(MD5_G, a, b, c, d, 9, 0x21e1cde6, 5)
-		MD5_STEP(MD5_G, d, a, b, c, 14, 0xc33707d6, 9)
-		MD5_STEP(MD5_G, c, d, a, b, 3, 0xf4d50d87, 14)
-		MD5_STEP(MD5_G, b, c, d, a, 8, 0x455a14ed, 20)
-		MD5_STEP(MD5_G, a, b, c, d, 13, 0xa9e3e905, 5)
-		MD5_STEP(MD5_G, d, a, b, c, 2, 0xfcefa3f8, 9)
-		MD5_STEP(MD5_G, c, d, a, b, 7, 0x676f02d9, 14)
-		MD5_STEP(MD5_G, b, c, d, a, 12, 0x8d2a4c8a, 20)
+	if (init & SSEi_REVERSE_STEPS)
+	{
+		MD5_PARA_DO(i)
+		{
+			b[i] = _mm_add_epi32(b[i], data[i*16+9]);
+			_mm_store_si128((__m128i *)&out[i*16+0], b[i]);
+		}
+		return;
+	}
 
-/* Round 3 */
-		MD5_STEP(MD5_H, a, b, c, d, 5, 0xfffa3942, 4)
-		MD5_STEP(MD5_H, d, a, b, c, 8, 0x8771f681, 11)
-		MD5_STEP(MD5_H, c, d, a, b, 11, 0x6d9d6122, 16)
-		MD5_STEP(MD5_H, b, c, d, a, 14, 0xfde5380c, 23)
-		MD5_STEP(MD5_H, a, b, c, d, 1, 0xa4beea44, 4)
-		MD5_STEP(MD5_H, d, a, b, c, 4, 0x4bdecfa9, 11)
-		MD5_STEP(MD5_H, c, d, a, b, 7, 0xf6bb4b60, 16)
-		MD5_STEP(MD5_H, b, c, d, a, 10, 0xbebfbc70, 23)
-		MD5_STEP(MD5_H, a, b, c, d, 13, 0x289b7ec6, 4)
-		MD5_STEP(MD5_H, d, a, b, c, 0, 0xeaa127fa, 11)
-		MD5_STEP(MD5_H, c, d, a, b, 3, 0xd4ef3085, 16)
-		MD5_STEP(MD5_H, b, c, d, a, 6, 0x04881d05, 23)
-		MD5_STEP(MD5_H, a, b, c, d, 9, 0xd9d4d039, 4)
-		MD5_STEP(MD5_H, d, a, b, c, 12, 0xe6db99e5, 11)
-		MD5_STEP(MD5_H, c, d, a, b, 15, 0x1fa27cf8, 16)
-		MD5_STEP(MD5_H, b, c, d, a, 2, 0xc4ac5665, 23)
-
-/* Round 4 */
-		MD5_STEP(MD5_I, a, b, c, d, 0, 0xf4292244, 6)
-		MD5_STEP(MD5_I, d, a, b, c, 7, 0x432aff97, 10)
-		MD5_STEP(MD5_I, c, d, a, b, 14, 0xab9423a7, 15)
-		MD5_STEP(MD5_I, b, c, d, a, 5, 0xfc93a039, 21)
-		MD5_STEP(MD5_I, a, b, c, d, 12, 0x655b59c3, 6)
-		MD5_STEP(MD5_I, d, a, b, c, 3, 0x8f0ccc92, 10)
-		MD5_STEP(MD5_I, c, d, a, b, 10, 0xffeff47d, 15)
-		MD5_STEP(MD5_I, b, c, d, a, 1, 0x85845dd1, 21)
-		MD5_STEP(MD5_I, a, b, c, d, 8, 0x6fa87e4f, 6)
-		MD5_STEP(MD5_I, d, a, b, c, 15, 0xfe2ce6e0, 10)
-		MD5_STEP(MD5_I, c, d, a, b, 6, 0xa3014314, 15)
-		MD5_STEP(MD5_I, b, c, d, a, 13, 0x4e0811a1, 21)
-		MD5_STEP(MD5_I, a, b, c, d, 4, 0xf7537e82, 6)
-		MD5_STEP(MD5_I, d, a, b, c, 11, 0xbd3af235, 10)
-		MD5_STEP(MD5_I, c, d, a, b, 2, 0x2ad7d2bb, 15)
-		MD5_STEP(MD5_I, b, c, d, a, 9, 0xeb86d391, 21)
+	MD5_ROUNDS_LAST(MD5_STEP, MD5_F, MD5_G, MD5_H, MD5_I)
 
 	if (init) {
 		MD5_PARA_DO(i)
@@ -217,6 +372,8 @@ void SSEmd5body(__m128i* data, unsigned int * out, int init)
 	}
 }
 
+#endif /* MD5_SSE_WIDE */
+
 #define GETPOS(i, index)                ( (index&3)*4 + (i& (0xffffffff-3) )*MMX_COEF + ((i)&3) )
 
 void mmxput(void * buf, unsigned int index, unsigned int bid, unsigned int offset, unsigned char * src, unsigned int len)
@@ -358,8 +515,9 @@ void dispatch(unsigned char buffers[8][64*MD5_SSE_NUM_KEYS], unsigned int f[4*MD
 }
 
 
-void md5cryptsse(unsigned char pwd[MD5_SSE_NUM_KEYS][16], unsigned char * salt, char * out, int md5_type)
+void md5cryptsse(unsigned char * buf, unsigned char * salt, char * out, int md5_type)
 {
+	unsigned char (*pwd)[16] = (unsigned char (*)[16])buf;
 	unsigned int length[MD5_SSE_NUM_KEYS];
 	unsigned int saltlen;
 	unsigned int * bt;
@@ -567,6 +725,17 @@ void SSEmd4body(__m128i* data, unsigned int * out, int init)
 		MD4_STEP(MD4_H, a, b, c, d, 1, cst, 3)
 		MD4_STEP(MD4_H, d, a, b, c, 9, cst, 9)
 		MD4_STEP(MD4_H, c, d, a, b, 5, cst, 11)
+
+		if (init & SSEi_REVERSE_STEPS)
+		{
+			MD4_PARA_DO(i)
+			{
+				c[i] = _mm_add_epi32(c[i], data[i*16+7]);
+				_mm_store_si128((__m128i *)&out[i*16+0], c[i]);
+			}
+			return;
+		}
+
 		MD4_STEP(MD4_H, b, c, d, a, 13, cst, 15)
 		MD4_STEP(MD4_H, a, b, c, d, 3, cst, 3)
 		MD4_STEP(MD4_H, d, a, b, c, 11, cst, 9)
@@ -1084,3 +1253,178 @@ void SSESHA1body(__m128i* data, unsigned int * out, unsigned int * reload_state,
 }
 #endif /* SHA_BUF_SIZ */
 #endif /* SHA1_SSE_PARA */
+
+#ifdef SHA256_SSE_PARA
+/*
+ * As for MD5, with AVX2 and AVX-512 groups of SHA256_SSE_WIDE consecutive
+ * 4-lane blocks are processed as one vector.
+ */
+#ifndef SHA256_SSE_WIDE
+#define SHA256_SSE_WIDE			1
+#endif
+#define SHA256_WPARA			(SHA256_SSE_PARA / SHA256_SSE_WIDE)
+#define SHA256_PARA_DO(x)		for((x)=0;(x)<SHA256_WPARA;(x)++)
+
+#if SHA256_SSE_WIDE == 4
+typedef __m512i sha256_vtype;
+#define sha256_vadd			_mm512_add_epi32
+#define sha256_vset1			_mm512_set1_epi32
+#define sha256_vsrl			_mm512_srli_epi32
+#define sha256_vxor3(x,y,z)		_mm512_ternarylogic_epi32(x, y, z, 0x96)
+#define sha256_vror			_mm512_ror_epi32
+#define SHA256_CH(e,f,g)		_mm512_ternarylogic_epi32(e, f, g, 0xCA)
+#define SHA256_MAJ(a,b,c)		_mm512_ternarylogic_epi32(a, b, c, 0xE8)
+#define sha256_vload(p, s) \
+	_mm512_inserti64x4(_mm512_castsi256_si512( \
+	    _mm256_inserti128_si256(_mm256_castsi128_si256((p)[0]), \
+	    (p)[s], 1)), \
+	    _mm256_inserti128_si256(_mm256_castsi128_si256((p)[2 * (s)]), \
+	    (p)[3 * (s)], 1), 1)
+#define sha256_vstore(p, s, v) \
+	(p)[0] = _mm512_extracti32x4_epi32(v, 0); \
+	(p)[s] = _mm512_extracti32x4_epi32(v, 1); \
+	(p)[2 * (s)] = _mm512_extracti32x4_epi32(v, 2); \
+	(p)[3 * (s)] = _mm512_extracti32x4_epi32(v, 3);
+#elif SHA256_SSE_WIDE == 2
+typedef __m256i sha256_vtype;
+#define sha256_vadd			_mm256_add_epi32
+#define sha256_vset1			_mm256_set1_epi32
+#define sha256_vsrl			_mm256_srli_epi32
+#define sha256_vxor3(x,y,z)		_mm256_xor_si256(_mm256_xor_si256(x, y), z)
+#define sha256_vror(a, s) \
+	_mm256_or_si256(_mm256_srli_epi32(a, s), _mm256_slli_epi32(a, 32 - (s)))
+#define SHA256_CH(e,f,g) \
+	_mm256_xor_si256(_mm256_and_si256(_mm256_xor_si256(f, g), e), g)
+#define SHA256_MAJ(a,b,c) \
+	_mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)))
+#define sha256_vload(p, s) \
+	_mm256_inserti128_si256(_mm256_castsi128_si256((p)[0]), (p)[s], 1)
+#define sha256_vstore(p, s, v) \
+	(p)[0] = _mm256_castsi256_si128(v); \
+	(p)[s] = _mm256_extracti128_si256(v, 1);
+#else
+typedef __m128i sha256_vtype;
+#define sha256_vadd			_mm_add_epi32
+#define sha256_vset1			_mm_set1_epi32
+#define sha256_vsrl			_mm_srli_epi32
+#define sha256_vxor3(x,y,z)		_mm_xor_si128(_mm_xor_si128(x, y), z)
+#define sha256_vror(a, s)		_mm_roti_epi32(a, 32 - (s))
+#ifdef __XOP__
+#define SHA256_CH(e,f,g)		_mm_cmov_si128(f, g, e)
+#else
+#define SHA256_CH(e,f,g) \
+	_mm_xor_si128(_mm_and_si128(_mm_xor_si128(f, g), e), g)
+#endif
+#define SHA256_MAJ(a,b,c) \
+	_mm_or_si128(_mm_and_si128(a, b), _mm_and_si128(c, _mm_or_si128(a, b)))
+#define sha256_vload(p, s)		(p)[0]
+#define sha256_vstore(p, s, v)		(p)[0] = (v);
+#endif
+
+static const unsigned int sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const unsigned int sha256_iv[2][8] = {
+	{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 },
+	{ 0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4 }
+};
+
+#define SHA256_S0(x) sha256_vxor3(sha256_vror(x, 2), sha256_vror(x, 13), sha256_vror(x, 22))
+#define SHA256_S1(x) sha256_vxor3(sha256_vror(x, 6), sha256_vror(x, 11), sha256_vror(x, 25))
+#define SHA256_s0(x) sha256_vxor3(sha256_vror(x, 7), sha256_vror(x, 18), sha256_vsrl(x, 3))
+#define SHA256_s1(x) sha256_vxor3(sha256_vror(x, 17), sha256_vror(x, 19), sha256_vsrl(x, 10))
+
+#define SHA256_EXPAND(t) \
+	SHA256_PARA_DO(i) w[i][(t)&15] = sha256_vadd( \
+		sha256_vadd(w[i][(t)&15], SHA256_s0(w[i][((t)+1)&15])), \
+		sha256_vadd(w[i][((t)+9)&15], SHA256_s1(w[i][((t)+14)&15])));
+
+#define SHA256_ROUND(a,b,c,d,e,f,g,h,t) \
+	SHA256_PARA_DO(i) { \
+		tmp = sha256_vadd(h[i], sha256_vset1(sha256_k[t])); \
+		tmp = sha256_vadd(tmp, w[i][(t)&15]); \
+		tmp = sha256_vadd(tmp, SHA256_S1(e[i])); \
+		tmp = sha256_vadd(tmp, SHA256_CH(e[i],f[i],g[i])); \
+		d[i] = sha256_vadd(d[i], tmp); \
+		tmp = sha256_vadd(tmp, SHA256_S0(a[i])); \
+		h[i] = sha256_vadd(tmp, SHA256_MAJ(a[i],b[i],c[i])); \
+	}
+
+#define SHA256_8ROUNDS(t) \
+	SHA256_ROUND(a, b, c, d, e, f, g, h, (t)+0) \
+	SHA256_ROUND(h, a, b, c, d, e, f, g, (t)+1) \
+	SHA256_ROUND(g, h, a, b, c, d, e, f, (t)+2) \
+	SHA256_ROUND(f, g, h, a, b, c, d, e, (t)+3) \
+	SHA256_ROUND(e, f, g, h, a, b, c, d, (t)+4) \
+	SHA256_ROUND(d, e, f, g, h, a, b, c, (t)+5) \
+	SHA256_ROUND(c, d, e, f, g, h, a, b, (t)+6) \
+	SHA256_ROUND(b, c, d, e, f, g, h, a, (t)+7)
+
+/*
+ * One block of SHA-256 (or SHA-224, if sha224 is set) for SHA256_SSE_PARA
+ * times 4 keys. The input is 16 words per block in the same layout as the
+ * 16 word SHA1 buffers (word t of key j at data[t*4+j], already in big
+ * endian order), and is left alone. The 8 state words go to out[w*4+j],
+ * 32 words per block, in native order.
+ */
+void SSESHA256body(__m128i* data, unsigned int * out, int sha224)
+{
+	sha256_vtype a[SHA256_WPARA], b[SHA256_WPARA], c[SHA256_WPARA], d[SHA256_WPARA];
+	sha256_vtype e[SHA256_WPARA], f[SHA256_WPARA], g[SHA256_WPARA], h[SHA256_WPARA];
+	sha256_vtype w[SHA256_WPARA][16];
+	sha256_vtype tmp;
+	__m128i *state = (__m128i *)out;
+	const unsigned int *iv = sha256_iv[sha224 ? 1 : 0];
+	unsigned int i, t;
+
+	SHA256_PARA_DO(i)
+	{
+		for (t = 0; t < 16; ++t)
+			w[i][t] = sha256_vload(&data[i*SHA256_SSE_WIDE*16+t], 16);
+		a[i] = sha256_vset1(iv[0]);
+		b[i] = sha256_vset1(iv[1]);
+		c[i] = sha256_vset1(iv[2]);
+		d[i] = sha256_vset1(iv[3]);
+		e[i] = sha256_vset1(iv[4]);
+		f[i] = sha256_vset1(iv[5]);
+		g[i] = sha256_vset1(iv[6]);
+		h[i] = sha256_vset1(iv[7]);
+	}
+
+	SHA256_8ROUNDS(0)
+	SHA256_8ROUNDS(8)
+	for (t = 16; t < 64; t += 8) {
+		SHA256_EXPAND(t+0) SHA256_EXPAND(t+1) SHA256_EXPAND(t+2) SHA256_EXPAND(t+3)
+		SHA256_EXPAND(t+4) SHA256_EXPAND(t+5) SHA256_EXPAND(t+6) SHA256_EXPAND(t+7)
+		SHA256_8ROUNDS(t)
+	}
+
+	SHA256_PARA_DO(i)
+	{
+		a[i] = sha256_vadd(a[i], sha256_vset1(iv[0]));
+		b[i] = sha256_vadd(b[i], sha256_vset1(iv[1]));
+		c[i] = sha256_vadd(c[i], sha256_vset1(iv[2]));
+		d[i] = sha256_vadd(d[i], sha256_vset1(iv[3]));
+		e[i] = sha256_vadd(e[i], sha256_vset1(iv[4]));
+		f[i] = sha256_vadd(f[i], sha256_vset1(iv[5]));
+		g[i] = sha256_vadd(g[i], sha256_vset1(iv[6]));
+		h[i] = sha256_vadd(h[i], sha256_vset1(iv[7]));
+		sha256_vstore(&state[i*SHA256_SSE_WIDE*8+0], 8, a[i])
+		sha256_vstore(&state[i*SHA256_SSE_WIDE*8+1], 8, b[i])
+		sha256_vstore(&state[i*SHA256_SSE_WIDE*8+2], 8, c[i])
+		sha256_vstore(&state[i*SHA256_SSE_WIDE*8+3], 8, d[i])
+		sha256_vstore(&state[i*SHA256_SSE_WIDE*8+4], 8, e[i])
+		sha256_vstore(&state[i*SHA256_SSE_WIDE*8+5], 8, f[i])
+		sha256_vstore(&state[i*SHA256_SSE_WIDE*8+6], 8, g[i])
+		sha256_vstore(&state[i*SHA256_SSE_WIDE*8+7], 8, h[i])
+	}
+}
+#endif /* SHA256_SSE_PARA */
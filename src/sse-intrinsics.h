@@ -16,11 +16,30 @@
 #define SSE_type			"SSE2 intrinsics"
 #endif
 
+/*
+ * Or'ed into the init argument of SSEmd5body() and SSEmd4body() (it implies
+ * init).  The body then skips the final steps, which a raw hash format undoes
+ * on the target in its binary() instead, and stores only the value to compare
+ * in the first output word of each key: b after step 60 plus message word 9
+ * for MD5, c after step 43 plus word 7 for MD4 (where word 15 must be zero).
+ * The rest of the output is left alone.
+ */
+#define SSEi_REVERSE_STEPS		2
+
 #ifdef MD5_SSE_PARA
 void md5cryptsse(unsigned char * buf, unsigned char * salt, char * out, int md5_type);
 void SSEmd5body(__m128i* data, unsigned int * out, int init);
+#if MD5_SSE_WIDE == 4
+#define MD5_SSE_type			"AVX-512 intrinsics"
+#define MD5_SSE_BITS			"512/512"
+#elif MD5_SSE_WIDE == 2
+#define MD5_SSE_type			"AVX2 intrinsics"
+#define MD5_SSE_BITS			"256/256"
+#else
 #define MD5_SSE_type			SSE_type
-#define MD5_ALGORITHM_NAME		"128/128 " MD5_SSE_type " " MD5_N_STR
+#define MD5_SSE_BITS			"128/128"
+#endif
+#define MD5_ALGORITHM_NAME		MD5_SSE_BITS " " MD5_SSE_type " " MD5_N_STR
 #elif defined(MMX_COEF) && MMX_COEF == 4
 #define MD5_SSE_type			"SSE2"
 #define MD5_ALGORITHM_NAME		"128/128 " MD5_SSE_type " 4x"
@@ -70,3 +89,18 @@ void SSESHA1body(__m128i* data, unsigned int * out, unsigned int * reload_state,
 #define SHA1_SSE_type			"1x"
 #define SHA1_ALGORITHM_NAME		"32/" ARCH_BITS_STR
 #endif
+
+#ifdef SHA256_SSE_PARA
+void SSESHA256body(__m128i* data, unsigned int * out, int sha224);
+#if SHA256_SSE_WIDE == 4
+#define SHA256_SSE_type			"AVX-512 intrinsics"
+#define SHA256_SSE_BITS			"512/512"
+#elif SHA256_SSE_WIDE == 2
+#define SHA256_SSE_type			"AVX2 intrinsics"
+#define SHA256_SSE_BITS			"256/256"
+#else
+#define SHA256_SSE_type			SSE_type
+#define SHA256_SSE_BITS			"128/128"
+#endif
+#define SHA256_ALGORITHM_NAME		SHA256_SSE_BITS " " SHA256_SSE_type " " SHA256_N_STR
+#endif
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <errno.h>
 #include <time.h>
 #if !defined (__MINGW32__) && !defined (_MSC_VER)
 #include <sys/times.h>
@@ -32,6 +33,8 @@
 #include "misc.h"
 #include "math.h"
 #include "params.h"
+#include "memory.h"
+#include "path.h"
 #include "cracker.h"
 #include "options.h"
 #include "status.h"
@@ -39,9 +42,9 @@
 #include "config.h"
 #include "unicode.h"
 #include "signals.h"
+#include "logger.h"
 
 #ifdef HAVE_MPI
-#include "logger.h"
 #include "john-mpi.h"
 #endif
 
@@ -52,6 +55,17 @@ static double ETAthreshold = 0.05;
 static int showcand;
 int (*status_get_progress)(int *) = NULL;
 
+int status_phase_active = 0;
+int status_phase_interval = 0;
+static int phase_current;
+static unsigned long long phase_last, phase_start;
+static unsigned long long phase_total[PHASE_COUNT], phase_shown[PHASE_COUNT];
+static clock_t phase_start_time;
+static char *phase_file_name, *phase_tmp_name;
+static char *phase_names[PHASE_COUNT] = {
+	"generate", "rules", "io", "set_key", "crypt", "lookup", "guess"
+};
+
 #if CPU_REQ && defined(__GNUC__) && defined(__i386__)
 /* ETA reporting would be wrong when cracking some hash types at least on a
  * Pentium 3 without this... */
@@ -92,6 +106,10 @@ void status_init(int (*get_progress)(int *), int start)
 
 	showcand = cfg_get_bool(SECTION_OPTIONS, NULL, "StatusShowCandidates", 0);
 
+	if ((status_phase_interval =
+	    cfg_get_int(SECTION_OPTIONS, NULL, "PhaseStats")) < 0)
+		status_phase_interval = 0;
+
 	clk_tck_init();
 }
 
@@ -425,6 +443,164 @@ static void status_print_stdout(char *percent)
 			crk_get_key1());
 }
 
+/*
+ * The time stamp counter where we have it, as the phases are switched
+ * several times per candidate. Its rate doesn't matter much: shares are
+ * ratios, and seconds are scaled against the elapsed real time.
+ */
+static unsigned long long status_phase_clock(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	unsigned int lo, hi;
+
+	__asm__ __volatile__("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((unsigned long long)hi << 32) | lo;
+#else
+	return clock();
+#endif
+}
+
+void status_phase_switch(int phase)
+{
+	unsigned long long now = status_phase_clock();
+
+	phase_total[phase_current] += now - phase_last;
+	phase_last = now;
+	phase_current = phase;
+}
+
+void status_phase_start(void)
+{
+	char *name;
+#ifdef HAVE_MPI
+	char *suffix;
+#endif
+
+	if (!status_phase_interval ||
+	    (options.flags & (FLG_TEST_CHK | FLG_STATUS_CHK)))
+		return;
+
+	if (!phase_file_name) {
+#ifdef HAVE_MPI
+		suffix = mem_alloc_tiny(strlen(id2string()) + 1 +
+		    strlen(STATS_SUFFIX) + 1, MEM_ALIGN_NONE);
+		suffix[0] = 0;
+		if (mpi_p > 1) {
+			strcat(suffix, ".");
+			strcat(suffix, id2string());
+		}
+		strcat(suffix, STATS_SUFFIX);
+		name = path_session(options.session ?
+		    options.session : RECOVERY_NAME, suffix);
+		name = str_alloc_copy(path_expand(name));
+#else
+		if (options.session)
+			name = path_session(options.session, STATS_SUFFIX);
+		else
+			name = STATS_NAME;
+		name = str_alloc_copy(path_expand(name));
+#endif
+		phase_tmp_name = mem_alloc_tiny(strlen(name) + 5,
+		    MEM_ALIGN_NONE);
+		strcpy(phase_tmp_name, name);
+		strcat(phase_tmp_name, ".tmp");
+		phase_file_name = name;
+	}
+
+	memset(phase_total, 0, sizeof(phase_total));
+	memset(phase_shown, 0, sizeof(phase_shown));
+	phase_current = PHASE_GENERATE;
+	phase_start_time = get_time();
+	phase_start = phase_last = status_phase_clock();
+	status_phase_active = 1;
+
+	timer_phase_stats = status_phase_interval;
+
+	log_event("- Timing the cracking loop phases, stats in %.100s",
+	    phase_file_name);
+}
+
+void status_phase_stop(void)
+{
+	if (!status_phase_active)
+		return;
+
+	status_phase_write();
+	status_phase_active = 0;
+	timer_phase_stats = -1;
+}
+
+void status_phase_write(void)
+{
+	FILE *file;
+	unsigned long long elapsed;
+	double seconds, sum;
+	int phase;
+
+	if (!status_phase_active || !phase_file_name)
+		return;
+
+	status_phase_switch(phase_current);
+
+	elapsed = phase_last - phase_start;
+	seconds = (double)(get_time() - phase_start_time) / clk_tck;
+	sum = 0;
+	for (phase = 0; phase < PHASE_COUNT; phase++)
+		sum += phase_total[phase];
+
+	if (!(file = fopen(phase_tmp_name, "w"))) {
+		fprintf(stderr, "Can't write phase stats: %s: %s\n",
+		    phase_tmp_name, strerror(errno));
+		phase_file_name = NULL;
+		return;
+	}
+
+	fprintf(file, "time: %u\ncrypts: %llu\n",
+	    status_get_time(),
+	    ((unsigned long long)status.crypts.hi << 32) + status.crypts.lo);
+	for (phase = 0; phase < PHASE_COUNT; phase++)
+		fprintf(file, "%s: %.3f s %.2f%%\n", phase_names[phase],
+		    elapsed ? phase_total[phase] * seconds / elapsed : 0.0,
+		    sum ? 100.0 * phase_total[phase] / sum : 0.0);
+
+	if (fclose(file) || rename(phase_tmp_name, phase_file_name)) {
+		fprintf(stderr, "Can't write phase stats: %s: %s\n",
+		    phase_file_name, strerror(errno));
+		phase_file_name = NULL;
+	}
+}
+
+/*
+ * Shares of the phases since the previous status line.
+ */
+static void status_print_phases(void)
+{
+	unsigned long long delta[PHASE_COUNT];
+	double sum;
+	int phase;
+
+	status_phase_switch(phase_current);
+
+	sum = 0;
+	for (phase = 0; phase < PHASE_COUNT; phase++) {
+		delta[phase] = phase_total[phase] - phase_shown[phase];
+		phase_shown[phase] = phase_total[phase];
+		sum += delta[phase];
+	}
+	if (!sum)
+		return;
+
+#ifdef HAVE_MPI
+	if (mpi_p > 1)
+		fprintf(stderr, "%3d: ", mpi_id);
+#endif
+	fprintf(stderr, "phases:");
+	for (phase = 0; phase < PHASE_COUNT; phase++)
+		fprintf(stderr, " %s %.1f%%", phase_names[phase],
+		    100.0 * delta[phase] / sum);
+	fputc('\n', stderr);
+}
+
 static void status_print_cracking(char *percent)
 {
 	unsigned int time = status_get_time();
@@ -564,4 +740,7 @@ void status_print(void)
 	else
 		status_print_cracking(s_percent);
 #endif
+
+	if (status_phase_active)
+		status_print_phases();
 }
@@ -67,4 +67,53 @@ extern unsigned int status_get_time(void);
  */
 extern void status_print(void);
 
+/*
+ * Cracking loop phases, timed when PhaseStats is enabled in john.conf.
+ * Whatever happens outside of the cracker (the cracking mode producing
+ * its next candidate) is charged to PHASE_GENERATE.
+ */
+#define PHASE_GENERATE			0
+#define PHASE_RULES			1
+#define PHASE_IO			2
+#define PHASE_SET_KEY			3
+#define PHASE_CRYPT			4
+#define PHASE_LOOKUP			5
+#define PHASE_GUESS			6
+#define PHASE_COUNT			7
+
+/*
+ * Non-zero while the phases are being timed.
+ */
+extern int status_phase_active;
+
+/*
+ * Seconds between rewrites of the phase stats file (0 if disabled).
+ */
+extern int status_phase_interval;
+
+/*
+ * Charges the time since the previous switch to the phase we were in and
+ * enters a new one. Use status_phase() in the hot paths, it costs a single
+ * test when phase timing is off.
+ */
+extern void status_phase_switch(int phase);
+
+#define status_phase(phase) \
+	do { \
+		if (status_phase_active) \
+			status_phase_switch(phase); \
+	} while (0)
+
+/*
+ * Starts and stops timing the phases, called by the cracker. Stopping
+ * also rewrites the phase stats file a final time.
+ */
+extern void status_phase_start(void);
+extern void status_phase_stop(void);
+
+/*
+ * Rewrites the phase stats file with the cumulative breakdown.
+ */
+extern void status_phase_write(void);
+
 #endif
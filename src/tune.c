@@ -0,0 +1,237 @@
+/*
+ * This file is part of John the Ripper password cracker.
+ * No copyright is claimed, and the software is hereby placed in the
+ * public domain.  Redistribution and use in source and binary forms,
+ * with or without modification, are permitted.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _MSC_VER
+#include <unistd.h>
+#include <sys/time.h>
+#else
+#include <time.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "arch.h"
+#include "misc.h"
+#include "params.h"
+#include "path.h"
+#include "config.h"
+#include "formats.h"
+#include "loader.h"
+#include "logger.h"
+#include "options.h"
+#include "signals.h"
+#include "tune.h"
+#ifdef HAVE_MPI
+#include "john-mpi.h"
+#endif
+
+/*
+ * Batch sizes tried are max_keys_per_crypt halved again and again, rounded
+ * down to a multiple of min_keys_per_crypt.  Each gets TUNE_TIME ms (or
+ * at least one crypt_all() call), going over the loaded salts.  We give up
+ * on a format whose single crypt_all() takes more than 4 times that, since
+ * measuring it would cost more than it could gain.
+ */
+#define TUNE_SIZES			8
+#define TUNE_TIME			200
+
+/*
+ * A smaller batch is preferred unless a larger one is faster by more than
+ * this many percent, for quicker status updates and less work left over
+ * on abort.
+ */
+#define TUNE_TOLERANCE			2
+
+static unsigned long long tune_usec(void)
+{
+#ifdef _MSC_VER
+	return (unsigned long long)clock() * 1000000 / CLOCKS_PER_SEC;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (unsigned long long)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+static char *tune_host(void)
+{
+	static char host[64];
+
+#if defined (__MINGW32__) || defined (_MSC_VER)
+	char *p;
+
+	if ((p = getenv("COMPUTERNAME")))
+		strnzcpy(host, p, sizeof(host));
+#else
+	if (gethostname(host, sizeof(host) - 1))
+		host[0] = 0;
+	host[sizeof(host) - 1] = 0;
+#endif
+	if (!host[0])
+		strcpy(host, "localhost");
+
+	return host;
+}
+
+/*
+ * Order of magnitude of the salt count, since a batch size good for a
+ * handful of salts is just as good for a few more.
+ */
+static int tune_salt_class(int count)
+{
+	int class = 0;
+
+	while (count >= 16) {
+		count >>= 4;
+		class++;
+	}
+
+	return class;
+}
+
+/*
+ * Returns crypts per second with batches of "keys" keys, or 0 if a single
+ * crypt_all() takes too long to be worth measuring.
+ */
+static double tune_measure(struct db_main *db, int keys)
+{
+	struct fmt_main *format = db->format;
+	struct db_salt *salt;
+	char key[PLAINTEXT_BUFFER_SIZE];
+	unsigned long long start, now, crypts = 0;
+	int index, length, pos;
+
+	if ((length = format->params.plaintext_length) > 8)
+		length = 8;
+	memset(key, 'a', length);
+	key[length] = 0;
+
+	start = tune_usec();
+	do {
+		format->methods.clear_keys();
+		for (index = 0; index < keys; index++) {
+			format->methods.set_key(key, index);
+			pos = length - 1;
+			while (pos >= 0 && ++key[pos] > 'z')
+				key[pos--] = 'a';
+		}
+
+		salt = db->salts;
+		do {
+			format->methods.set_salt(salt->salt);
+			format->methods.crypt_all(keys);
+			format->methods.cmp_all(salt->list->binary, keys);
+			crypts += keys;
+			now = tune_usec();
+		} while ((salt = salt->next) &&
+		    now - start < 1000ULL * TUNE_TIME && !event_abort);
+
+		if (crypts == keys && now - start > 4000ULL * TUNE_TIME)
+			return 0;
+	} while (now - start < 1000ULL * TUNE_TIME && !event_abort);
+
+	if (now == start) now++;
+
+	return crypts * 1000000.0 / (now - start);
+}
+
+void tune_keys_per_crypt(struct db_main *db)
+{
+	struct fmt_main *format = db->format;
+	char line[0x200], match[0x100];
+	char *host;
+	FILE *file;
+	double speed, best_speed;
+	int max, min, keys, best, size, threads, cached, salts;
+	int speeds_keys[TUNE_SIZES];
+	double speeds[TUNE_SIZES];
+
+	if (!cfg_get_bool(SECTION_OPTIONS, NULL, "AutoTune", 0) ||
+	    options.force_maxkeys || !db->salts)
+		return;
+
+	max = format->params.max_keys_per_crypt;
+	if ((min = format->params.min_keys_per_crypt) < 1)
+		min = 1;
+	if (min >= max)
+		return;
+
+	threads = 1;
+#ifdef _OPENMP
+	if (format->params.flags & FMT_OMP)
+		threads = omp_get_max_threads();
+#endif
+	host = tune_host();
+	salts = tune_salt_class(db->salt_count);
+	snprintf(match, sizeof(match), "%s:%s:%d:%d:%d:", host,
+		format->params.label, threads, salts, max);
+
+/* The last line for this host and setup wins */
+	cached = 0;
+	if ((file = fopen(path_expand(TUNE_NAME), "r"))) {
+		while (fgets(line, sizeof(line), file))
+		if (!strncmp(line, match, strlen(match)))
+			cached = atoi(line + strlen(match));
+		fclose(file);
+	}
+
+	if (cached >= min && cached <= max) {
+		best = cached;
+		log_event("- Keys per crypt: %d (auto-tuned earlier)", best);
+	} else {
+#ifdef HAVE_MPI
+		if (mpi_id == 0)
+#endif
+		fprintf(stderr, "Auto-tuning keys per crypt... ");
+
+		best = max; best_speed = 0;
+		for (size = 0, keys = max;
+		    size < TUNE_SIZES && keys >= min && !event_abort;
+		    size++, keys = keys / 2 / min * min) {
+			if (!(speed = tune_measure(db, keys)))
+				break;
+			speeds_keys[size] = keys;
+			speeds[size] = speed;
+			if (speed > best_speed)
+				best_speed = speed;
+		}
+		format->methods.clear_keys();
+
+/* Sizes were tried from the largest down, so the last one within the
+ * tolerance of the best speed is the smallest */
+		while (size--)
+		if (speeds[size] * (100 + TUNE_TOLERANCE) >= best_speed * 100) {
+			best = speeds_keys[size];
+			break;
+		}
+
+#ifdef HAVE_MPI
+		if (mpi_id == 0)
+#endif
+		fprintf(stderr, "%d (of max. %d)\n", best, max);
+		log_event("- Keys per crypt: %d (auto-tuned, max. %d)",
+			best, max);
+
+		if (event_abort)
+			return;
+#ifdef HAVE_MPI
+		if (mpi_id == 0)
+#endif
+		if ((file = fopen(path_expand(TUNE_NAME), "a"))) {
+			fprintf(file, "%s%d\n", match, best);
+			fclose(file);
+		}
+	}
+
+	format->params.max_keys_per_crypt = best;
+}
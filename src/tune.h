@@ -0,0 +1,26 @@
+/*
+ * This file is part of John the Ripper password cracker.
+ * No copyright is claimed, and the software is hereby placed in the
+ * public domain.  Redistribution and use in source and binary forms,
+ * with or without modification, are permitted.
+ */
+
+/*
+ * Keys per crypt auto-tuning.
+ */
+
+#ifndef _JOHN_TUNE_H
+#define _JOHN_TUNE_H
+
+#include "loader.h"
+
+/*
+ * If enabled in the configuration file, picks the number of keys per
+ * crypt_all() call that runs fastest against this database on this host,
+ * and lowers the format's max_keys_per_crypt to it.  The result is cached
+ * in the tuning file, so it's only measured once per host, format, thread
+ * count and rough number of salts.  Must be called before crk_init().
+ */
+extern void tune_keys_per_crypt(struct db_main *db);
+
+#endif
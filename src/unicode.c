@@ -188,6 +188,75 @@ static const UTF32 halfMask = 0x3FFUL;
 #define UNI_SUR_LOW_START   (UTF32)0xDC00
 #define UNI_SUR_LOW_END     (UTF32)0xDFFF
 
+#if defined(__SSE2__) && ARCH_LITTLE_ENDIAN
+#include <emmintrin.h>
+#define UNICODE_SSE2
+
+/*
+ * Candidates are mostly 7-bit, and the first 128 characters are the same in
+ * UTF-8, in all code pages we support and in UTF-16. So we widen the 7-bit
+ * start of a string 16, 8 or 4 bytes at a time (the last block overlapping
+ * the previous one rather than going per character), and the callers go on
+ * with their per-character conversion from where we stopped.
+ *
+ * At most max bytes are read. If nul is non-zero, a block containing a NUL
+ * byte ends the run (utf8_to_utf16() stops at NUL). Returns the number of
+ * characters converted.
+ */
+#define ASCII_BAD(v, mask) \
+	((_mm_movemask_epi8(v) | \
+	  (nul ? _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) : 0)) & (mask))
+#define ASCII_LO(v)	(be ? _mm_unpacklo_epi8(zero, v) : _mm_unpacklo_epi8(v, zero))
+#define ASCII_HI(v)	(be ? _mm_unpackhi_epi8(zero, v) : _mm_unpackhi_epi8(v, zero))
+
+static inline unsigned int ascii_to_utf16(UTF16 *dst, const UTF8 *src,
+                                          unsigned int max, int nul, int be)
+{
+	const __m128i zero = _mm_setzero_si128();
+	unsigned int n = 0;
+	__m128i v, w;
+
+	while (n + 16 <= max) {
+		v = _mm_loadu_si128((const __m128i *)&src[n]);
+		if (ASCII_BAD(v, 0xffff))
+			return n;
+		_mm_storeu_si128((__m128i *)&dst[n], ASCII_LO(v));
+		_mm_storeu_si128((__m128i *)&dst[n + 8], ASCII_HI(v));
+		n += 16;
+	}
+	if (n + 8 <= max) {
+		v = _mm_loadl_epi64((const __m128i *)&src[n]);
+		if (ASCII_BAD(v, 0xff))
+			return n;
+		_mm_storeu_si128((__m128i *)&dst[n], ASCII_LO(v));
+		n += 8;
+	}
+	if (n == max)
+		return n;
+	if (max >= 8) {
+		v = _mm_loadl_epi64((const __m128i *)&src[max - 8]);
+		if (ASCII_BAD(v, 0xff))
+			return n;
+		_mm_storeu_si128((__m128i *)&dst[max - 8], ASCII_LO(v));
+		return max;
+	}
+	if (max >= 4) {
+		v = _mm_cvtsi32_si128(*(const int *)src);
+		w = _mm_cvtsi32_si128(*(const int *)&src[max - 4]);
+		if (ASCII_BAD(_mm_unpacklo_epi32(v, w), 0xff))
+			return 0;
+		_mm_storel_epi64((__m128i *)dst, ASCII_LO(v));
+		_mm_storel_epi64((__m128i *)&dst[max - 4], ASCII_LO(w));
+		return max;
+	}
+	return 0;
+}
+
+#undef ASCII_BAD
+#undef ASCII_LO
+#undef ASCII_HI
+#endif
+
 /* Convert UTF-8 string to UTF-16LE, regardless of arch
  *
  * This code is optimised for speed. Errors result in truncation.
@@ -208,6 +277,21 @@ inline int utf8_to_utf16(UTF16 *target, unsigned int len, const UTF8 *source,
 	UTF32 ch;
 	unsigned int extraBytesToRead;
 
+#ifdef UNICODE_SSE2
+	if (len) {
+		unsigned int n = ascii_to_utf16(target, source,
+		    sourceLen < len ? sourceLen : len - 1, 1, 0);
+
+		if (n) {
+			target += n;
+			source += n;
+			if (*source == 0) {
+				*target = 0;
+				return n;
+			}
+		}
+	}
+#endif
 	while (source < sourceEnd) {
 		if (*source < 0xC0) {
 #if ARCH_LITTLE_ENDIAN
@@ -311,6 +395,21 @@ int utf8_to_utf16_be(UTF16 *target, unsigned int len, const UTF8 *source,
 	UTF32 ch;
 	unsigned int extraBytesToRead;
 
+#ifdef UNICODE_SSE2
+	if (len) {
+		unsigned int n = ascii_to_utf16(target, source,
+		    sourceLen < len ? sourceLen : len - 1, 1, 1);
+
+		if (n) {
+			target += n;
+			source += n;
+			if (*source == 0) {
+				*target = 0;
+				return n;
+			}
+		}
+	}
+#endif
 	while (source < sourceEnd) {
 		if (*source < 0xC0) {
 #if ARCH_LITTLE_ENDIAN
@@ -413,7 +512,13 @@ int enc_to_utf16(UTF16 *dst, unsigned int maxdstlen, const UTF8 *src,
 		if (trunclen > maxdstlen)
 			trunclen = maxdstlen;
 
-		for (i = 0; i < trunclen; i++) {
+		i = 0;
+#ifdef UNICODE_SSE2
+		i = ascii_to_utf16(dst, src, trunclen, 0, 0);
+		dst += i;
+		src += i;
+#endif
+		for (; i < trunclen; i++) {
 #if ARCH_LITTLE_ENDIAN
 			*dst++ = CP_to_Unicode[*src++];
 #else
@@ -445,7 +550,13 @@ int enc_to_utf16_be(UTF16 *dst, unsigned int maxdstlen, const UTF8 *src,
 		if (trunclen > maxdstlen)
 			trunclen = maxdstlen;
 
-		for (i = 0; i < trunclen; i++) {
+		i = 0;
+#ifdef UNICODE_SSE2
+		i = ascii_to_utf16(dst, src, trunclen, 0, 1);
+		dst += i;
+		src += i;
+#endif
+		for (; i < trunclen; i++) {
 #if ARCH_LITTLE_ENDIAN
 			*dst++ = CP_to_Unicode[*src] >> 8 | CP_to_Unicode[*src] << 8;
 			src++;
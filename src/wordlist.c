@@ -42,15 +42,16 @@
 
 #ifdef HAVE_MPI
 #include "john-mpi.h"
+#endif
 
 static int distributeWords, distributeRules, myrulecount;
-#endif
 
 static FILE *word_file = NULL;
 static int progress = 0, hund_progress = 0;
 
 static int rec_rule;
 static long rec_pos;
+static int rec_line;
 
 static int rule_number, rule_count, line_number;
 static int length;
@@ -65,7 +66,7 @@ static struct db_main *_db;
 
 static void save_state(FILE *file)
 {
-	fprintf(file, "%d\n%ld\n", rec_rule, rec_pos);
+	fprintf(file, "%d\n%ld\n%d\n", rec_rule, rec_pos, rec_line);
 }
 
 static int restore_rule_number(void)
@@ -95,6 +96,9 @@ static void restore_line_number(void)
 static int restore_state(FILE *file)
 {
 	if (fscanf(file, "%d\n%ld\n", &rec_rule, &rec_pos) != 2) return 1;
+	/* Older session files do not have the line number */
+	if (fscanf(file, "%d\n", &rec_line) != 1)
+		rec_line = 0;
 
 	if (restore_rule_number()) return 1;
 
@@ -106,13 +110,13 @@ static int restore_state(FILE *file)
 				if (words[nCurLine] - words[0] >= rec_pos)
 					break;
 			}
+			line_number = nCurLine;
 		}
 		else {
 			if (fseek(word_file, rec_pos, SEEK_SET))
 				pexit("fseek");
-#ifdef HAVE_MPI
-			line_number = rec_pos ? mpi_id : 0;    // we just need the correct modulus
-#endif
+			/* Needed for picking this node's lines with --node */
+			line_number = rec_line;
 		}
 	}
 
@@ -137,6 +141,7 @@ static void fix_state(void)
 	fix_state_delay=0;
 
 	rec_rule = rule_number;
+	rec_line = line_number;
 
 	if (word_file == stdin)
 		rec_pos = line_number;
@@ -156,9 +161,7 @@ static int get_progress(int *hundth_perc)
 	struct stat file_stat;
 	long pos;
 	int hundredXpercent, percent;
-#ifndef HAVE_MPI
 	double x100, tmp;
-#endif
 
 	if (!word_file) {
 		*hundth_perc = hund_progress;
@@ -185,21 +188,18 @@ static int get_progress(int *hundth_perc)
 		}
 	}
 
-#ifdef HAVE_MPI
-	if (distributeRules)
-		hundredXpercent = (int)((long long)(10000 * (rule_number / mpi_p * file_stat.st_size + pos)) /
-		                        (long long)(myrulecount * file_stat.st_size));
-	else
-		hundredXpercent = (int)((long long)(10000 * (rule_number * file_stat.st_size + pos)) /
-		                        (long long)(rule_count * file_stat.st_size));
-#else
 	x100 = ((double)pos) * 10000.;
 	// a double 'tmp' var is required, as I have seen the compiler
 	// optimize away the next statement if assigned to an int
-	tmp = (((double)rule_number)*10000. + x100/(file_stat.st_size+1)) / rule_count;
+	if (distributeRules)
+		// only our share of the rules done so far counts
+		tmp = (((double)rule_number) * (options.node_max -
+		        options.node_min + 1) / options.node_count * 10000. +
+		       x100/(file_stat.st_size+1)) / myrulecount;
+	else
+		tmp = (((double)rule_number)*10000. + x100/(file_stat.st_size+1)) / rule_count;
 	// safe int assignment.  tmp will be from 0 to 10000.00
 	hundredXpercent = (int)tmp;
-#endif
 	percent = hundredXpercent / 100;
 	*hundth_perc = hundredXpercent - (percent*100);
 	return percent;
@@ -324,11 +324,13 @@ void do_wordlist_crack(struct db_main *db, char *name, int rules)
 	int dupeCheck = (options.flags & FLG_DUPESUPP) ? 1 : 0;
 	int loopBack = (options.flags & FLG_LOOPBACK_CHK) ? 1 : 0;
 
-#ifdef HAVE_MPI
 	char file_line[LINE_BUFFER_SIZE];
 	long my_size = 0;
 	unsigned int myWordFileLines = 0;
-#endif
+	/* How many node numbers there are, and how many of them are ours */
+	unsigned int node_count = options.node_count ? options.node_count : 1;
+	unsigned int my_nodes = options.node_count ?
+		options.node_max - options.node_min + 1 : 1;
 	int maxlength = options.force_maxlength;
 	int minlength = (options.force_minlength >= 0) ?
 		options.force_minlength : 0;
@@ -404,15 +406,15 @@ void do_wordlist_crack(struct db_main *db, char *name, int rules)
 		   using an external filter, as a modification of a word could
 		   trash the buffer. It's also disabled by --save-mem=N */
 		if (!(options.flags & FLG_EXTERNAL_CHK) && !mem_saving_level)
-#ifdef HAVE_MPI
-		if ((mpi_p > 1 && file_len > mpi_p * 100 && file_len / mpi_p <
+		if ((node_count > 1 && file_len > node_count * 100 &&
+		     file_len / node_count * my_nodes <
 		     db->options->max_wordfile_memory) ||
 		    (file_len < db->options->max_wordfile_memory || forceLoad))
 		{
 			// Load only this node's share of words to memory
 			char *aep;
 
-			if (mpi_p > 1 && (file_len > mpi_p * 100 || forceLoad))
+			if (node_count > 1 && (file_len > node_count * 100 || forceLoad))
 			{
 				/* Check net size for our share. */
 				for (nWordFileLines = 0;; ++nWordFileLines) {
@@ -435,7 +437,7 @@ void do_wordlist_crack(struct db_main *db, char *name, int rules)
 						lp[length] = '\n';
 						lp[length + 1] = 0;
 					}
-					if (nWordFileLines % mpi_p == mpi_id)
+					if (NODE_OWNS(nWordFileLines))
 						my_size += strlen(lp);
 				}
 				fseek(word_file, 0, SEEK_SET);
@@ -461,7 +463,7 @@ void do_wordlist_crack(struct db_main *db, char *name, int rules)
 						lp[length] = '\n';
 						lp[length + 1] = 0;
 					}
-					if (myWordFileLines % mpi_p == mpi_id) {
+					if (NODE_OWNS(myWordFileLines)) {
 						strcpy(&word_file_str[i], lp);
 						i += strlen(lp);
 					}
@@ -475,19 +477,20 @@ void do_wordlist_crack(struct db_main *db, char *name, int rules)
 				log_event("- loaded this node's share of wordfile %s into memory "
 				          "(%lu bytes of %lu, max_size=%u avg/node)",
 				          name, my_size, file_len, db->options->max_wordfile_memory);
+#ifdef HAVE_MPI
 				if (mpi_id == 0)
-					fprintf(stderr,"MPI: each node loaded 1/%d of wordfile to memory (about %lu %s/node)\n",
-					        mpi_p,
-					        my_size > 1<<23 ? my_size >> 20 : my_size >> 10,
-					        my_size > 1<<23 ? "MB" : "KB");
+#endif
+				fprintf(stderr,"Node %u-%u/%u: loaded %u/%u of wordfile to memory (about %lu %s)\n",
+				        options.node_min, options.node_max,
+				        node_count, my_nodes, node_count,
+				        my_size > 1<<23 ? my_size >> 20 : my_size >> 10,
+				        my_size > 1<<23 ? "MB" : "KB");
 				aep = word_file_str + my_size;
 				file_len = my_size;
 			}
 			else {
 				log_event("- loading wordfile %s into memory (%lu bytes, max_size=%u)",
 				          name, file_len, db->options->max_wordfile_memory);
-				if (mpi_p > 1 && mpi_id == 0)
-					fprintf(stderr,"MPI: each node loaded the whole wordfile to memory\n");
 				word_file_str = mem_alloc_tiny(file_len + LINE_BUFFER_SIZE + 1, MEM_ALIGN_NONE);
 				if (fread(word_file_str, 1, file_len, word_file) != file_len) {
 					if (ferror(word_file))
@@ -496,22 +499,6 @@ void do_wordlist_crack(struct db_main *db, char *name, int rules)
 					error();
 				}
 			}
-#else
-		if (file_len < db->options->max_wordfile_memory || forceLoad)
-		{
-			char *aep;
-
-			/* probably should only be debug message, but I left it in */
-			log_event("- loading wordfile %s into memory (%lu bytes, max_size=%u)", name, file_len, db->options->max_wordfile_memory);
-
-			word_file_str = mem_alloc_tiny(file_len + LINE_BUFFER_SIZE + 1, MEM_ALIGN_NONE);
-			if (fread(word_file_str, 1, file_len, word_file) != file_len) {
-				if (ferror(word_file))
-					pexit("fread");
-				fprintf(stderr, "fread: Unexpected EOF\n");
-				error();
-			}
-#endif
 			aep = word_file_str + file_len;
 			*aep = 0;
 			csearch = '\n';
@@ -744,15 +731,14 @@ SKIP_MEM_MAP_LOAD:;
 		apply = dummy_rules_apply;
 	}
 
-#ifdef HAVE_MPI
-	if (mpi_p > 1) {
+	if (node_count > 1) {
 		// Leapfrogging rules is less overhead unless we have wordfile in memory
 
 		// Do not leapfrog at all if we have a split wordlist in memory
 		if (!myWordFileLines) {
 
 			// If less rules than nodes, leapfrog words
-			if (rule_count < mpi_p)
+			if (rule_count < node_count)
 				distributeWords = 1;
 			else
 				distributeRules = 1;
@@ -765,7 +751,7 @@ SKIP_MEM_MAP_LOAD:;
 				distributeWords = 1;
 				distributeRules = 0;
 			} else
-			if (rule_count >= mpi_p && db->options->max_wordfile_memory == 2) {
+			if (rule_count >= node_count && db->options->max_wordfile_memory == 2) {
 				distributeWords = 0;
 				distributeRules = 1;
 			}
@@ -773,17 +759,32 @@ SKIP_MEM_MAP_LOAD:;
 
 		// Tell user what was chosen.
 		if (distributeWords) {
-			log_event("MPI hack active: will process 1/%u of words", mpi_p);
-			if (mpi_id == 0) fprintf(stderr,"MPI: each node processing 1/%u of words\n", mpi_p);
+			log_event("- Node %u-%u/%u: will process %u/%u of words",
+			          options.node_min, options.node_max, node_count,
+			          my_nodes, node_count);
+#ifdef HAVE_MPI
+			if (mpi_id == 0)
+#endif
+			fprintf(stderr,"Node %u-%u/%u: processing %u/%u of words\n",
+			        options.node_min, options.node_max, node_count,
+			        my_nodes, node_count);
 		}
 		if (distributeRules) {
-			myrulecount = (int)(rule_count / mpi_p) + (rule_count % mpi_p > mpi_id ? 1 : 0);
-			log_event("MPI hack active: will process 1/%u of rules, total %d for this node", mpi_p, myrulecount);
-			if (mpi_id == 0) fprintf(stderr,"MPI: each node processing 1/%u of %d rules. (%seven split)\n",
-			                         mpi_p, rule_count, rule_count % mpi_p ? "un" : "");
+			for (i = myrulecount = 0; i < rule_count; i++)
+				if (NODE_OWNS(i))
+					myrulecount++;
+			log_event("- Node %u-%u/%u: will process %u/%u of rules, total %d for this node",
+			          options.node_min, options.node_max, node_count,
+			          my_nodes, node_count, myrulecount);
+#ifdef HAVE_MPI
+			if (mpi_id == 0)
+#endif
+			fprintf(stderr,"Node %u-%u/%u: processing %u/%u of %d rules. (%seven split)\n",
+			        options.node_min, options.node_max, node_count,
+			        my_nodes, node_count, rule_count,
+			        rule_count % node_count ? "un" : "");
 		}
 	}
-#endif
 	rule_number = 0; nCurLine = 0;
 
 	if (init_this_time) {
@@ -807,12 +808,10 @@ SKIP_MEM_MAP_LOAD:;
 	if (prerule)
 	do {
 		if (rules) {
-#ifdef HAVE_MPI
-			// MPI distribution - leapfrog rules
-			if (distributeRules && rule_number % mpi_p != mpi_id)
+			// Node distribution - leapfrog rules
+			if (distributeRules && !NODE_OWNS(rule_number))
 				rule = NULL;
 			else
-#endif
 			if ((rule = rules_reject(prerule, -1, last, db))) {
 				if (strcmp(prerule, rule))
 					log_event("- Rule #%d: '%.100s'"
@@ -832,9 +831,6 @@ SKIP_MEM_MAP_LOAD:;
 			if (nWordFileLines) {
 				if (nCurLine == nWordFileLines)
 					break;
-#ifdef HAVE_MPI
-				if (!distributeWords || line_number % mpi_p == mpi_id)
-#endif
 #if ARCH_ALLOWS_UNALIGNED
 				line = words[nCurLine++];
 #else
@@ -842,10 +838,12 @@ SKIP_MEM_MAP_LOAD:;
 #endif
 			}
 			else {
+				status_phase(PHASE_IO);
 				do {
 					if (!fgetl((char*)line, LINE_BUFFER_SIZE, word_file))
 						goto EndOfFile;
 				} while (!strncmp(line, "#!comment", 9));
+				status_phase(PHASE_GENERATE);
 
 				if (loopBack)
 					memmove((char*)line, potword(line), strlen(potword(line)) + 1);
@@ -862,19 +860,22 @@ SKIP_MEM_MAP_LOAD:;
 					((char*)line)[length] = 0;
 				}
 				if (!strcmp(line, last)) {
-					line_number++; // needed for MPI sync
+					line_number++; // needed for node sync
 					continue;
 				}
 			}
-#ifdef HAVE_MPI
-			// MPI distribution - leapfrog words
-			if (line_number++ % mpi_p != mpi_id && distributeWords)
+			// Node distribution - leapfrog words
+			if (distributeWords && !NODE_OWNS(line_number)) {
+				line_number++;
 				continue;
-#else
+			}
 			line_number++;
-#endif
 
-			if ((word = apply(line, rule, -1, last))) {
+			status_phase(PHASE_RULES);
+			word = apply(line, rule, -1, last);
+			status_phase(PHASE_GENERATE);
+
+			if (word) {
 				if (nWordFileLines)
 					last = word;
 				else
@@ -34,7 +34,13 @@
 #ifdef __XOP__
 #define JOHN_XOP
 #endif
-#if defined(__AVX__) || defined(JOHN_XOP)
+#ifdef __AVX512F__
+#define JOHN_AVX512
+#endif
+#if defined(__AVX2__) || defined(JOHN_AVX512)
+#define JOHN_AVX2
+#endif
+#if defined(__AVX__) || defined(JOHN_XOP) || defined(JOHN_AVX2)
 #define JOHN_AVX
 #endif
 
@@ -49,6 +55,42 @@
 #if 0
 #define DES_BS_VECTOR			0
 #define DES_BS_ALGORITHM_NAME		"64/64 BS"
+#elif defined(JOHN_AVX512) && defined(__GNUC__)
+#undef CPU_DETECT
+#define CPU_DETECT			1
+#define CPU_REQ				1
+#define CPU_REQ_AVX
+#define CPU_REQ_AVX2
+#define CPU_REQ_AVX512
+#define CPU_NAME			"AVX-512"
+#ifndef CPU_FALLBACK
+#define CPU_FALLBACK			0
+#endif
+#if CPU_FALLBACK && !defined(CPU_FALLBACK_BINARY)
+#define CPU_FALLBACK_BINARY		"john-non-avx512"
+#endif
+#define DES_BS_ASM			0
+#define DES_BS_VECTOR			8
+/* vpternlogq makes bit selects one instruction, so use the vsel S-boxes */
+#undef DES_BS
+#define DES_BS				3
+#define DES_BS_ALGORITHM_NAME		"512/512 BS AVX-512"
+#elif defined(JOHN_AVX2) && defined(__GNUC__)
+#undef CPU_DETECT
+#define CPU_DETECT			1
+#define CPU_REQ				1
+#define CPU_REQ_AVX
+#define CPU_REQ_AVX2
+#define CPU_NAME			"AVX2"
+#ifndef CPU_FALLBACK
+#define CPU_FALLBACK			0
+#endif
+#if CPU_FALLBACK && !defined(CPU_FALLBACK_BINARY)
+#define CPU_FALLBACK_BINARY		"john-non-avx2"
+#endif
+#define DES_BS_ASM			0
+#define DES_BS_VECTOR			4
+#define DES_BS_ALGORITHM_NAME		"256/256 BS AVX2"
 #elif defined(JOHN_AVX) && defined(__GNUC__)
 /* Require gcc for AVX because DES_bs_all is aligned in a gcc-specific way */
 #undef CPU_DETECT
@@ -166,7 +208,7 @@
 #endif
 #define DES_BS_EXPAND			1
 
-#if CPU_DETECT && DES_BS == 3
+#if CPU_DETECT && DES_BS == 3 && defined(JOHN_XOP)
 #define CPU_REQ_XOP
 #undef CPU_NAME
 #define CPU_NAME			"XOP"
@@ -186,8 +228,20 @@
 			 + __GNUC_PATCHLEVEL__)
 #endif
 
+/*
+ * With AVX2 and AVX-512, SSEmd5body() does MD5_SSE_WIDE of the 4-lane
+ * blocks in each 256- or 512-bit vector, two vectors at a time.
+ */
 #ifndef MD5_SSE_PARA
-#if defined(__INTEL_COMPILER) || defined(USING_ICC_S_FILE)
+#if defined(JOHN_AVX512)
+#define MD5_SSE_PARA			8
+#define MD5_SSE_WIDE			4
+#define MD5_N_STR			"32x"
+#elif defined(JOHN_AVX2)
+#define MD5_SSE_PARA			4
+#define MD5_SSE_WIDE			2
+#define MD5_N_STR			"16x"
+#elif defined(__INTEL_COMPILER) || defined(USING_ICC_S_FILE)
 #define MD5_SSE_PARA			3
 #define MD5_N_STR			"12x"
 #elif defined(__clang__)
@@ -262,6 +316,25 @@
 #endif
 #endif
 
+/*
+ * SSESHA256body() does SHA256_SSE_PARA blocks of 4 keys at a time, as
+ * vectors of SHA256_SSE_WIDE blocks. It is only used by the dynamic formats
+ * so far.
+ */
+#ifndef SHA256_SSE_PARA
+#if defined(JOHN_AVX512)
+#define SHA256_SSE_PARA			4
+#define SHA256_SSE_WIDE			4
+#define SHA256_N_STR			"16x4"
+#elif defined(JOHN_AVX2)
+#define SHA256_SSE_PARA			2
+#define SHA256_SSE_WIDE			2
+#define SHA256_N_STR			"8x2"
+#else
+#define SHA256_SSE_PARA			2
+#endif
+#endif
+
 #define STR_VALUE(arg)			#arg
 #define PARA_TO_N(n)			"4x" STR_VALUE(n)
 
@@ -274,6 +347,9 @@
 #ifndef SHA1_N_STR
 #define SHA1_N_STR			PARA_TO_N(SHA1_SSE_PARA)
 #endif
+#ifndef SHA256_N_STR
+#define SHA256_N_STR			PARA_TO_N(SHA256_SSE_PARA)
+#endif
 
 #ifndef SHA_BUF_SIZ
 #ifdef SHA1_SSE_PARA
@@ -291,6 +367,7 @@
 #define BF_ASM				0
 #define BF_SCALE			1
 #define BF_X2				1
+#define BF_X				4
 
 #define NT_X86_64
 
@@ -225,6 +225,10 @@
 #endif /* _OPENMP */
 #endif /* SHA1_SSE_PARA */
 
+#ifndef SHA256_SSE_PARA
+#define SHA256_SSE_PARA			1
+#endif
+
 #define STR_VALUE(arg)			#arg
 #define PARA_TO_N(n)			"4x" STR_VALUE(n)
 
@@ -237,6 +241,9 @@
 #if defined(SHA1_SSE_PARA) && !defined(SHA1_N_STR)
 #define SHA1_N_STR			PARA_TO_N(SHA1_SSE_PARA)
 #endif
+#if defined(SHA256_SSE_PARA) && !defined(SHA256_N_STR)
+#define SHA256_N_STR			PARA_TO_N(SHA256_SSE_PARA)
+#endif
 #endif /* JOHN_DISABLE_INTRINSICS */
 
 #ifndef SHA_BUF_SIZ